@@ -0,0 +1,484 @@
+/**
+ *  @file
+ *  @copyright defined in jmzk/LICENSE.txt
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include <boost/program_options.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include <jmzk/chain/block_log.hpp>
+#include <jmzk/testing/tester.hpp>
+#include <jmzk/utilities/metrics.hpp>
+
+/*
+ * End-to-end benchmark: generates a synthetic chain with a mix of actions, then measures
+ * pushing transactions into blocks, deserializing the block log and replaying it.
+ * The results are written in JSON so they can be compared between builds.
+ */
+
+using namespace jmzk;
+using namespace jmzk::chain;
+using namespace jmzk::chain::contracts;
+using namespace jmzk::testing;
+
+namespace bpo = boost::program_options;
+
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+namespace internal {
+
+struct bench_config {
+    uint32_t blocks;
+    uint32_t trxs_per_block;
+    uint32_t domains;
+    uint32_t tokens_per_domain;
+    uint32_t holders;
+    uint32_t ft_percent;
+    uint32_t nft_percent;
+    uint32_t seed;
+    fc::path data_dir;
+};
+
+struct token_info {
+    domain_name domain;
+    token_name  name;
+    uint32_t    owner;
+};
+
+const auto kSymId = 1000u;
+
+int64_t
+elapsed_us(const steady_clock::time_point& start) {
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+// sums of the histograms on the hot paths, deltas of them give the breakdown of phases
+struct phases {
+    static const std::vector<std::pair<const char*, const char*>>&
+    names() {
+        static auto names = std::vector<std::pair<const char*, const char*>> {
+            { "signature_recovery_us", "jmzk_trx_recover_keys_us" },
+            { "authorization_us",      "jmzk_trx_authorization_us" },
+            { "apply_us",              "jmzk_action_apply_us" },
+            { "block_apply_us",        "jmzk_block_apply_us" },
+            { "block_commit_us",       "jmzk_block_commit_us" },
+            { "tokendb_commit_us",     "jmzk_tokendb_commit_us" }
+        };
+        return names;
+    }
+
+    static phases
+    now() {
+        auto& registry = utilities::metrics::registry::instance();
+
+        auto p = phases();
+        for(auto& n : names()) {
+            p.sums.emplace_back(registry.merged_snapshot(n.second).sum);
+        }
+        return p;
+    }
+
+    fc::mutable_variant_object
+    operator-(const phases& rhs) const {
+        auto r = fc::mutable_variant_object();
+        for(auto i = 0u; i < names().size(); i++) {
+            r(names()[i].first, (int64_t)(sums[i] - rhs.sums[i]));
+        }
+        return r;
+    }
+
+    std::vector<double> sums;
+};
+
+class chain_generator {
+public:
+    chain_generator(const bench_config& conf, const controller::config& cfg)
+        : conf_(conf)
+        , tester_(std::make_unique<tester>(cfg))
+        , dre_(conf.seed)
+        , root_key_(tester::get_private_key("jmzk")) {
+        tester_->block_signing_private_keys.insert(std::make_pair(cfg.genesis.initial_key, root_key_));
+
+        holder_keys_.reserve(conf_.holders);
+        for(auto i = 0u; i < conf_.holders; i++) {
+            holder_keys_.emplace_back(private_key_type::regenerate<fc::ecc::private_key_shim>(fc::sha256::hash("holder" + std::to_string(i))));
+        }
+    }
+
+public:
+    void
+    setup() {
+        auto actions = std::vector<action>();
+
+        auto nf         = newfungible();
+        nf.name         = "bench";
+        nf.sym_name     = "bench";
+        nf.sym          = symbol(5, kSymId);
+        nf.creator      = root_key_.get_public_key();
+        nf.issue        = account_permission("issue");
+        nf.manage       = account_permission("manage");
+        nf.total_supply = asset(std::numeric_limits<int64_t>::max() / 2, nf.sym);
+        actions.emplace_back(action(N128(.fungible), name128(std::to_string(kSymId)), nf));
+        push_root_actions(actions);
+
+        for(auto i = 0u; i < conf_.holders; i++) {
+            auto isf    = issuefungible();
+            isf.address = holder_keys_[i].get_public_key();
+            isf.number  = asset(1'000'000'00000ll, symbol(5, kSymId));
+            actions.emplace_back(action(N128(.fungible), name128(std::to_string(kSymId)), isf));
+            push_root_actions(actions, 100);
+        }
+        push_root_actions(actions);
+
+        for(auto i = 0u; i < conf_.domains; i++) {
+            auto nd     = newdomain();
+            nd.name     = name128("bench" + std::to_string(i));
+            nd.creator  = root_key_.get_public_key();
+            nd.issue    = account_permission("issue");
+            nd.transfer = owner_permission("transfer");
+            nd.manage   = account_permission("manage");
+            actions.emplace_back(action(nd.name, N128(.create), nd));
+        }
+        push_root_actions(actions);
+
+        for(auto i = 0u; i < conf_.domains; i++) {
+            for(auto j = 0u; j < conf_.tokens_per_domain; j += 16) {
+                auto owner = random_holder();
+                auto it    = issuetoken();
+                it.domain  = name128("bench" + std::to_string(i));
+                it.owner   = { address(holder_keys_[owner].get_public_key()) };
+                for(auto k = j; k < std::min(j + 16, conf_.tokens_per_domain); k++) {
+                    it.names.emplace_back(name128("t" + std::to_string(k)));
+                    tokens_.emplace_back(token_info { .domain = it.domain, .name = it.names.back(), .owner = owner });
+                }
+                actions.emplace_back(action(it.domain, N128(.issue), it));
+                push_root_actions(actions, 100);
+            }
+        }
+        push_root_actions(actions);
+
+        tester_->produce_block();
+    }
+
+    // pushes the generated transactions, returns the variant of results
+    fc::mutable_variant_object
+    run() {
+        auto trxs    = 0u;
+        auto push_us = int64_t(0);
+        auto prod_us = int64_t(0);
+        auto before  = phases::now();
+
+        for(auto i = 0u; i < conf_.blocks; i++) {
+            auto block_trxs = std::vector<packed_transaction>();
+            block_trxs.reserve(conf_.trxs_per_block);
+            for(auto j = 0u; j < conf_.trxs_per_block; j++) {
+                block_trxs.emplace_back(next_transaction());
+            }
+
+            auto start = steady_clock::now();
+            for(auto& trx : block_trxs) {
+                tester_->push_transaction(trx);
+            }
+            push_us += elapsed_us(start);
+
+            start = steady_clock::now();
+            tester_->produce_block();
+            prod_us += elapsed_us(start);
+
+            trxs += block_trxs.size();
+        }
+        auto after = phases::now();
+
+        return fc::mutable_variant_object()
+            ("transactions", trxs)
+            ("push_us", push_us)
+            ("produce_us", prod_us)
+            ("tps", push_us ? (double)trxs * 1'000'000 / (push_us + prod_us) : 0.0)
+            ("phases", after - before);
+    }
+
+    void
+    close() {
+        // makes sure all the blocks are irreversible and in the block log
+        tester_->produce_blocks(3);
+        tester_->close();
+    }
+
+private:
+    permission_def
+    account_permission(const char* name) {
+        auto p      = permission_def();
+        p.name      = name;
+        p.threshold = 1;
+        p.authorizers.emplace_back(authorizer_ref(root_key_.get_public_key()), 1);
+        return p;
+    }
+
+    permission_def
+    owner_permission(const char* name) {
+        auto p      = permission_def();
+        p.name      = name;
+        p.threshold = 1;
+        p.authorizers.emplace_back(authorizer_ref(), 1);
+        return p;
+    }
+
+    uint32_t
+    random_holder() {
+        return std::uniform_int_distribution<uint32_t>(0, conf_.holders - 1)(dre_);
+    }
+
+    packed_transaction
+    make_transaction(std::vector<action>&& actions, const private_key_type& key) {
+        auto trx = signed_transaction();
+        trx.actions = std::move(actions);
+        tester_->set_transaction_headers(trx, address(key.get_public_key()));
+        trx.sign(key, tester_->control->get_chain_id());
+        return packed_transaction(std::move(trx));
+    }
+
+    void
+    push_root_actions(std::vector<action>& actions, size_t threshold = 0) {
+        if(actions.empty() || actions.size() < threshold) {
+            return;
+        }
+        auto trx = make_transaction(std::move(actions), root_key_);
+        tester_->push_transaction(trx);
+        actions.clear();
+    }
+
+    packed_transaction
+    next_transaction() {
+        auto dice = std::uniform_int_distribution<uint32_t>(0, 99)(dre_);
+        auto nonce = std::to_string(nonce_++);
+
+        if(dice < conf_.ft_percent || tokens_.empty()) {
+            auto from = random_holder();
+
+            auto tf   = transferft();
+            tf.from   = holder_keys_[from].get_public_key();
+            tf.to     = holder_keys_[random_holder()].get_public_key();
+            tf.number = asset(std::uniform_int_distribution<int64_t>(1, 100'00000)(dre_), symbol(5, kSymId));
+            tf.memo   = nonce;
+
+            return make_transaction({ action(N128(.fungible), name128(std::to_string(kSymId)), tf) }, holder_keys_[from]);
+        }
+        else if(dice < conf_.ft_percent + conf_.nft_percent) {
+            auto& tk = tokens_[std::uniform_int_distribution<size_t>(0, tokens_.size() - 1)(dre_)];
+            auto  to = random_holder();
+
+            auto tt   = transfer();
+            tt.domain = tk.domain;
+            tt.name   = tk.name;
+            tt.to     = { address(holder_keys_[to].get_public_key()) };
+            tt.memo   = nonce;
+
+            auto owner = tk.owner;
+            tk.owner   = to;
+            return make_transaction({ action(tt.domain, tt.name, tt) }, holder_keys_[owner]);
+        }
+        else {
+            auto owner = random_holder();
+            auto it    = issuetoken();
+            it.domain  = name128("bench" + std::to_string(std::uniform_int_distribution<uint32_t>(0, conf_.domains - 1)(dre_)));
+            it.owner   = { address(holder_keys_[owner].get_public_key()) };
+            it.names.emplace_back(name128("n" + nonce));
+            tokens_.emplace_back(token_info { .domain = it.domain, .name = it.names.back(), .owner = owner });
+
+            return make_transaction({ action(it.domain, N128(.issue), it) }, root_key_);
+        }
+    }
+
+private:
+    const bench_config&           conf_;
+    std::unique_ptr<tester>       tester_;
+    std::default_random_engine    dre_;
+    private_key_type              root_key_;
+    std::vector<private_key_type> holder_keys_;
+    std::vector<token_info>       tokens_;
+    uint64_t                      nonce_ = 0;
+};
+
+controller::config
+make_controller_config(const fc::path& dir) {
+    auto cfg = controller::config();
+
+    cfg.blocks_dir            = dir / "blocks";
+    cfg.state_dir             = dir / "state";
+    cfg.db_config.db_path     = dir / "tokendb";
+    cfg.state_size            = 1024 * 1024 * 1024ll;
+    cfg.reversible_cache_size = 1024 * 1024 * 256ll;
+    cfg.contracts_console     = false;
+    cfg.charge_free_mode      = true;
+    cfg.loadtest_mode         = true;
+
+    cfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
+    cfg.genesis.initial_key       = tester::get_public_key("jmzk");
+
+    return cfg;
+}
+
+fc::mutable_variant_object
+bench_deserialize(const fc::path& blocks_dir, const chain_id_type& chain_id) {
+    auto blog = block_log(blocks_dir);
+    auto head = blog.read_head();
+    FC_ASSERT(head, "Block log is empty");
+
+    auto blocks = std::vector<signed_block_ptr>();
+    auto start  = steady_clock::now();
+    for(auto i = blog.first_block_num(); i <= head->block_num(); i++) {
+        blocks.emplace_back(blog.read_block_by_num(i));
+    }
+    auto deserialize_us = elapsed_us(start);
+
+    // recovers signatures standalone, replay skips the authorization checks
+    auto trxs = 0u;
+    start     = steady_clock::now();
+    for(auto& b : blocks) {
+        for(auto& r : b->transactions) {
+            r.trx.get_signature_keys(chain_id);
+            trxs++;
+        }
+    }
+    auto recover_us = elapsed_us(start);
+
+    return fc::mutable_variant_object()
+        ("blocks", blocks.size())
+        ("transactions", trxs)
+        ("deserialize_us", deserialize_us)
+        ("signature_recovery_us", recover_us);
+}
+
+fc::mutable_variant_object
+bench_replay(const controller::config& source_cfg, const fc::path& dir) {
+    auto cfg = make_controller_config(dir);
+    fc::create_directories(cfg.blocks_dir);
+    fc::copy(source_cfg.blocks_dir / "blocks.log", cfg.blocks_dir / "blocks.log");
+    fc::copy(source_cfg.blocks_dir / "blocks.index", cfg.blocks_dir / "blocks.index");
+
+    auto before = phases::now();
+    auto start  = steady_clock::now();
+
+    // controller replays the block log at startup
+    auto t      = std::make_unique<tester>(cfg);
+    auto elapsed = elapsed_us(start);
+    auto after  = phases::now();
+    auto blocks = t->control->head_block_num();
+
+    t->close();
+
+    return fc::mutable_variant_object()
+        ("blocks", blocks)
+        ("replay_us", elapsed)
+        ("blocks_per_second", elapsed ? (double)blocks * 1'000'000 / elapsed : 0.0)
+        ("phases", after - before);
+}
+
+}  // namespace internal
+
+int
+main(int argc, char** argv) {
+    using namespace internal;
+
+    auto conf   = bench_config();
+    auto output = std::string();
+
+    auto desc = bpo::options_description("jmzk replay benchmark");
+    desc.add_options()
+        ("help,h", "Print this help message")
+        ("blocks", bpo::value<uint32_t>(&conf.blocks)->default_value(200), "Number of blocks to generate")
+        ("trxs-per-block", bpo::value<uint32_t>(&conf.trxs_per_block)->default_value(200), "Number of transactions per block")
+        ("domains", bpo::value<uint32_t>(&conf.domains)->default_value(10), "Number of NFT domains")
+        ("tokens-per-domain", bpo::value<uint32_t>(&conf.tokens_per_domain)->default_value(1000), "Number of tokens issued in each domain at setup")
+        ("holders", bpo::value<uint32_t>(&conf.holders)->default_value(1000), "Number of holders of tokens and fungibles")
+        ("ft-percent", bpo::value<uint32_t>(&conf.ft_percent)->default_value(70), "Percent of fungible transfers in the transactions")
+        ("nft-percent", bpo::value<uint32_t>(&conf.nft_percent)->default_value(25), "Percent of NFT transfers, the rest are token issues")
+        ("seed", bpo::value<uint32_t>(&conf.seed)->default_value(42), "Seed of random generator")
+        ("data-dir", bpo::value<std::string>()->default_value("/tmp/jmzk_replay_benchmark"), "Directory to store the generated chains")
+        ("output,o", bpo::value<std::string>(&output), "File to write the JSON results, stdout if not provided")
+        ;
+
+    auto vm = bpo::variables_map();
+    try {
+        bpo::store(bpo::parse_command_line(argc, argv, desc), vm);
+        bpo::notify(vm);
+    }
+    catch(const bpo::error& e) {
+        std::cerr << e.what() << std::endl << desc << std::endl;
+        return 1;
+    }
+    if(vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+    if(conf.holders == 0 || conf.domains == 0 || conf.ft_percent + conf.nft_percent > 100) {
+        std::cerr << "Invalid arguments" << std::endl << desc << std::endl;
+        return 1;
+    }
+
+    try {
+        fc::logger::get().set_log_level(fc::log_level(fc::log_level::error));
+
+        conf.data_dir = vm.at("data-dir").as<std::string>();
+        if(fc::exists(conf.data_dir)) {
+            fc::remove_all(conf.data_dir);
+        }
+        fc::create_directories(conf.data_dir);
+
+        auto source_cfg = make_controller_config(conf.data_dir / "source");
+
+        auto start     = steady_clock::now();
+        auto generator = chain_generator(conf, source_cfg);
+        generator.setup();
+        auto setup_us = elapsed_us(start);
+
+        auto push = generator.run();
+        generator.close();
+
+        auto chain_id    = source_cfg.genesis.compute_chain_id();
+        auto deserialize = bench_deserialize(source_cfg.blocks_dir, chain_id);
+        auto replay      = bench_replay(source_cfg, conf.data_dir / "replay");
+
+        auto result = fc::mutable_variant_object()
+            ("config", fc::mutable_variant_object()
+                ("blocks", conf.blocks)
+                ("trxs_per_block", conf.trxs_per_block)
+                ("domains", conf.domains)
+                ("tokens_per_domain", conf.tokens_per_domain)
+                ("holders", conf.holders)
+                ("ft_percent", conf.ft_percent)
+                ("nft_percent", conf.nft_percent)
+                ("seed", conf.seed))
+            ("setup_us", setup_us)
+            ("push_transaction", push)
+            ("block_log", deserialize)
+            ("replay", replay);
+
+        auto json = fc::json::to_pretty_string(fc::variant(result));
+        if(output.empty()) {
+            std::cout << json << std::endl;
+        }
+        else {
+            auto ofs = std::ofstream(output, std::ios::out | std::ios::trunc);
+            ofs << json << std::endl;
+        }
+    }
+    catch(const fc::exception& e) {
+        std::cerr << e.to_detail_string() << std::endl;
+        return 1;
+    }
+    catch(const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -7,6 +7,8 @@
 #include <chrono>
 #include <limits>
 #include <benchmark/benchmark.h>
+#include <vector>
+#include <fc/crypto/sha256.hpp>
 #include "sha256/sha256.hpp"
 
 static void
@@ -66,6 +68,27 @@ BM_SHA256_FC(benchmark::State& state) {
 }
 BENCHMARK(BM_SHA256_FC);
 
+// hashes the 64-byte pairs of one merkle level in a batch
+static void
+BM_SHA256_FC_MANY(benchmark::State& state) {
+    auto buf = std::string();
+
+    auto dre  = std::default_random_engine(std::chrono::system_clock::now().time_since_epoch().count());
+    auto dist = std::uniform_int_distribution<int>(0, std::numeric_limits<char>::max());
+
+    auto n = (size_t)state.range(0);
+    for(auto i = 0u; i < n * 64; i++) {
+        buf.push_back((char)dist(dre));
+    }
+
+    auto result = std::vector<::fc::sha256>(n);
+    for(auto _ : state) {
+        ::fc::sha256::hash_many(buf.data(), 64, n, result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_SHA256_FC_MANY)->Arg(8)->Arg(1024);
+
 static void
 BM_SHA256_CGMINER(benchmark::State& state) {
     auto buf = std::string();
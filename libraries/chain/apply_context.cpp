@@ -5,6 +5,8 @@
 #include <jmzk/chain/apply_context.hpp>
 
 #include <algorithm>
+#include <unordered_map>
+#include <jmzk/utilities/metrics.hpp>
 #include <jmzk/chain/controller.hpp>
 #include <jmzk/chain/execution_context_impl.hpp>
 #include <jmzk/chain/transaction_context.hpp>
@@ -28,6 +30,22 @@ print_debug(const action_trace& ar) {
    }
 }
 
+static inline utilities::metrics::histogram&
+action_apply_histogram(action_name name) {
+    // cached per thread to keep lookup of registry off the hot path
+    thread_local auto histograms = std::unordered_map<uint64_t, utilities::metrics::histogram*>();
+
+    auto it = histograms.find(name.value);
+    if(it != histograms.end()) {
+        return *it->second;
+    }
+
+    auto& h = utilities::metrics::registry::instance().get_histogram(
+        "jmzk_action_apply_us", "Time to apply actions in microseconds", {{"action", name.to_string()}});
+    histograms.emplace(name.value, &h);
+    return h;
+}
+
 void
 apply_context::exec_one(action_trace& trace) {
     using namespace contracts;
@@ -80,7 +98,8 @@ apply_context::finalize_trace(action_trace& trace, const std::chrono::steady_clo
 
     trace.console = fmt::to_string(_pending_console_output);
     trace.elapsed = fc::microseconds(duration_cast<microseconds>(steady_clock::now() - start).count());
-    
+    action_apply_histogram(trace.act.name).observe((double)trace.elapsed.count());
+
     trace.generated_actions = std::move(_generated_actions);
     trace.new_ft_holders    = std::move(_new_ft_holders);
 }
@@ -97,11 +116,8 @@ apply_context::has_authorized(const domain_name& domain, const domain_key& key)
 
 uint64_t
 apply_context::next_global_sequence() {
-    const auto& p = control.get_dynamic_global_properties();
-    db.modify(p, [&](auto& dgp) {
-        ++dgp.global_action_sequence;
-    });
-    return p.global_action_sequence;
+    // written back to dynamic global property by controller once per block
+    return ++trx_context.global_action_sequence;
 }
 
 }}  // namespace jmzk::chain
@@ -23,11 +23,27 @@ block_header::num_from_id(const block_id_type& id) {
 block_id_type
 block_header::id() const {
     // Do not include signed_block_header attributes in id, specifically exclude producer_signature.
-    block_id_type result = digest();  // fc::sha256::hash(*static_cast<const block_header*>(this));
+    return id_from_digest(digest(), block_num());  // fc::sha256::hash(*static_cast<const block_header*>(this));
+}
+
+block_id_type
+block_header::id_from_digest(const digest_type& digest, uint32_t block_num) {
+    block_id_type result = digest;
     result._hash[0] &= 0xffffffff00000000;
     result._hash[0]
-        += fc::endian_reverse_u32(block_num());  // store the block num in the ID, 160 bits is plenty for the hash
+        += fc::endian_reverse_u32(block_num);  // store the block num in the ID, 160 bits is plenty for the hash
     return result;
 }
 
+block_id_type
+signed_block::id() const {
+    return cached_id.get_or_compute([this] { return block_header::id(); });
+}
+
+void
+signed_block::set_header(const signed_block_header& h) {
+    static_cast<signed_block_header&>(*this) = h;
+    cached_id.reset();
+}
+
 }}  // namespace jmzk::chain
@@ -139,6 +139,7 @@ block_header_state::set_new_producers(producer_schedule_type pending) {
     jmzk_ASSERT(pending.version == active_schedule.version + 1, producer_schedule_exception, "wrong producer schedule version specified");
     jmzk_ASSERT(pending_schedule.producers.size() == 0, producer_schedule_exception,
               "cannot set new pending producers until last pending is confirmed");
+    cached_sig_digest.reset();
     header.new_producers     = move(pending);
     pending_schedule_hash    = digest_type::hash(*header.new_producers);
     pending_schedule         = *header.new_producers;
@@ -186,7 +187,7 @@ block_header_state::next(const signed_block_header& h, bool skip_validate_signee
     result.header.action_mroot       = h.action_mroot;
     result.header.transaction_mroot  = h.transaction_mroot;
     result.header.producer_signature = h.producer_signature;
-    result.id                        = result.header.id();
+    result.compute_digests();
 
     // ASSUMPTION FROM controller_impl::apply_block = all untrusted blocks will have their signatures pre-validated here
     if(!skip_validate_signee) {
@@ -206,6 +207,7 @@ block_header_state::set_confirmed(uint16_t num_prev_blocks) {
      }
      */
     header.confirmed = num_prev_blocks;
+    cached_sig_digest.reset();
 
     int32_t  i                 = (int32_t)(confirm_count.size() - 1);
     uint32_t blocks_to_confirm = num_prev_blocks + 1;  /// confirm the head block too
@@ -232,12 +234,27 @@ block_header_state::set_confirmed(uint16_t num_prev_blocks) {
     }
 }
 
+void
+block_header_state::compute_digests() {
+    auto d            = header.digest();
+    id                = block_header::id_from_digest(d, header.block_num());
+    cached_sig_digest = sig_digest(d);
+}
+
 digest_type
-block_header_state::sig_digest() const {
-    auto header_bmroot = digest_type::hash(std::make_pair(header.digest(), blockroot_merkle.get_root()));
+block_header_state::sig_digest(const digest_type& header_digest) const {
+    auto header_bmroot = digest_type::hash(std::make_pair(header_digest, blockroot_merkle.get_root()));
     return digest_type::hash(std::make_pair(header_bmroot, pending_schedule_hash));
 }
 
+digest_type
+block_header_state::sig_digest() const {
+    if(cached_sig_digest.has_value()) {
+        return *cached_sig_digest;
+    }
+    return sig_digest(header.digest());
+}
+
 void
 block_header_state::sign(const std::function<signature_type(const digest_type&)>& signer) {
     auto d                    = sig_digest();
@@ -32,6 +32,78 @@ group::visit_node(const node& node, const visit_func& func) const {
     }
 }
 
+namespace internal {
+
+struct group_compiler {
+public:
+    group_compiler(const group& group, compiled_group& result)
+        : group_(group), result_(result) {}
+
+public:
+    bool
+    compile() {
+        if(group_.nodes_.empty() || group_.nodes_[0].is_leaf()) {
+            return false;
+        }
+        return add_node(group_.nodes_[0], 0);
+    }
+
+private:
+    bool
+    add_node(const group::node& node, uint32_t depth) {
+        if(result_.entries.size() >= compiled_group::kMaxEntries) {
+            return false;
+        }
+
+        auto pos = result_.entries.size();
+        auto e   = compiled_group::entry();
+        e.weight    = node.weight;
+        e.threshold = node.threshold;
+        e.depth     = 0;
+        e.key       = 0;
+
+        if(node.is_leaf()) {
+            if(node.index >= group_.keys_.size()) {
+                return false;
+            }
+            auto it = result_.keys.emplace(group_.keys_[node.index], (uint16_t)result_.keys.size()).first;
+            e.key   = it->second;
+            e.end   = pos + 1;
+            result_.entries.emplace_back(e);
+            return true;
+        }
+
+        if(depth >= compiled_group::kMaxDepth || (size_t)node.index + node.size > group_.nodes_.size()) {
+            return false;
+        }
+        e.depth = depth;
+        result_.entries.emplace_back(e);
+
+        for(uint i = 0; i < node.size; i++) {
+            if(!add_node(group_.nodes_[node.index + i], depth + 1)) {
+                return false;
+            }
+        }
+        result_.entries[pos].end = result_.entries.size();
+        return true;
+    }
+
+private:
+    const group&    group_;
+    compiled_group& result_;
+};
+
+}  // namespace internal
+
+std::shared_ptr<const compiled_group>
+compiled_group::compile(const group& group) {
+    auto result = std::make_shared<compiled_group>();
+    if(!internal::group_compiler(group, *result).compile()) {
+        return nullptr;
+    }
+    return result;
+}
+
 }}}  // namespac jmzk::chain::contracts
 
 namespace fc {
@@ -4,6 +4,8 @@
  */
 #include <jmzk/chain/controller.hpp>
 
+#include <atomic>
+
 #include <chainbase/chainbase.hpp>
 #include <fmt/format.h>
 
@@ -11,6 +13,8 @@
 #include <fc/scoped_exit.hpp>
 #include <fc/variant_object.hpp>
 
+#include <jmzk/utilities/metrics.hpp>
+
 #include <jmzk/chain/authority_checker.hpp>
 #include <jmzk/chain/block_log.hpp>
 #include <jmzk/chain/charge_manager.hpp>
@@ -18,6 +22,7 @@
 #include <jmzk/chain/execution_context_impl.hpp>
 #include <jmzk/chain/fork_database.hpp>
 #include <jmzk/chain/snapshot.hpp>
+#include <jmzk/chain/thread_utils.hpp>
 #include <jmzk/chain/token_database.hpp>
 #include <jmzk/chain/token_database_cache.hpp>
 #include <jmzk/chain/token_database_snapshot.hpp>
@@ -124,6 +129,7 @@ struct pending_state {
     small_vector<action_receipt, 4> _actions;
     controller::block_status        _block_status = controller::block_status::incomplete;
     optional<block_id_type>         _producer_block_id;
+    optional<uint64_t>              _global_action_sequence;  // written back to chainbase in finalize_block
 
     void
     push() {
@@ -153,6 +159,21 @@ struct controller_impl {
     bool                     trusted_producer_light_validation = false;
     uint32_t                 snapshot_head_block = 0;
     abi_serializer           system_api;
+    boost::asio::thread_pool thread_pool;
+    std::unique_ptr<boost::asio::thread_pool> prefetch_pool;  ///< single I/O thread, only if prefetch is enabled
+    std::atomic<size_t>      prefetch_inflight{0};            ///< transactions posted to prefetch pool but not read yet
+
+    // prefetching is dropped beyond this, the transactions would be executed before the reads finish anyway
+    static constexpr size_t kMaxPrefetchInflight = 4'096;
+
+    small_vector<transaction_context*, 2> running_trx_contexts;  ///< suspended transactions are nested in the outer ones
+
+    utilities::metrics::histogram& apply_block_histogram = utilities::metrics::registry::instance().get_histogram(
+        "jmzk_block_apply_us", "Time to apply blocks in microseconds");
+    utilities::metrics::histogram& commit_block_histogram = utilities::metrics::registry::instance().get_histogram(
+        "jmzk_block_commit_us", "Time to commit blocks in microseconds");
+    utilities::metrics::histogram& tokendb_commit_histogram = utilities::metrics::registry::instance().get_histogram(
+        "jmzk_tokendb_commit_us", "Time to commit irreversible blocks into token database in microseconds");
 
     /**
      *  Transactions that were undone by pop_block or abort_block, transactions
@@ -197,14 +218,25 @@ struct controller_impl {
         , chain_id(cfg.genesis.compute_chain_id())
         , exec_ctx(s)
         , read_mode(cfg.read_mode)
-        , system_api(contracts::jmzk_contract_abi(), cfg.max_serialization_time) {
+        , system_api(contracts::jmzk_contract_abi(), cfg.max_serialization_time)
+        , thread_pool(cfg.thread_pool_size) {
 
         fork_db.irreversible.connect([&](auto b) {
             on_irreversible(b);
         });
+
+        if(cfg.db_config.enable_prefetch) {
+            prefetch_pool = std::make_unique<boost::asio::thread_pool>(1);
+        }
     }
 
     ~controller_impl() {
+        if(prefetch_pool) {
+            prefetch_pool->stop();
+            prefetch_pool->join();
+        }
+        thread_pool.stop();
+        thread_pool.join();
         pending.reset();
     }
 
@@ -267,7 +299,10 @@ struct controller_impl {
         }
 
         db.commit(s->block_num);
-        token_db.pop_savepoints(s->block_num);
+        {
+            auto timer = utilities::metrics::scoped_timer(tokendb_commit_histogram);
+            token_db.pop_savepoints(s->block_num);
+        }
 
         if(append_to_blog) {
             blog.append(s->block);
@@ -404,6 +439,18 @@ struct controller_impl {
         jmzk_ASSERT(db.revision() >= head->block_num, fork_database_exception, "fork database is inconsistent with shared memory",
                    ("db", db.revision())("head", head->block_num));
 
+        if(conf.db_config.enable_journal) {
+            // journal is synced ahead of fork database, savepoints of a block not recorded yet are dropped
+            while(token_db.savepoints_size() > 0 && token_db.latest_savepoint_seq() > db.revision()) {
+                wlog("Rollback savepoint ${seq} of token database ahead of database revision ${db}",
+                    ("seq",token_db.latest_savepoint_seq())("db",db.revision()));
+                token_db.rollback_to_latest_savepoint();
+            }
+            jmzk_ASSERT(token_db.savepoints_size() == 0 || token_db.latest_savepoint_seq() == db.revision(), token_database_exception,
+                "token database(${seq}) is inconsistent with fork database(${db}), savepoints journal is missing",
+                ("seq",token_db.latest_savepoint_seq())("db",db.revision()));
+        }
+
         if(db.revision() > head->block_num) {
             wlog("warning: database revision (${db}) is greater than head block number (${head}), "
                  "attempting to undo pending changes",
@@ -571,11 +618,15 @@ struct controller_impl {
      */
     void
     commit_block(bool add_to_fork_db) {
+        auto timer = utilities::metrics::scoped_timer(commit_block_histogram);
         auto reset_pending_on_exit = fc::make_scoped_exit([this] {
             pending.reset();
         });
 
         try {
+            // savepoints of the block must be durable before fork database records it
+            token_db.sync_savepoints();
+
             if(add_to_fork_db) {
                 pending->_pending_block_state->validated = true;
                 auto new_bsp = fork_db.add(pending->_pending_block_state, true);
@@ -647,6 +698,7 @@ struct controller_impl {
         auto& conf = db.get<global_property_object>().configuration;
 
         auto checker = authority_checker(self, exec_ctx, signed_keys, conf.max_authority_depth);
+        checker.prefetch_nft_owners(trx);
         for(const auto& act : trx.actions) {
             jmzk_ASSERT(checker.satisfied(act), unsatisfied_authorization,
                        "${name} action in domain: ${domain} with key: ${key} authorized failed",
@@ -670,6 +722,8 @@ struct controller_impl {
             auto trx_context     = transaction_context(self, exec_ctx, trx);
             trx_context.deadline = deadline;
 
+            auto running = begin_global_action_sequence(trx_context);
+
             auto trace = trx_context.trace;
             try {
                 trx_context.init_for_suspend_trx();
@@ -688,6 +742,7 @@ struct controller_impl {
                 emit(self.applied_transaction, trace);
 
                 trx_context.squash();
+                commit_global_action_sequence(trx_context);
                 restore.cancel();
                 return trace;
             }
@@ -734,6 +789,8 @@ struct controller_impl {
             trx_context.deadline = deadline;
             trace                = trx_context.trace;
 
+            auto running = begin_global_action_sequence(trx_context);
+
             try {
                 if(trx->implicit) {
                     trx_context.init_for_implicit_trx();
@@ -777,6 +834,7 @@ struct controller_impl {
                 else {
                     restore.cancel();
                     trx_context.squash();
+                    commit_global_action_sequence(trx_context);
                 }
 
                 if(!trx->implicit) {
@@ -864,25 +922,121 @@ struct controller_impl {
         auto p = pending->_pending_block_state;
         p->sign(signer_callback);
 
-        static_cast<signed_block_header&>(*p->block) = p->header;
+        p->block->set_header(p->header);
     }  /// sign_block
 
+    // reads the objects which are read first by the contracts, only keys and fixed fields of data are used
+    void
+    prefetch_action(const action& act) {
+        using namespace contracts;
+
+        if(act.domain == N128(.fungible)) {
+            auto sym_id = (symbol_id_type)std::stoul((std::string)act.key);
+            token_db_cache.prefetch_token<fungible_def>(token_type::fungible, std::nullopt, sym_id);
+
+            auto ds = fc::datastream<const char*>(act.data.data(), act.data.size());
+            if(act.name == N(transferft) || act.name == N(jmzk2pjmzk)) {
+                auto from   = address();
+                auto to     = address();
+                auto number = asset();
+                fc::raw::unpack(ds, from);
+                fc::raw::unpack(ds, to);
+                fc::raw::unpack(ds, number);
+
+                token_db.prefetch_asset(from, number.sym().id());
+                token_db.prefetch_asset(to, act.name == N(jmzk2pjmzk) ? Pjmzk_SYM_ID : number.sym().id());
+            }
+            else if(act.name == N(recycleft) || act.name == N(destroyft)) {
+                auto addr   = address();
+                auto number = asset();
+                fc::raw::unpack(ds, addr);
+                fc::raw::unpack(ds, number);
+
+                token_db.prefetch_asset(addr, number.sym().id());
+            }
+        }
+        else if(act.domain == N128(.group)) {
+            token_db_cache.prefetch_token<group_def>(token_type::group, std::nullopt, act.key);
+        }
+        else if(!act.domain.reserved()) {
+            token_db_cache.prefetch_token<domain_def>(token_type::domain, std::nullopt, act.domain);
+            if(!act.key.reserved()) {
+                token_db_cache.prefetch_token<token_def>(token_type::token, act.domain, act.key);
+            }
+        }
+    }
+
+    void
+    prefetch_transactions(std::vector<packed_transaction_ptr> ptrxs) {
+        // replay is bound by execution already and reads the blocks in order, prefetching only adds contention
+        if(!prefetch_pool || replaying || ptrxs.empty()) {
+            return;
+        }
+        if(prefetch_inflight.load(std::memory_order_relaxed) + ptrxs.size() > kMaxPrefetchInflight) {
+            return;
+        }
+        prefetch_inflight.fetch_add(ptrxs.size(), std::memory_order_relaxed);
+
+        boost::asio::post(*prefetch_pool, [this, ptrxs = std::move(ptrxs)] {
+            auto done = fc::make_scoped_exit([this, n = ptrxs.size()] {
+                prefetch_inflight.fetch_sub(n, std::memory_order_relaxed);
+            });
+            for(auto& ptrx : ptrxs) {
+                auto& trx = ptrx->get_transaction();
+                for(auto& act : trx.actions) {
+                    try {
+                        prefetch_action(act);
+                    }
+                    catch(...) {
+                        // invalid actions are left to be reported by the contracts
+                    }
+                }
+
+                try {
+                    // fees are charged from the payer
+                    token_db.prefetch_asset(trx.payer, Pjmzk_SYM_ID);
+                    token_db.prefetch_asset(trx.payer, jmzk_SYM_ID);
+                }
+                catch(...) {}
+            }
+        });
+    }
+
     void
     apply_block(const signed_block_ptr& b, controller::block_status s) {
+        auto timer = utilities::metrics::scoped_timer(apply_block_histogram);
         try {
             try {
                 jmzk_ASSERT(b->block_extensions.size() == 0, block_validate_exception, "no supported extensions");
                 auto producer_block_id = b->id();
                 start_block(b->timestamp, b->confirmed, s, producer_block_id);
 
+                // restore the keys of embedded jmzk-links for all the transactions ahead of execution
+                auto mtrxs = std::vector<transaction_metadata_ptr>();
+                mtrxs.reserve(b->transactions.size());
+                for(const auto& receipt : b->transactions) {
+                    if(receipt.type == transaction_receipt::input) {
+                        auto mtrx = std::make_shared<transaction_metadata>(std::make_shared<packed_transaction>(receipt.trx));
+                        transaction_metadata::start_restore_link_keys(mtrx, thread_pool);
+                        mtrxs.emplace_back(std::move(mtrx));
+                    }
+                }
+
+                if(prefetch_pool && !replaying) {
+                    auto ptrxs = std::vector<packed_transaction_ptr>();
+                    ptrxs.reserve(mtrxs.size());
+                    for(auto& mtrx : mtrxs) {
+                        ptrxs.emplace_back(mtrx->packed_trx);
+                    }
+                    prefetch_transactions(std::move(ptrxs));
+                }
+
+                auto mtrx_itr             = mtrxs.cbegin();
                 auto num_pending_receipts = pending->_pending_block_state->block->transactions.size();
                 for(const auto& receipt : b->transactions) {
                     auto trace = transaction_trace_ptr();
                     if(receipt.type == transaction_receipt::input) {
-                        auto& pt    = receipt.trx;
-                        auto  mtrx  = std::make_shared<transaction_metadata>(std::make_shared<packed_transaction>(pt));
-                        
-                        trace = push_transaction(mtrx, fc::time_point::maximum());
+                        trace = push_transaction(*mtrx_itr++, fc::time_point::maximum());
                     }
                     else if(receipt.type == transaction_receipt::suspend) {
                         // suspend transaction is executed in its parent transaction
@@ -919,9 +1073,9 @@ struct controller_impl {
                 finalize_block();
 
                 // this implicitly asserts that all header fields (less the signature) are identical
-                jmzk_ASSERT(producer_block_id == pending->_pending_block_state->header.id(),
+                jmzk_ASSERT(producer_block_id == pending->_pending_block_state->id,
                        block_validate_exception, "Block ID does not match",
-                       ("producer_block_id",producer_block_id)("validator_block_id",pending->_pending_block_state->header.id())("p",b)("p2",pending->_pending_block_state->block));
+                       ("producer_block_id",producer_block_id)("validator_block_id",pending->_pending_block_state->id)("p",b)("p2",pending->_pending_block_state->block));
 
                 // We need to fill out the pending block state's block because that gets serialized in the reversible block log
                 // in the future we can optimize this by serializing the original and not the copy
@@ -931,7 +1085,7 @@ struct controller_impl {
                 //   - OTHERWISE the block is trusted and therefore we trust that the signature is valid
                 // Also, as ::sign_block does not lazily calculate the digest of the block, we can just short-circuit to save cycles
                 pending->_pending_block_state->header.producer_signature = b->producer_signature;
-                static_cast<signed_block_header&>(*pending->_pending_block_state->block) =  pending->_pending_block_state->header;
+                pending->_pending_block_state->block->set_header(pending->_pending_block_state->header);
 
                 commit_block(false);
                 return;
@@ -1036,7 +1190,7 @@ struct controller_impl {
                     apply_block((*ritr)->block,  (*ritr)->validated ? controller::block_status::validated : controller::block_status::complete);
                     head = *ritr;
                     fork_db.mark_in_current_chain(*ritr, true);
-                    (*ritr)->validated = true;
+                    fork_db.set_validity(*ritr, true);
                 }
                 catch(const fc::exception& e) {
                     except = e;
@@ -1090,36 +1244,101 @@ struct controller_impl {
 
     void
     set_action_merkle() {
-        vector<digest_type> action_digests;
-        action_digests.reserve(pending->_actions.size());
-        for(const auto& a : pending->_actions) {
-            action_digests.emplace_back(a.digest());
+        const auto& acts = pending->_actions;
+        if(acts.empty()) {
+            pending->_pending_block_state->header.action_mroot = digest_type();
+            return;
+        }
+
+        // receipts are packed with fixed size, so their digests are hashed in one batch
+        auto size = fc::raw::pack_size(acts.front());
+        auto buf  = vector<char>(size * acts.size());
+        auto ds   = fc::datastream<char*>(buf.data(), buf.size());
+        for(const auto& a : acts) {
+            fc::raw::pack(ds, a);
         }
 
+        auto action_digests = vector<digest_type>(acts.size());
+        digest_type::hash_many(buf.data(), size, acts.size(), action_digests.data());
+
         pending->_pending_block_state->header.action_mroot = merkle(move(action_digests));
     }
 
     void
     set_trx_merkle() {
-        vector<digest_type> trx_digests;
-        const auto&         trxs = pending->_pending_block_state->block->transactions;
-        trx_digests.reserve(trxs.size());
+        const auto& trxs = pending->_pending_block_state->block->transactions;
+        if(trxs.empty()) {
+            pending->_pending_block_state->header.transaction_mroot = digest_type();
+            return;
+        }
+
+        // same as `transaction_receipt::digest()`, only the outer hashes are batched
+        auto size = fc::raw::pack_size(trxs.front().status) + fc::raw::pack_size(trxs.front().type) + sizeof(digest_type);
+        auto buf  = vector<char>(size * trxs.size());
+        auto ds   = fc::datastream<char*>(buf.data(), buf.size());
         for(const auto& trx : trxs) {
-            trx_digests.emplace_back(trx.digest());
+            fc::raw::pack(ds, trx.status);
+            fc::raw::pack(ds, trx.type);
+            fc::raw::pack(ds, trx.trx.packed_digest());
         }
 
+        auto trx_digests = vector<digest_type>(trxs.size());
+        digest_type::hash_many(buf.data(), size, trxs.size(), trx_digests.data());
+
         pending->_pending_block_state->header.transaction_mroot = merkle(move(trx_digests));
     }
 
+    /**
+     *  Transactions take global action sequences from the pending block instead of modifying
+     *  the dynamic global property for each action, the sequence is written back once per block.
+     *  Suspended transactions are executed inside an action of another transaction, so they
+     *  continue from and commit to the sequence of the outer one.
+     */
+    auto
+    begin_global_action_sequence(transaction_context& trx_context) {
+        if(!running_trx_contexts.empty()) {
+            trx_context.global_action_sequence = running_trx_contexts.back()->global_action_sequence;
+        }
+        else if(pending->_global_action_sequence.has_value()) {
+            trx_context.global_action_sequence = *pending->_global_action_sequence;
+        }
+        else {
+            trx_context.global_action_sequence = db.get<dynamic_global_property_object>().global_action_sequence;
+        }
+
+        running_trx_contexts.emplace_back(&trx_context);
+        return fc::make_scoped_exit([this] {
+            running_trx_contexts.pop_back();
+        });
+    }
+
+    void
+    commit_global_action_sequence(const transaction_context& trx_context) {
+        assert(!running_trx_contexts.empty() && running_trx_contexts.back() == &trx_context);
+        if(running_trx_contexts.size() > 1) {
+            running_trx_contexts[running_trx_contexts.size() - 2]->global_action_sequence = trx_context.global_action_sequence;
+        }
+        else {
+            pending->_global_action_sequence = trx_context.global_action_sequence;
+        }
+    }
+
     void
     finalize_block() {
         jmzk_ASSERT(pending.has_value(), block_validate_exception, "it is not valid to finalize when there is no pending block");
         try {
+            if(pending->_global_action_sequence.has_value()) {
+                db.modify(db.get<dynamic_global_property_object>(), [&](auto& dgp) {
+                    dgp.global_action_sequence = *pending->_global_action_sequence;
+                });
+                pending->_global_action_sequence.reset();
+            }
+
             set_action_merkle();
             set_trx_merkle();
 
             auto p = pending->_pending_block_state;
-            p->id  = p->header.id();
+            p->compute_digests();
 
             create_block_summary(p->id);
         }
@@ -1240,6 +1459,16 @@ controller::get_execution_context() const {
     return my->exec_ctx;
 }
 
+boost::asio::thread_pool&
+controller::get_thread_pool() {
+    return my->thread_pool;
+}
+
+void
+controller::prefetch_transaction(const transaction_metadata_ptr& trx) {
+    my->prefetch_transactions({ trx->packed_trx });
+}
+
 void
 controller::start_block(block_timestamp_type when, uint16_t confirm_block_count) {
     validate_db_available_size();
@@ -1458,15 +1687,14 @@ jmzk_link_object
 controller::get_link_obj_for_link_id(const link_id_type& link_id) const {
     jmzk_link_object link_obj;
 
-    auto str = std::string();
     try {
-        my->token_db.read_token(token_type::jmzklink, std::nullopt, link_id, str);
+        my->token_db.read_token_view(token_type::jmzklink, std::nullopt, link_id, [&](auto& v) {
+            extract_db_value(v, link_obj);
+        });
     }
     catch(token_database_exception&) {
         jmzk_THROW2(jmzk_link_existed_exception, "Cannot find jmzkLink with id: {}", fc::to_hex((char*)&link_id, sizeof(link_id)));
     }
-
-    extract_db_value(str, link_obj);
     return link_obj;
 }
 
@@ -1768,6 +1996,7 @@ public_keys_set
 controller::get_required_keys(const transaction& trx, const public_keys_set& candidate_keys) const {
     const static uint32_t max_authority_depth = my->conf.genesis.initial_configuration.max_authority_depth;
     auto checker = authority_checker(*this, my->exec_ctx, candidate_keys, max_authority_depth, false /* check script */);
+    checker.prefetch_nft_owners(trx);
 
     for(const auto& act : trx.actions) {
         jmzk_ASSERT(checker.satisfied(act), unsatisfied_authorization,
@@ -1800,15 +2029,14 @@ public_keys_set
 controller::get_suspend_required_keys(const proposal_name& name, const public_keys_set& candidate_keys) const {
     suspend_def suspend;
 
-    auto str = std::string();
     try {
-        my->token_db.read_token(token_type::suspend, std::nullopt, name, str);
+        my->token_db.read_token_view(token_type::suspend, std::nullopt, name, [&](auto& v) {
+            extract_db_value(v, suspend);
+        });
     }
     catch(token_database_exception&) {
         jmzk_THROW2(unknown_suspend_exception, "Cannot find suspend proposal: {}", name);
     }
-
-    extract_db_value(str, suspend);
     return get_suspend_required_keys(suspend.trx, candidate_keys);
 }
 
@@ -1817,11 +2045,11 @@ controller::get_jmzklink_signed_keys(const link_id_type& link_id) const {
     auto link  = get_link_obj_for_link_id(link_id);
     auto block = fetch_block_by_number(link.block_num);
     for(auto& ptrx : block->transactions) {
-        auto& trx = ptrx.trx.get_transaction();
-        if(trx.id() != link.trx_id) {
+        if(ptrx.trx.id() != link.trx_id) {
             continue;
         }
 
+        auto& trx = ptrx.trx.get_transaction();
         auto keys = public_keys_set();
         for(auto& act : trx.actions) {
             if(act.name == N(everipay)) {
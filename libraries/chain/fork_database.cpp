@@ -11,9 +11,15 @@
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index_container.hpp>
+#include <fc/crypto/city.hpp>
 #include <fc/io/fstream.hpp>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace jmzk { namespace chain {
 using boost::multi_index_container;
 using namespace boost::multi_index;
@@ -43,12 +49,353 @@ typedef multi_index_container<
                    composite_key_compare<std::greater<uint32_t>, std::greater<uint32_t>, std::greater<uint32_t>>>>>
     fork_multi_index_type;
 
+namespace internal {
+
+const static uint32_t forkdb_magic       = 0x4244464a;  // "JFDB"
+const static size_t   log_header_size    = sizeof(uint32_t) + sizeof(uint64_t);  // magic + generation
+const static size_t   record_header_size = sizeof(uint32_t) + sizeof(uint64_t);  // size + checksum
+
+enum class log_record_type : uint8_t {
+    insert = 0,        // block_state
+    erase,             // block id
+    validity,          // block id, validated
+    in_current_chain,  // block id, in_current_chain
+    confirmation,      // header_confirmation
+    head               // block id
+};
+
+// makes the written data of the file or a rename in the directory durable
+void
+sync_path(const fc::path& path, bool directory) {
+    auto fd = ::open(path.generic_string().c_str(), directory ? (O_RDONLY | O_DIRECTORY) : O_RDONLY);
+    jmzk_ASSERT(fd >= 0, fork_database_exception, "Failed to open ${p} to sync: ${e}", ("p", path.generic_string())("e", strerror(errno)));
+
+    auto r = ::fsync(fd);
+    auto e = errno;
+    ::close(fd);
+    jmzk_ASSERT(r == 0, fork_database_exception, "Failed to sync ${p}: ${e}", ("p", path.generic_string())("e", strerror(e)));
+}
+
+}  // namespace internal
+
+using namespace internal;
+
+/**
+ *  Besides the snapshot in forkdb.dat, every change to the fork database is appended to forkdb.log
+ *  so the state can survive a crash. Both files carry a generation number, the log is only replayed
+ *  on top of the snapshot of the same generation. Compaction writes a new snapshot with the next
+ *  generation and then starts a new log, so a crash in between leaves a stale log which is discarded.
+ *
+ *  Records are written as they happen and the log is synced once a block is added or its validity is
+ *  set, those are the points the controller commits a block at. Insert records hold the whole block
+ *  state rather than only the block, so replay needs neither the previous state nor signature checks,
+ *  the block itself makes up most of the size anyway.
+ */
 struct fork_database_impl {
     fork_multi_index_type index;
     block_state_ptr       head;
     fc::path              datadir;
+
+    int               log_fd         = -1;
+    bool              log_dirty      = false;  // records written since last sync
+    uint64_t          log_generation = 0;
+    uint64_t          log_size       = 0;
+    std::vector<char> log_buffer;              // reused by records
+
+    template<typename... Args>
+    void append(log_record_type type, const Args&... args);
+    void write_log(const char* data, size_t len);
+    void sync_log();
+    void close_log();
+
+    void apply_record(fork_database& self, const char* data, size_t len);
+    bool replay_log(fork_database& self);
+    void open_log(bool truncate);
+
+    void read_snapshot(fork_database& self);
+    void write_snapshot();
+    void compact();
 };
 
+template<typename... Args>
+void
+fork_database_impl::append(log_record_type type, const Args&... args) {
+    if(log_fd < 0) {
+        return;
+    }
+
+    auto size = fc::raw::pack_size((uint8_t)type);
+    ((size += fc::raw::pack_size(args)), ...);
+
+    // header and payload go in one write
+    log_buffer.resize(record_header_size + size);
+    auto payload = log_buffer.data() + record_header_size;
+    auto ds      = fc::datastream<char*>(payload, size);
+    fc::raw::pack(ds, (uint8_t)type);
+    (fc::raw::pack(ds, args), ...);
+
+    auto len      = (uint32_t)size;
+    auto checksum = fc::city_hash64(payload, size);
+    memcpy(log_buffer.data(), &len, sizeof(len));
+    memcpy(log_buffer.data() + sizeof(len), &checksum, sizeof(checksum));
+
+    write_log(log_buffer.data(), log_buffer.size());
+    log_size += log_buffer.size();
+}
+
+void
+fork_database_impl::write_log(const char* data, size_t len) {
+    while(len > 0) {
+        auto n = ::write(log_fd, data, len);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        jmzk_ASSERT(n > 0, fork_database_exception, "Failed to write fork database log: ${e}", ("e", strerror(errno)));
+        data += n;
+        len  -= n;
+    }
+    log_dirty = true;
+}
+
+void
+fork_database_impl::sync_log() {
+    if(log_fd < 0 || !log_dirty) {
+        return;
+    }
+    jmzk_ASSERT(::fdatasync(log_fd) == 0, fork_database_exception, "Failed to sync fork database log: ${e}", ("e", strerror(errno)));
+    log_dirty = false;
+}
+
+void
+fork_database_impl::close_log() {
+    if(log_fd < 0) {
+        return;
+    }
+    sync_log();
+    ::close(log_fd);
+    log_fd = -1;
+}
+
+void
+fork_database_impl::apply_record(fork_database& self, const char* data, size_t len) {
+    auto ds   = fc::datastream<const char*>(data, len);
+    auto type = uint8_t();
+    fc::raw::unpack(ds, type);
+
+    switch((log_record_type)type) {
+    case log_record_type::insert: {
+        auto s = std::make_shared<block_state>();
+        fc::raw::unpack(ds, *s);
+
+        auto itr = index.find(s->id);
+        if(itr != index.end()) {
+            index.replace(itr, s);
+        }
+        else {
+            index.insert(s);
+        }
+        break;
+    }
+    case log_record_type::erase: {
+        auto id = block_id_type();
+        fc::raw::unpack(ds, id);
+        index.erase(id);
+        break;
+    }
+    case log_record_type::validity: {
+        auto id    = block_id_type();
+        auto valid = false;
+        fc::raw::unpack(ds, id);
+        fc::raw::unpack(ds, valid);
+
+        auto itr = index.find(id);
+        if(itr != index.end()) {
+            (*itr)->validated = valid;
+        }
+        break;
+    }
+    case log_record_type::in_current_chain: {
+        auto id               = block_id_type();
+        auto in_current_chain = false;
+        fc::raw::unpack(ds, id);
+        fc::raw::unpack(ds, in_current_chain);
+
+        auto itr = index.find(id);
+        if(itr != index.end()) {
+            index.modify(itr, [&](auto& bsp) { bsp->in_current_chain = in_current_chain; });
+        }
+        break;
+    }
+    case log_record_type::confirmation: {
+        auto c = header_confirmation();
+        fc::raw::unpack(ds, c);
+        self.add(c);
+        break;
+    }
+    case log_record_type::head: {
+        auto id = block_id_type();
+        fc::raw::unpack(ds, id);
+        head = self.get_block(id);
+        break;
+    }
+    default: {
+        jmzk_THROW(fork_database_exception, "Unknown fork database log record type: ${t}", ("t", type));
+    }
+    }  // switch
+}
+
+/**
+ *  Replays the log on top of the snapshot, returns false when there is no log usable.
+ *  The records after the first broken one (torn by crash) are dropped.
+ */
+bool
+fork_database_impl::replay_log(fork_database& self) {
+    auto log_path = datadir / config::forkdb_log_filename;
+    if(!fc::exists(log_path)) {
+        return false;
+    }
+
+    auto content = string();
+    fc::read_file_contents(log_path, content);
+    if(content.size() < log_header_size) {
+        return false;
+    }
+
+    auto magic      = uint32_t();
+    auto generation = uint64_t();
+    memcpy(&magic, content.data(), sizeof(magic));
+    memcpy(&generation, content.data() + sizeof(magic), sizeof(generation));
+    if(magic != forkdb_magic || generation != log_generation) {
+        wlog("Fork database log (generation: ${g}) doesn't match snapshot (generation: ${s}), discard it",
+            ("g", generation)("s", log_generation));
+        return false;
+    }
+
+    auto offset  = log_header_size;
+    auto records = 0u;
+    while(content.size() - offset >= record_header_size) {
+        auto len      = uint32_t();
+        auto checksum = uint64_t();
+        memcpy(&len, content.data() + offset, sizeof(len));
+        memcpy(&checksum, content.data() + offset + sizeof(len), sizeof(checksum));
+
+        auto data = content.data() + offset + record_header_size;
+        if(content.size() - offset - record_header_size < len || fc::city_hash64(data, len) != checksum) {
+            break;
+        }
+
+        try {
+            apply_record(self, data, len);
+        }
+        catch(const fc::exception& e) {
+            wlog("Failed to replay fork database log record at ${o}: ${e}", ("o", offset)("e", e.to_detail_string()));
+        }
+        offset += record_header_size + len;
+        records++;
+    }
+
+    if(offset < content.size()) {
+        wlog("Fork database log is broken at ${o}, drop the remaining ${n} bytes", ("o", offset)("n", content.size() - offset));
+        fc::resize_file(log_path, offset);
+    }
+    ilog("Replayed ${n} records from fork database log", ("n", records));
+
+    return true;
+}
+
+void
+fork_database_impl::open_log(bool truncate) {
+    close_log();
+
+    auto log_path = datadir / config::forkdb_log_filename;
+    auto flags    = O_WRONLY | O_CREAT | O_APPEND | (truncate ? O_TRUNC : 0);
+
+    log_fd = ::open(log_path.generic_string().c_str(), flags, 0644);
+    jmzk_ASSERT(log_fd >= 0, fork_database_exception, "Failed to open fork database log: ${e}", ("e", strerror(errno)));
+
+    if(!truncate) {
+        log_size = fc::file_size(log_path);
+    }
+    else {
+        char header[log_header_size];
+        memcpy(header, &forkdb_magic, sizeof(forkdb_magic));
+        memcpy(header + sizeof(forkdb_magic), &log_generation, sizeof(log_generation));
+        write_log(header, sizeof(header));
+        sync_log();
+        log_size = log_header_size;
+    }
+}
+
+void
+fork_database_impl::read_snapshot(fork_database& self) {
+    auto fork_db_dat = datadir / config::forkdb_filename;
+    if(!fc::exists(fork_db_dat)) {
+        return;
+    }
+
+    string content;
+    fc::read_file_contents(fork_db_dat, content);
+
+    fc::datastream<const char*> ds(content.data(), content.size());
+
+    auto magic = uint32_t();
+    if(content.size() >= log_header_size) {
+        memcpy(&magic, content.data(), sizeof(magic));
+    }
+    if(magic == forkdb_magic) {
+        ds.skip(sizeof(magic));
+        fc::raw::unpack(ds, log_generation);
+    }
+    // otherwise it's written by the versions without log, treats it as generation 0
+
+    unsigned_int size;
+    fc::raw::unpack(ds, size);
+    for(uint32_t i = 0, n = size.value; i < n; ++i) {
+        block_state s;
+        fc::raw::unpack(ds, s);
+        self.set(std::make_shared<block_state>(move(s)));
+    }
+    block_id_type head_id;
+    fc::raw::unpack(ds, head_id);
+
+    head = self.get_block(head_id);
+}
+
+void
+fork_database_impl::write_snapshot() {
+    auto fork_db_dat = datadir / config::forkdb_filename;
+    auto fork_db_tmp = datadir / (string(config::forkdb_filename) + ".tmp");
+
+    {
+        std::ofstream out(fork_db_tmp.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc);
+        fc::raw::pack(out, forkdb_magic);
+        fc::raw::pack(out, log_generation);
+
+        uint32_t num_blocks_in_fork_db = index.size();
+        fc::raw::pack(out, unsigned_int{num_blocks_in_fork_db});
+        for(const auto& s : index) {
+            fc::raw::pack(out, *s);
+        }
+        if(head)
+            fc::raw::pack(out, head->id);
+        else
+            fc::raw::pack(out, block_id_type());
+
+        out.flush();
+        jmzk_ASSERT(out.good(), fork_database_exception, "Failed to write fork database snapshot");
+    }
+    sync_path(fork_db_tmp, false);
+    fc::rename(fork_db_tmp, fork_db_dat);
+    sync_path(datadir, true);
+}
+
+void
+fork_database_impl::compact() {
+    log_generation++;
+    write_snapshot();
+    open_log(true);
+}
+
 fork_database::fork_database(const fc::path& data_dir)
     : my(new fork_database_impl()) {
     my->datadir = data_dir;
@@ -56,45 +403,33 @@ fork_database::fork_database(const fc::path& data_dir)
     if(!fc::is_directory(my->datadir))
         fc::create_directories(my->datadir);
 
-    auto fork_db_dat = my->datadir / config::forkdb_filename;
-    if(fc::exists(fork_db_dat)) {
-        string content;
-        fc::read_file_contents(fork_db_dat, content);
-
-        fc::datastream<const char*> ds(content.data(), content.size());
-        unsigned_int size;
-        fc::raw::unpack(ds, size);
-        for(uint32_t i = 0, n = size.value; i < n; ++i) {
-            block_state s;
-            fc::raw::unpack(ds, s);
-            set(std::make_shared<block_state>(move(s)));
-        }
-        block_id_type head_id;
-        fc::raw::unpack(ds, head_id);
+    // log is opened after replay so nothing is appended to it meanwhile
+    my->read_snapshot(*this);
+    auto replayed = my->replay_log(*this);
+    my->open_log(!replayed);
 
-        my->head = get_block(head_id);
-
-        fc::remove(fork_db_dat);
+    if(my->log_size > config::forkdb_log_compaction_size) {
+        my->compact();
     }
 }
 
 void
 fork_database::close() {
+    if(my->log_fd < 0) {
+        // closed already
+        return;
+    }
     if(my->index.size() == 0) {
+        // nothing to keep, leaves no stale state to be loaded by next start
+        my->close_log();
+        fc::remove(my->datadir / config::forkdb_filename);
+        fc::remove(my->datadir / config::forkdb_log_filename);
         return;
     }
 
-    auto fork_db_dat = my->datadir / config::forkdb_filename;
-    std::ofstream out(fork_db_dat.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc);
-    uint32_t num_blocks_in_fork_db = my->index.size();
-    fc::raw::pack(out, unsigned_int{num_blocks_in_fork_db});
-    for(const auto& s : my->index) {
-        fc::raw::pack(out, *s);
-    }
-    if(my->head)
-        fc::raw::pack(out, my->head->id);
-    else
-        fc::raw::pack(out, block_id_type());
+    // snapshot has the whole state now, then nothing is logged after log is closed
+    my->compact();
+    my->close_log();
 
     /// we don't normally indicate the head block as irreversible
     /// we cannot normally prune the lib if it is the head block because
@@ -127,6 +462,9 @@ fork_database::set(block_state_ptr s) {
     else if(my->head->block_num < s->block_num) {
         my->head = s;
     }
+
+    my->append(log_record_type::insert, *s);
+    my->append(log_record_type::head, my->head->id);
 }
 
 block_state_ptr
@@ -145,6 +483,9 @@ fork_database::add(const block_state_ptr& n, bool skip_validate_previous) {
 
     my->head = *my->index.get<by_lib_block_num>().begin();
 
+    my->append(log_record_type::insert, *n);
+    my->append(log_record_type::head, my->head->id);
+
     auto lib    = my->head->dpos_irreversible_blocknum;
     auto oldest = *my->index.get<by_block_num>().begin();
 
@@ -152,6 +493,11 @@ fork_database::add(const block_state_ptr& n, bool skip_validate_previous) {
         prune(oldest);
     }
 
+    if(my->log_size > config::forkdb_log_compaction_size) {
+        my->compact();
+    }
+    my->sync_log();
+
     return n;
 }
 
@@ -223,8 +569,10 @@ fork_database::remove(const block_id_type& id) {
 
     for(uint32_t i = 0; i < remove_queue.size(); ++i) {
         auto itr = my->index.find(remove_queue[i]);
-        if(itr != my->index.end())
+        if(itr != my->index.end()) {
             my->index.erase(itr);
+            my->append(log_record_type::erase, remove_queue[i]);
+        }
 
         auto& previdx = my->index.get<by_prev>();
         auto  previtr = previdx.lower_bound(remove_queue[i]);
@@ -235,6 +583,7 @@ fork_database::remove(const block_id_type& id) {
     }
     // wdump((my->index.size()));
     my->head = *my->index.get<by_lib_block_num>().begin();
+    my->append(log_record_type::head, my->head->id);
 }
 
 void
@@ -245,7 +594,9 @@ fork_database::set_validity(const block_state_ptr& h, bool valid) {
     else {
         /// remove older than irreversible and mark block as valid
         h->validated = true;
+        my->append(log_record_type::validity, h->id, true);
     }
+    my->sync_log();
 }
 
 void
@@ -261,6 +612,7 @@ fork_database::mark_in_current_chain(const block_state_ptr& h, bool in_current_c
         itr, [&](auto& bsp) {  // Need to modify this way rather than directly so that Boost MultiIndex can re-sort
             bsp->in_current_chain = in_current_chain;
         });
+    my->append(log_record_type::in_current_chain, h->id, in_current_chain);
 }
 
 void
@@ -278,6 +630,7 @@ fork_database::prune(const block_state_ptr& h) {
     if(itr != my->index.end()) {
         irreversible(*itr);
         my->index.erase(itr);
+        my->append(log_record_type::erase, h->id);
     }
 
     auto& numidx = my->index.get<by_block_num>();
@@ -318,6 +671,7 @@ fork_database::add(const header_confirmation& c) {
     auto b = get_block(c.block_id);
     jmzk_ASSERT(b, fork_db_block_not_found, "unable to find block id ${id}", ("id", c.block_id));
     b->add_confirmation(c);
+    my->append(log_record_type::confirmation, c);
 
     if(b->bft_irreversible_blocknum < b->block_num
        && b->confirmations.size() >= ((b->active_schedule.producers.size() * 2) / 3 + 1)) {
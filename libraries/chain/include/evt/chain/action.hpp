@@ -4,6 +4,9 @@
  */
 #pragma once
 #include <any>
+#include <forward_list>
+#include <memory>
+#include <mutex>
 #include <type_traits>
 #include <jmzk/chain/types.hpp>
 #include <jmzk/chain/exceptions.hpp>
@@ -14,49 +17,95 @@ class apply_context;
 class authority_checker;
 class charge_manager;
 
+/**
+ *  Immutable payload of action, the raw bytes and the decoded value are shared by all the copies
+ *  of one action, like the ones in traces and generated actions.
+ *  So copying an action never copies the bytes, and the bytes are decoded at most once.
+ *  Assigning new bytes or value replaces the payload and leaves the old copies untouched.
+ */
+class action_data {
+private:
+    struct payload {
+        payload(bytes&& raw) : raw(std::move(raw)) {}
+
+        const bytes    raw;
+        std::once_flag decoded;
+        std::any       value;
+
+        // values decoded as other types than the first one, like v1 and v2 of the same action
+        std::mutex                  others_mutex;
+        std::forward_list<std::any> others;
+    };
+
+public:
+    action_data() = default;
+    action_data(const bytes& raw) : payload_(std::make_shared<payload>(bytes(raw))) {}
+    action_data(bytes&& raw) : payload_(std::make_shared<payload>(std::move(raw))) {}
+
+    template<typename T>
+    static action_data
+    from_value(const T& value) {
+        auto d = action_data(fc::raw::pack(value));
+        std::call_once(d.payload_->decoded, [&] { d.payload_->value = std::make_any<T>(value); });
+        return d;
+    }
+
+public:
+    const bytes&
+    raw() const {
+        static const auto empty = bytes();
+        return payload_ ? payload_->raw : empty;
+    }
+
+    operator const bytes&() const { return raw(); }
+
+    const char* data() const { return raw().data(); }
+    size_t      size() const { return raw().size(); }
+    bool        empty() const { return raw().empty(); }
+
+    // decodes the bytes once per type, thread-safe as the payload may be shared across threads
+    template<typename T>
+    const T&
+    value() const {
+        FC_ASSERT(payload_);
+
+        auto& p = *payload_;
+        std::call_once(p.decoded, [&p] { p.value = std::make_any<T>(fc::raw::unpack<T>(p.raw)); });
+        if(auto v = std::any_cast<T>(&p.value)) {
+            return *v;
+        }
+
+        // decoded as another type before, rare enough to be kept behind a lock
+        auto lock = std::lock_guard<std::mutex>(p.others_mutex);
+        for(auto& o : p.others) {
+            if(auto v = std::any_cast<T>(&o)) {
+                return *v;
+            }
+        }
+        // list keeps the references returned before valid
+        return *std::any_cast<T>(&p.others.emplace_front(std::make_any<T>(fc::raw::unpack<T>(p.raw))));
+    }
+
+private:
+    std::shared_ptr<payload> payload_;
+};
+
 struct action {
 public:
     action_name name;
     domain_name domain;
     domain_key  key;
-    bytes       data;
+    action_data data;
 
 public:
     action() : index_(-1) {}
 
-    // don't copy cache_ when in copy ctor.
-    action(const action& lhs)
-        : name(lhs.name)
-        , domain(lhs.domain)
-        , key(lhs.key)
-        , data(lhs.data)
-        , index_(lhs.index_)
-        , cache_() {}
-
+    // copies share the payload of data, including the decoded value
+    action(const action& lhs) = default;
     action(action&& lhs) noexcept = default;
 
-    action& operator=(const action& lhs) {
-        if(this != &lhs) { // self-assignment check expected
-            name   = lhs.name;
-            domain = lhs.domain;
-            key    = lhs.key;
-            data   = lhs.data;
-            index_ = lhs.index_;
-        }
-        return *this;
-    }
-
-    action& operator=(action&& lhs) noexcept {
-        if(this != &lhs) { // self-assignment check expected
-            name   = lhs.name;
-            domain = lhs.domain;
-            key    = lhs.key;
-            data   = lhs.data;
-            index_ = lhs.index_;
-            cache_ = std::move(lhs.cache_);
-        }
-        return *this;
-    }
+    action& operator=(const action& lhs) = default;
+    action& operator=(action&& lhs) noexcept = default;
 
 public:
     template<typename T>
@@ -64,9 +113,8 @@ public:
         : name(T::get_action_name())
         , domain(domain)
         , key(key)
-        , data(fc::raw::pack(value))
-        , index_(-1)
-        , cache_(std::make_any<T>(value)) {}
+        , data(action_data::from_value(value))
+        , index_(-1) {}
 
     action(const action_name name, const domain_name& domain, const domain_key& key, const bytes& data)
         : name(name)
@@ -78,8 +126,7 @@ public:
     template<typename T>
     void
     set_data(const T& value) {
-        data   = fc::raw::pack(value);
-        cache_ = std::make_any<T>(value);
+        data = action_data::from_value(value);
     }
 
     void
@@ -87,23 +134,17 @@ public:
         index_ = index;
     }
 
-    // if T is a reference, will return the reference to the internal cache value
+    // if T is a reference, will return the const reference to the shared decoded value
     // Otherwise if T is a value type, will return new copy. 
-    template <typename T>
-    T
+    template <typename T, typename raw_type = std::remove_const_t<std::remove_reference_t<T>>>
+    std::conditional_t<std::is_reference_v<T>, const raw_type&, raw_type>
     data_as() const {
-        if(!cache_.has_value()) {
-            using raw_type = std::remove_const_t<std::remove_reference_t<T>>;
-            jmzk_ASSERT(name == raw_type::get_action_name(), action_type_exception, "action name is not consistent with action struct");
-            cache_ = std::make_any<raw_type>(fc::raw::unpack<raw_type>(data));
-        }
-        // no need to check name here, `any_cast` will throws exception if types don't match
-        return std::any_cast<T>(cache_);
+        jmzk_ASSERT(name == raw_type::get_action_name(), action_type_exception, "action name is not consistent with action struct");
+        return data.value<raw_type>();
     }
 
 private:
-    mutable int      index_;
-    mutable std::any cache_;
+    mutable int index_;
 
 private:
     friend class apply_context;
@@ -113,4 +154,46 @@ private:
 
 }}  // namespace jmzk::chain
 
+namespace fc {
+
+inline void
+to_variant(const jmzk::chain::action_data& data, fc::variant& v) {
+    to_variant(data.raw(), v);
+}
+
+inline void
+from_variant(const fc::variant& v, jmzk::chain::action_data& data) {
+    auto raw = jmzk::chain::bytes();
+    from_variant(v, raw);
+    data = std::move(raw);
+}
+
+namespace raw {
+
+using jmzk::chain::action_data;
+
+template<>
+struct packer<action_data> {
+    template<typename Stream>
+    static void
+    pack(Stream& out, const action_data& data) {
+        fc::raw::pack(out, data.raw());
+    }
+};
+
+template<>
+struct unpacker<action_data> {
+    template<typename Stream>
+    static void
+    unpack(Stream& in, action_data& data) {
+        auto raw = jmzk::chain::bytes();
+        fc::raw::unpack(in, raw);
+        data = std::move(raw);
+    }
+};
+
+}  // namespace raw
+
+}  // namespace fc
+
 FC_REFLECT(jmzk::chain::action, (name)(domain)(key)(data));
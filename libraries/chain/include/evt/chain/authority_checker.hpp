@@ -4,6 +4,7 @@
  */
 #pragma once
 #include <functional>
+#include <map>
 
 #include <fc/scoped_exit.hpp>
 
@@ -105,6 +106,7 @@ public:
 
 public:
     template<uint64_t> friend struct internal::check_authority;
+    friend struct authority_checker_test;  // compares the two ways of checking groups
 
 public:
     authority_checker(const controller& control, const jmzk_execution_context& exec_ctx, const public_keys_set& signing_keys, uint32_t max_recursion_depth, bool check_script = true)
@@ -259,11 +261,88 @@ private:
         return false;
     }
 
+    /**
+     * Same as `satisfied_node` from the root but runs over the compiled form without recursion.
+     * Children are evaluated in order and stop as soon as their parent is satisfied,
+     * so the same keys are marked as used as the node by node walk.
+     */
+    bool
+    satisfied_compiled(const compiled_group& cg) {
+        struct frame {
+            uint32_t threshold;
+            uint32_t weight;
+            uint32_t end;
+            uint32_t total;
+        };
+
+        // index of signing key of each distinct group key, -1 if it's not signed
+        auto signers = small_vector<int, 16>(cg.keys.size(), -1);
+        auto i       = 0;
+        for(auto& key : signing_keys_) {
+            auto it = cg.keys.find(key);
+            if(it != cg.keys.end()) {
+                signers[it->second] = i;
+            }
+            i++;
+        }
+
+        auto& entries = cg.entries;
+        auto& root    = entries[0];
+        FC_ASSERT(max_recursion_depth_ > 0);
+
+        auto frames = small_vector<frame, 8>();
+        frames.emplace_back(frame { root.threshold, root.weight, root.end, 0 });
+
+        auto pos = 1u;
+        while(true) {
+            auto& f = frames.back();
+            if(f.total >= f.threshold || pos == f.end) {
+                auto satisfied = f.total >= f.threshold;
+                auto weight    = f.weight;
+
+                pos = f.end;
+                frames.pop_back();
+                if(frames.empty()) {
+                    return satisfied;
+                }
+                if(satisfied) {
+                    frames.back().total += weight;
+                }
+                continue;
+            }
+
+            auto& e = entries[pos];
+            FC_ASSERT(e.weight != 0);  // child cannot be root
+            if(e.threshold == 0) {
+                // leaf node
+                if(signers[e.key] >= 0) {
+                    used_keys_[signers[e.key]] = true;
+                    f.total += e.weight;
+                }
+                pos++;
+            }
+            else {
+                FC_ASSERT(e.depth < max_recursion_depth_);
+                frames.emplace_back(frame { e.threshold, e.weight, e.end, 0 });
+                pos++;
+            }
+        }
+    }
+
+    bool
+    satisfied_root(const group& group) {
+        auto cg = group.compiled();
+        if(cg) {
+            return satisfied_compiled(*cg);
+        }
+        return satisfied_node(group, group.root(), 0);
+    }
+
     bool
     satisfied_group(const group_name& name) {
         bool result = false;
         get_group(name, [&](const auto& group) {
-            if(satisfied_node(group, group.root(), 0)) {
+            if(satisfied_root(group)) {
                 result = true;
             }
         });
@@ -398,6 +477,26 @@ private:
     }
 
 public:
+    // reads the tokens whose owners are checked by the NFT actions of `trx` in one batch per domain,
+    // the checks of the actions then find them in the object cache
+    void
+    prefetch_nft_owners(const transaction& trx) {
+        auto names = std::map<domain_name, small_vector<name128, 4>>();
+        for(auto& act : trx.actions) {
+            if(act.name == N(transfer) || act.name == N(destroytoken)) {
+                names[act.domain].emplace_back(act.key);
+            }
+        }
+        for(auto& it : names) {
+            if(it.second.size() < 2) {
+                // single token is read by the check itself
+                continue;
+            }
+            // missing tokens are reported by the checks
+            tokendb_cache_.read_tokens<token_def>(token_type::token, it.first, it.second, true /* no throw */);
+        }
+    }
+
     bool
     satisfied(const action& act) {
         using namespace internal;
@@ -717,7 +816,7 @@ struct check_authority<N(addmeta)> {
             case authorizer_ref::group_t: {
                 auto& name = ref.get_group();
                 checker->get_group(name, [&](const auto& group) {
-                    if(checker->satisfied_node(group, group.root(), 0)) {
+                    if(checker->satisfied_root(group)) {
                         ref_result = true;
                     }
                 });
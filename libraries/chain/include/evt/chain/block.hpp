@@ -3,6 +3,8 @@
  *  @copyright defined in jmzk/LICENSE.txt
  */
 #pragma once
+#include <mutex>
+#include <optional>
 #include <jmzk/chain/block_header.hpp>
 #include <jmzk/chain/transaction.hpp>
 
@@ -55,6 +57,60 @@ struct transaction_receipt : public transaction_receipt_header {
     }
 };
 
+/**
+ *  Caches the id of a block, it can be read from multiple threads.
+ */
+class block_id_cache {
+public:
+    block_id_cache() = default;
+    block_id_cache(const block_id_cache& rhs) : value_(rhs.get()) {}
+
+    block_id_cache&
+    operator=(const block_id_cache& rhs) {
+        if(this != &rhs) {
+            auto v    = rhs.get();
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            value_    = v;
+        }
+        return *this;
+    }
+
+public:
+    template<typename Func>
+    block_id_type
+    get_or_compute(Func&& func) const {
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            if(value_.has_value()) {
+                return *value_;
+            }
+        }
+
+        // computes without holding the lock, racing threads get the same id
+        auto id   = func();
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        value_    = id;
+        return id;
+    }
+
+    void
+    reset() {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        value_.reset();
+    }
+
+private:
+    std::optional<block_id_type>
+    get() const {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        return value_;
+    }
+
+private:
+    mutable std::mutex                   mutex_;
+    mutable std::optional<block_id_type> value_;
+};
+
 struct signed_block : public signed_block_header {
 public:
     signed_block() = default;
@@ -64,9 +120,20 @@ public:
 
     explicit signed_block(const signed_block_header& h) : signed_block_header(h) {}
 
+public:
+    /**
+     *  Id is computed once and shared by all the holders of the block, so the header
+     *  should only be changed via `set_header` after the id is read.
+     */
+    block_id_type id() const;
+    void          set_header(const signed_block_header& h);
+
 public:
     small_vector<transaction_receipt, 4> transactions;  /// new or generated transactions
     extensions_type                      block_extensions;
+
+private:
+    block_id_cache cached_id;
 };
 using signed_block_ptr = std::shared_ptr<signed_block>;
 
@@ -39,6 +39,9 @@ struct block_header {
     digest_type   digest() const;
     block_id_type id() const;
 
+    // id is the digest of the header with the block num stored in the first 32 bits
+    static block_id_type id_from_digest(const digest_type& digest, uint32_t block_num);
+
     uint32_t
     block_num() const {
         return num_from_id(previous) + 1;
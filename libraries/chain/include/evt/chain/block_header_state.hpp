@@ -3,6 +3,7 @@
  *  @copyright defined in jmzk/LICENSE.txt
  */
 #pragma once
+#include <optional>
 #include <jmzk/chain/block_header.hpp>
 #include <jmzk/chain/incremental_merkle.hpp>
 
@@ -57,10 +58,22 @@ struct block_header_state {
 
     const block_id_type& prev() const { return header.previous; }
 
+    /**
+     *  Sets `id` and caches the signing digest from one hash of the header, it's called once
+     *  the header is completed. Changing the header or the producer schedule resets the cache.
+     */
+    void compute_digests();
+
     digest_type     sig_digest() const;
     void            sign(const std::function<signature_type(const digest_type&)>& signer);
     public_key_type signee() const;
     void            verify_signee(const public_key_type& signee)const;
+
+private:
+    digest_type sig_digest(const digest_type& header_digest) const;
+
+private:
+    std::optional<digest_type> cached_sig_digest;  // not reflected
 };
 
 }}  // namespace jmzk::chain
@@ -19,9 +19,12 @@ const static auto default_token_database_dir_name  = "tokendb";
 const static auto default_reversible_cache_size    = 340*1024*1024ll;  /// 1MB * 340 blocks based on 21 producer BFT delay
 const static auto default_reversible_guard_size    = 2*1024*1024ll;    /// 1MB * 2 blocks based on 21 producer BFT delay
 const static auto token_database_persisit_filename = "savepoints.log";
+const static auto token_database_journal_filename  = "savepoints.journal";
 
 const static auto default_state_dir_name        = "state";
 const static auto forkdb_filename               = "forkdb.dat";
+const static auto forkdb_log_filename           = "forkdb.log";
+const static auto forkdb_log_compaction_size    = 32*1024*1024ll;  /// compact the fork database log into forkdb.dat beyond this size
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      = 128*1024*1024ll;
 
@@ -54,6 +57,8 @@ const static uint32_t default_global_charge_factor       = 10;
 
 const static uint32_t default_abi_serializer_max_time_ms = 50; ///< default deadline for abi serialization methods
 
+const static uint16_t default_controller_thread_pool_size = 2;
+
 /**
  *  The number of sequential blocks produced by a single producer
  */
@@ -281,10 +281,7 @@ get_db_prefix<token_def>(const token_def& v) {
 
 #define READ_DB_ASSET(ADDR, SYM, VALUEREF)                                                              \
     try {                                                                                               \
-        auto str = std::string();                                                                       \
-        tokendb.read_asset(ADDR, SYM.id(), str);                                                        \
-                                                                                                        \
-        extract_db_value(str, VALUEREF);                                                                \
+        tokendb.read_asset_view(ADDR, SYM.id(), [&](auto& v) { extract_db_value(v, VALUEREF); });       \
     }                                                                                                   \
     catch(token_database_exception&) {                                                                  \
         jmzk_THROW2(balance_exception, "There's no balance left in {} with sym id: {}", ADDR, SYM.id()); \
@@ -293,8 +290,8 @@ get_db_prefix<token_def>(const token_def& v) {
 
 #define READ_DB_ASSET_NO_THROW(ADDR, SYM, VALUEREF)                         \
     {                                                                       \
-        auto str = std::string();                                           \
-        if(!tokendb.read_asset(ADDR, SYM.id(), str, true /* no throw */)) { \
+        auto read = [&](auto& v) { extract_db_value(v, VALUEREF); };        \
+        if(!tokendb.read_asset_view(ADDR, SYM.id(), read, true)) {          \
             if constexpr(std::is_same_v<decltype(VALUEREF), property>) {    \
                 VALUEREF = MAKE_PROPERTY(0, SYM);                           \
             }                                                               \
@@ -305,15 +302,14 @@ get_db_prefix<token_def>(const token_def& v) {
                 ft_holder { .addr = ADDR, .sym_id = SYM.id() });            \
         }                                                                   \
         else {                                                              \
-            extract_db_value(str, VALUEREF);                                \
             CHECK_SYM(VALUEREF, SYM);                                       \
         }                                                                   \
     }
 
 #define READ_DB_ASSET_NO_THROW_NO_NEW(ADDR, SYM, VALUEREF)                  \
     {                                                                       \
-        auto str = std::string();                                           \
-        if(!tokendb.read_asset(ADDR, SYM.id(), str, true /* no throw */)) { \
+        auto read = [&](auto& v) { extract_db_value(v, VALUEREF); };        \
+        if(!tokendb.read_asset_view(ADDR, SYM.id(), read, true)) {          \
             if constexpr(std::is_same_v<decltype(VALUEREF), property>){     \
                 VALUEREF = MAKE_PROPERTY(0, SYM);                           \
             }                                                               \
@@ -322,7 +318,6 @@ get_db_prefix<token_def>(const token_def& v) {
             }                                                               \
         }                                                                   \
         else {                                                              \
-            extract_db_value(str, VALUEREF);                                \
             CHECK_SYM(VALUEREF, SYM);                                       \
         }                                                                   \
     }
@@ -39,7 +39,7 @@ jmzk_ACTION_IMPL_BEGIN(everipass) {
             }
         }
 
-        auto keys  = link.restore_keys();
+        auto keys  = context.trx_context.trx_meta->get_link_keys(link);
         auto token = make_empty_cache_ptr<token_def>();
         READ_DB_TOKEN(token_type::token, d, t, token, unknown_token_exception, "Cannot find token: {} in {}", t, d);
 
@@ -144,7 +144,7 @@ jmzk_ACTION_IMPL_BEGIN(everipay) {
         ADD_DB_TOKEN(token_type::jmzklink, link_obj);
 
         // check signature
-        auto keys = link.restore_keys();
+        auto keys = context.trx_context.trx_meta->get_link_keys(link);
         jmzk_ASSERT(keys.size() == 1, everipay_exception, "There're more than one signature on everiPay link, which is invalid");
         
         // check payee
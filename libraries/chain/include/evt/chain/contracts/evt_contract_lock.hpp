@@ -102,10 +102,12 @@ jmzk_ACTION_IMPL_BEGIN(newlock) {
             case asset_type::tokens: {
                 auto& tokens = la.template get<locknft_def>();
 
-                for(auto& tn : tokens.names) {
-                    auto token = make_empty_cache_ptr<token_def>();
-                    READ_DB_TOKEN(token_type::token, tokens.domain, tn, token, unknown_token_exception,
-                        "Cannot find token: {} in {}", tn, tokens.domain);
+                // all the tokens are read in one batch
+                auto ptrs = tokendb_cache.template read_tokens<token_def>(token_type::token, tokens.domain, tokens.names, true /* no throw */);
+                for(auto i = 0u; i < ptrs.size(); i++) {
+                    auto& token = ptrs[i];
+                    jmzk_ASSERT2(token != nullptr, unknown_token_exception,
+                        "Cannot find token: {} in {}", tokens.names[i], tokens.domain);
                     token->owner = { laddr };
 
                     UPD_DB_TOKEN(token_type::token, *token);
@@ -220,10 +222,11 @@ jmzk_ACTION_IMPL_BEGIN(tryunlock) {
             case asset_type::tokens: {
                 auto& tokens = la.template get<locknft_def>();
 
-                for(auto& tn : tokens.names) {
-                    auto token = make_empty_cache_ptr<token_def>();
-                    READ_DB_TOKEN(token_type::token, tokens.domain, tn, token, unknown_token_exception,
-                        "Cannot find token: {} in {}", tn, tokens.domain);
+                auto ptrs = tokendb_cache.template read_tokens<token_def>(token_type::token, tokens.domain, tokens.names, true /* no throw */);
+                for(auto i = 0u; i < ptrs.size(); i++) {
+                    auto& token = ptrs[i];
+                    jmzk_ASSERT2(token != nullptr, unknown_token_exception,
+                        "Cannot find token: {} in {}", tokens.names[i], tokens.domain);
                     token->owner = *pkeys;
                     UPD_DB_TOKEN(token_type::token, *token);
                 }
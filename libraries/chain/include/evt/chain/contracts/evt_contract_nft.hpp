@@ -74,9 +74,16 @@ jmzk_ACTION_IMPL_BEGIN(issuetoken) {
         jmzk_ASSERT2(tokendb.exists_token(token_type::domain, std::nullopt, itact.domain), unknown_domain_exception,
             "Cannot find domain: {}.", itact.domain);
 
-        auto check_name = [&](const auto& name) {
+        // existence of all the names is checked in one batch
+        auto exists = small_vector<bool, 4>(itact.names.size(), false);
+        tokendb.read_tokens(token_type::token, itact.domain, itact.names, [&](auto i, auto& v) {
+            exists[i] = true;
+        });
+
+        auto check_name = [&](const auto i) {
+            auto& name = itact.names[i];
             check_name_reserved(name);
-            jmzk_ASSERT2(!tokendb.exists_token(token_type::token, itact.domain, name), token_duplicate_exception,
+            jmzk_ASSERT2(!exists[i], token_duplicate_exception,
                 "Token: {} in {} is already exists.", name, itact.domain);
         };
 
@@ -89,10 +96,10 @@ jmzk_ACTION_IMPL_BEGIN(issuetoken) {
         token.domain = itact.domain;
         token.owner  = itact.owner;
 
-        for(auto& n : itact.names) {
-            check_name(n);
+        for(auto i = 0u; i < itact.names.size(); i++) {
+            check_name(i);
 
-            token.name = n;
+            token.name = itact.names[i];
             values.emplace_back(make_db_value(token));
             data.emplace_back(values.back().as_string_view());
         }
@@ -6,6 +6,10 @@
 
 #include <string>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <fc/reflect/reflect.hpp>
 #include <jmzk/chain/types.hpp>
 #include <jmzk/chain/address.hpp>
@@ -13,6 +17,87 @@
 
 namespace jmzk { namespace chain { namespace contracts {
 
+class group;
+
+/**
+ * Flattened form of a group used by authority checks.
+ * Nodes are expanded in pre-order and each non-leaf entry records where its subtree ends, so a tree is
+ * evaluated in one forward pass and the rest of a satisfied node's children can be skipped at once.
+ * Leaf keys are deduplicated and indexed by hash, signing keys are matched against that index
+ * instead of scanning them for every leaf.
+ */
+struct compiled_group {
+public:
+    struct entry {
+        weight_type weight;
+        weight_type threshold;  // zero for leaf nodes
+        uint16_t    depth;      // depth of non-leaf nodes, root is zero
+        uint16_t    key;        // index of distinct key for leaf nodes
+        uint32_t    end;        // index of the entry following this subtree
+    };
+
+    static constexpr size_t kMaxEntries = std::numeric_limits<uint16_t>::max();
+    static constexpr size_t kMaxDepth   = std::numeric_limits<uint8_t>::max();
+
+public:
+    /**
+     * Returns nullptr when the group cannot be flattened, i.e. it's empty, has a leaf root,
+     * refers to nodes or keys out of range, or expands over `kMaxEntries` nodes or `kMaxDepth` levels.
+     * Those groups are still evaluated node by node.
+     */
+    static std::shared_ptr<const compiled_group> compile(const group& group);
+
+public:
+    std::vector<entry>                            entries;
+    std::unordered_map<public_key_type, uint16_t> keys;
+};
+
+/**
+ * Holds the compiled form of a group, it's built on first use and
+ * dropped whenever the owning group is copied or assigned.
+ */
+class compiled_group_cache {
+public:
+    compiled_group_cache() = default;
+    compiled_group_cache(const compiled_group_cache&) {}
+
+    compiled_group_cache&
+    operator=(const compiled_group_cache&) {
+        reset();
+        return *this;
+    }
+
+public:
+    std::shared_ptr<const compiled_group>
+    get_or_compile(const group& group) const {
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            if(compiled_) {
+                return value_;
+            }
+        }
+
+        // compiles without holding the lock, racing threads build equal forms
+        auto value = compiled_group::compile(group);
+        auto lock  = std::lock_guard<std::mutex>(mutex_);
+        value_     = value;
+        compiled_  = true;
+        return value;
+    }
+
+    void
+    reset() {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        value_.reset();
+        compiled_ = false;
+    }
+
+private:
+    mutable std::mutex                            mutex_;
+    mutable std::shared_ptr<const compiled_group> value_;
+    mutable bool                                  compiled_ = false;
+};
+
 class group {
 public:
     struct node {
@@ -65,12 +150,18 @@ public:
         return nodes_[n.index + i];
     }
 
+    // cached in the group object, so groups held by token database cache keep it until they're updated
+    std::shared_ptr<const compiled_group> compiled() const { return compiled_.get_or_compile(*this); }
+
 public:
     group_name                       name_;
     address                          key_;
     small_vector<node, 4>            nodes_;
     small_vector<public_key_type, 4> keys_;
     meta_list                        metas_;
+
+private:
+    compiled_group_cache compiled_;
 };
 
 }}}  // namespac jmzk::chain::contracts
@@ -84,4 +175,5 @@ void from_variant(const fc::variant& v, jmzk::chain::contracts::group& group);
 }  // namespace fc
 
 FC_REFLECT(jmzk::chain::contracts::group::node, (weight)(threshold)(index)(size));
+FC_RAW_TRIVIALLY_PACKED(jmzk::chain::contracts::group::node);
 FC_REFLECT(jmzk::chain::contracts::group, (name_)(key_)(nodes_)(keys_)(metas_));
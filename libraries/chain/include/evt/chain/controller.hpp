@@ -16,6 +16,10 @@ namespace chainbase {
 class database;
 }
 
+namespace boost { namespace asio {
+class thread_pool;
+}}  // namespace boost::asio
+
 namespace jmzk { namespace chain {
 
 using unapplied_transactions_type = map<transaction_id_type, transaction_metadata_ptr>;
@@ -72,6 +76,7 @@ public:
         bool     loadtest_mode          = false;
         bool     charge_free_mode       = false;
         bool     contracts_console      = false;
+        uint16_t thread_pool_size       = chain::config::default_controller_thread_pool_size;
 
         std::chrono::microseconds max_serialization_time = std::chrono::milliseconds(chain::config::default_abi_serializer_max_time_ms);
 
@@ -139,6 +144,11 @@ public:
 
     execution_context& get_execution_context() const;
 
+    boost::asio::thread_pool& get_thread_pool();
+
+    // warms token database caches with the keys of the transaction in background, no-op if prefetch is disabled
+    void prefetch_transaction(const transaction_metadata_ptr& trx);
+
     const global_property_object&         get_global_properties() const;
     const dynamic_global_property_object& get_dynamic_global_properties() const;
 
@@ -242,6 +252,7 @@ FC_REFLECT(jmzk::chain::controller::config,
            (loadtest_mode)
            (charge_free_mode)
            (contracts_console)
+           (thread_pool_size)
            (trusted_producers)
            (db_config)
            (genesis)
@@ -22,6 +22,10 @@ typedef vector<block_state_ptr> branch_type;
  * database tracks the longest chain and the last irreversible block number. All
  * blocks older than the last irreversible block are freed after emitting the
  * irreversible signal.
+ *
+ * All the changes are appended to a log in the data dir as they happen and the log is
+ * compacted into a snapshot periodically and at close, so the state survives a crash.
+ * The log is synced when a block is added and when its validity is set.
  */
 class fork_database {
 public:
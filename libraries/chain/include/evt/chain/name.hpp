@@ -10,6 +10,7 @@
 #include <vector>
 #include <fmt/format.h>
 #include <fc/reflect/reflect.hpp>
+#include <fc/io/raw_fwd.hpp>
 
 namespace jmzk { namespace chain {
 using std::string;
@@ -189,3 +190,4 @@ struct formatter<jmzk::chain::name> {
 }  // namespace fmt
 
 FC_REFLECT(jmzk::chain::name, (value));
+FC_RAW_TRIVIALLY_PACKED(jmzk::chain::name);
@@ -24,12 +24,27 @@ class Slice;
 namespace jmzk { namespace chain {
 
 using read_value_func = std::function<bool(const std::string_view& key, std::string&&)>;
+// `value` refers to the memory pinned by database and is only valid inside the call
+using read_view_func  = std::function<void(const std::string_view& value)>;
+// `index` is the position of the key in the batch, only called for the keys found
+using read_batch_func = std::function<void(size_t index, const std::string_view& value)>;
 
 enum class storage_profile {
     disk   = 0,
     memory = 1
 };
 
+enum class db_compression {
+    none = 0,
+    lz4,
+    zstd
+};
+
+enum class db_compaction {
+    level = 0,
+    universal
+};
+
 enum class token_type {
     asset = 0,
     domain,
@@ -57,54 +72,21 @@ enum class action_op {
 struct db_value {
 private:
     static const int kInStakeSize = 1024 * 4;
-    enum { kArray = 0, kString };
-    using data_variant_t = std::variant<std::array<char, kInStakeSize>, std::string>;
-
-public:
-    db_value(const db_value& lhs) : var_(lhs.var_) {
-        set_view();
-    }
-
-    db_value(db_value&& lhs) noexcept : var_(std::move(lhs.var_)) {
-        set_view();
-    }
 
 private:
+    // values are packed in a single pass, the inline buffer is never zero-filled
+    // and copies only move the bytes actually written
     template<typename T>
-    db_value(const T& v) : var_(std::in_place_index_t<kArray>()) {
-        auto sz = fc::raw::pack_size(v);
-        if(sz <= kInStakeSize) {
-            auto& arr = std::get<kArray>(var_);
-            auto  ds  = fc::datastream<char*>(arr.data(), arr.size());
-            fc::raw::pack(ds, v);
-
-            view_ = std::string_view(arr.data(), sz);
-        }
-        else {
-            auto& str = var_.emplace<kString>();
-            str.resize(sz);
-
-            auto ds = fc::datastream<char*>((char*)str.data(), str.size());
-            fc::raw::pack(ds, v);
-
-            view_ = std::string_view(str.data(), sz);
-        }
-    }
-
-    void
-    set_view() {
-        std::visit([this](auto& buf) {
-            view_ = std::string_view(buf.data(), buf.size());
-        }, var_);
+    db_value(const T& v) {
+        fc::raw::pack(ds_, v);
     }
 
 public:
-    std::string_view as_string_view() const { return view_; }
-    size_t size() const { return view_.size(); }
+    std::string_view as_string_view() const { return std::string_view(ds_.data(), ds_.tellp()); }
+    size_t size() const { return ds_.tellp(); }
 
 private:
-    data_variant_t   var_;
-    std::string_view view_;
+    fc::growable_datastream<kInStakeSize> ds_;
 
 public:
     template<typename T>
@@ -119,7 +101,7 @@ make_db_value(const T& v) {
 
 template<typename T>
 void
-extract_db_value(const std::string& str, T& v) {
+extract_db_value(const std::string_view& str, T& v) {
     auto ds = fc::datastream<const char*>(str.data(), str.size());
     fc::raw::unpack(ds, v);
 }
@@ -128,12 +110,36 @@ using token_keys_t = small_vector<name128, 4>;
 
 class token_database : boost::noncopyable {
 public:
+    /**
+     *  Tokens are stored in several column families by their types, each of them has its own block cache,
+     *  so the huge amount of tokens won't evict the hot small objects like domains and groups:
+     *   - meta:    domain, group, suspend, lock, fungible, prodvote, psvbonus, validator, stakepool and script
+     *   - tokens:  token
+     *   - history: jmzklink and psvbonus_dist, appended mostly and seldom read
+     *   - assets:  asset
+     */
+    struct column_config {
+        uint32_t       block_cache_ratio;  // percent of `block_cache_size`
+        uint32_t       bloom_bits;         // bits per key of bloom filter, zero to disable
+        db_compression compression;
+        db_compaction  compaction;
+    };
+
     struct config {
-        storage_profile profile           = storage_profile::disk;
-        uint32_t        block_cache_size  = 256 * 1024 * 1024; // 256M
-        uint32_t        object_cache_size = 256 * 1024 * 1024; // 256M
-        fc::path        db_path           = ::jmzk::chain::config::default_token_database_dir_name;
-        bool            enable_stats      = true;
+        storage_profile profile              = storage_profile::disk;
+        uint32_t        block_cache_size     = 256 * 1024 * 1024; // 256M
+        uint32_t        object_cache_size    = 256 * 1024 * 1024; // 256M
+        fc::path        db_path              = ::jmzk::chain::config::default_token_database_dir_name;
+        bool            enable_stats         = true;
+        bool            enable_undo_log      = false;  // captures old values on write, rollback then needs no reads
+        bool            enable_prefetch      = false;  // warms the caches with the keys of incoming transactions on a background thread
+        bool            enable_journal       = false;  // journals savepoints incrementally instead of persisting all of them on close
+        uint64_t        journal_compact_size = 64 * 1024 * 1024;  // journal is checkpointed when it grows over this size, 64M
+
+        column_config meta_column    = { 15, 10, db_compression::none, db_compaction::universal };
+        column_config tokens_column  = { 55, 10, db_compression::lz4,  db_compaction::level     };
+        column_config history_column = { 5,  10, db_compression::zstd, db_compaction::level     };
+        column_config assets_column  = { 25, 10, db_compression::lz4,  db_compaction::universal };
     };
 
     class session {
@@ -200,6 +206,16 @@ public:
     int read_token(token_type type, const std::optional<name128>& domain, const name128& key, std::string& out, bool no_throw = false) const;
     int read_asset(const address& addr, const symbol_id_type sym_id, std::string& out, bool no_throw = false) const;
 
+    // zero-copy reads, `func` is invoked with the value only if it's found
+    int read_token_view(token_type type, const std::optional<name128>& domain, const name128& key, const read_view_func& func, bool no_throw = false) const;
+    int read_asset_view(const address& addr, const symbol_id_type sym_id, const read_view_func& func, bool no_throw = false) const;
+
+    // batch lookups of the keys in the same type and domain, returns the number of keys found
+    int read_tokens(token_type type, const std::optional<name128>& domain, const small_vector_base<name128>& keys, const read_batch_func& func) const;
+
+    // reads the asset from database only to warm the block cache, safe to be called from other threads
+    void prefetch_asset(const address& addr, const symbol_id_type sym_id) const;
+
     int read_tokens_range(token_type type, const std::optional<name128>& domain, int skip, const read_value_func& func) const;
     int read_assets_range(const symbol_id_type sym_id, int skip, const read_value_func& func) const;
 
@@ -210,6 +226,9 @@ public:
     void pop_back_savepoint();
     void squash();
 
+    // makes the journaled savepoints durable, called when a block is committed. no-op without journal
+    void sync_savepoints();
+
     int64_t latest_savepoint_seq() const;
 
     session new_savepoint_session(int64_t seq);
@@ -238,4 +257,7 @@ private:
 
 }}  // namespace jmzk::chain
 
-FC_REFLECT(jmzk::chain::token_database::config, (profile)(block_cache_size)(object_cache_size)(db_path));
+FC_REFLECT_ENUM(jmzk::chain::db_compression, (none)(lz4)(zstd));
+FC_REFLECT_ENUM(jmzk::chain::db_compaction, (level)(universal));
+FC_REFLECT(jmzk::chain::token_database::column_config, (block_cache_ratio)(bloom_bits)(compression)(compaction));
+FC_REFLECT(jmzk::chain::token_database::config, (profile)(block_cache_size)(object_cache_size)(db_path)(enable_undo_log)(enable_prefetch)(enable_journal)(journal_compact_size)(meta_column)(tokens_column)(history_column)(assets_column));
@@ -3,12 +3,17 @@
  *  @copyright defined in jmzk/LICENSE.txt
 */
 #pragma once
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <boost/type_index.hpp>
 #include <fc/io/datastream.hpp>
 #include <fc/io/raw.hpp>
 #include <rocksdb/cache.h>
 #include <jmzk/chain/token_database.hpp>
+#include <jmzk/utilities/metrics.hpp>
 
 namespace jmzk { namespace chain {
 
@@ -16,10 +21,24 @@ class token_database_cache {
 public:
     token_database_cache(token_database& db, size_t cache_size)
         : db_(db)
-        , cache_(rocksdb::NewLRUCache(cache_size)) {
+        , cache_(rocksdb::NewLRUCache(cache_size))
+        , hits_(utilities::metrics::registry::instance().get_counter(
+            "jmzk_tokendb_cache_lookups_total", "Lookups of token database object cache", {{"result", "hit"}}))
+        , misses_(utilities::metrics::registry::instance().get_counter(
+            "jmzk_tokendb_cache_lookups_total", "Lookups of token database object cache", {{"result", "miss"}}))
+        , prefetch_merged_(utilities::metrics::registry::instance().get_counter(
+            "jmzk_tokendb_cache_prefetches_total", "Prefetched objects of token database object cache", {{"result", "merged"}}))
+        , prefetch_dropped_(utilities::metrics::registry::instance().get_counter(
+            "jmzk_tokendb_cache_prefetches_total", "Prefetched objects of token database object cache", {{"result", "dropped"}})) {
         watch_db();
     }
 
+    ~token_database_cache() {
+        for(auto& e : prefetched_) {
+            e.deleter(e.key, e.value);
+        }
+    }
+
 private:
     template<typename T>
     struct cache_entry {
@@ -61,28 +80,78 @@ public:
         static_assert(std::is_class_v<T>, "T should be a class type");
 
         auto k = db_.get_db_key(type, domain, key);
-        auto h = cache_->Lookup(k);
-        if(h != nullptr) {
-            auto entry = (cache_entry<T>*)cache_->Value(h);
-            jmzk_ASSERT2(entry->ti == boost::typeindex::type_id<T>(), token_database_cache_exception,
-                "Types are not matched between cache({}) and query({})", entry->ti.pretty_name(), boost::typeindex::type_id<T>().pretty_name());
-            return std::unique_ptr<T, cache_deleter<T>>(&entry->data, cache_deleter<T>(this, h));
+        if(auto ptr = lookup_entry<T>(k)) {
+            return ptr;
         }
+        misses_.inc();
 
-        auto str = std::string();
-        auto r   = db_.read_token(type, domain, key, str, no_throw);
+        // decodes from the value pinned by database directly
+        auto entry = std::unique_ptr<cache_entry<T>>();
+        auto size  = size_t();
+        auto r     = db_.read_token_view(type, domain, key, [&](auto& v) {
+            entry = std::make_unique<cache_entry<T>>();
+            size  = v.size();
+            extract_db_value(v, entry->data);
+        }, no_throw);
         if(no_throw && !r) {
             return nullptr;
         }
 
-        auto entry = new cache_entry<T>();
-        extract_db_value(str, entry->data);
-
-        auto s = cache_->Insert(k, (void*)entry, str.size(),
+        auto h = (rocksdb::Cache::Handle*)nullptr;
+        auto s = cache_->Insert(k, (void*)entry.get(), size,
             [](auto& ck, auto cv) { delete (cache_entry<T>*)cv; }, &h);
         FC_ASSERT(s == rocksdb::Status::OK());
 
-        return std::unique_ptr<T, cache_deleter<T>>(&entry->data, cache_deleter<T>(this, h));
+        return std::unique_ptr<T, cache_deleter<T>>(&entry.release()->data, cache_deleter<T>(this, h));
+    }
+
+    template<typename T>
+    small_vector<std::unique_ptr<T, cache_deleter<T>>, 4>
+    read_tokens(token_type type, const std::optional<name128>& domain, const small_vector_base<name128>& keys, bool no_throw = false) {
+        static_assert(std::is_class_v<T>, "T should be a class type");
+
+        auto ptrs = small_vector<std::unique_ptr<T, cache_deleter<T>>, 4>();
+        ptrs.resize(keys.size());
+
+        auto misses = small_vector<name128, 4>();
+        auto idxs   = small_vector<size_t, 4>();
+        for(auto i = 0u; i < keys.size(); i++) {
+            ptrs[i] = lookup_token<T>(type, domain, keys[i]);
+            if(ptrs[i] == nullptr) {
+                misses.emplace_back(keys[i]);
+                idxs.emplace_back(i);
+            }
+        }
+        if(misses.empty()) {
+            return ptrs;
+        }
+
+        // all the missed keys are read from database in one batch
+        db_.read_tokens(type, domain, misses, [&](auto j, auto& v) {
+            auto k = db_.get_db_key(type, domain, misses[j]);
+            auto h = cache_->Lookup(k);
+            if(h != nullptr) {
+                // duplicate key in the batch, shares the entry inserted before
+                ptrs[idxs[j]] = std::unique_ptr<T, cache_deleter<T>>(&((cache_entry<T>*)cache_->Value(h))->data, cache_deleter<T>(this, h));
+                return;
+            }
+
+            auto entry = std::make_unique<cache_entry<T>>();
+            extract_db_value(v, entry->data);
+
+            auto s = cache_->Insert(k, (void*)entry.get(), v.size(),
+                [](auto& ck, auto cv) { delete (cache_entry<T>*)cv; }, &h);
+            FC_ASSERT(s == rocksdb::Status::OK());
+
+            ptrs[idxs[j]] = std::unique_ptr<T, cache_deleter<T>>(&entry.release()->data, cache_deleter<T>(this, h));
+        });
+
+        if(!no_throw) {
+            for(auto i : idxs) {
+                jmzk_ASSERT2(ptrs[i] != nullptr, unknown_token_database_key, "Cannot find key: {}", keys[i]);
+            }
+        }
+        return ptrs;
     }
 
     template<typename T>
@@ -91,16 +160,86 @@ public:
         static_assert(std::is_class_v<T>, "T should be a class type");
 
         auto k = db_.get_db_key(type, domain, key);
-        auto h = cache_->Lookup(k);
-        if(h != nullptr) {
-            auto entry = (cache_entry<T>*)cache_->Value(h);
-            jmzk_ASSERT2(entry->ti == boost::typeindex::type_id<T>(), token_database_cache_exception,
-                "Types are not matched between cache({}) and query({})", entry->ti.pretty_name(), boost::typeindex::type_id<T>().pretty_name());
-            return std::unique_ptr<T, cache_deleter<T>>(&entry->data, cache_deleter<T>(this, h));
+        if(auto ptr = lookup_entry<T>(k)) {
+            return ptr;
         }
+        misses_.inc();
         return nullptr;
     }
 
+    /**
+     * Reads and decodes the value on the calling thread, safe to be called from other threads.
+     * The entry is merged into cache on the next miss, or is dropped if the key is updated or rolled back
+     * after the read begins, so prefetched entries never shadow newer values.
+     */
+    template<typename T>
+    void
+    prefetch_token(token_type type, const std::optional<name128>& domain, const name128& key) {
+        static_assert(std::is_class_v<T>, "T should be a class type");
+
+        auto k = db_.get_db_key(type, domain, key);
+        auto v = versions_[version_index(k)].load(std::memory_order_acquire);
+
+        auto entry = std::unique_ptr<cache_entry<T>>();
+        auto size  = size_t();
+        db_.read_token_view(type, domain, key, [&](auto& dv) {
+            entry = std::make_unique<cache_entry<T>>();
+            size  = dv.size();
+            extract_db_value(dv, entry->data);
+        }, true /* no throw */);
+        if(entry == nullptr) {
+            return;
+        }
+
+        auto lock = std::lock_guard<std::mutex>(prefetch_mutex_);
+        if(prefetched_.size() >= kMaxPrefetched) {
+            prefetch_dropped_.inc();
+            return;
+        }
+        prefetched_.emplace_back(prefetched_entry {
+            .key     = std::move(k),
+            .value   = (void*)entry.release(),
+            .size    = size,
+            .version = v,
+            .deleter = [](auto& ck, auto cv) { delete (cache_entry<T>*)cv; }
+        });
+        has_prefetched_.store(true, std::memory_order_release);
+    }
+
+    // merges the prefetched entries into cache, returns false if there's none
+    bool
+    merge_prefetched() {
+        if(!has_prefetched_.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        auto entries = std::vector<prefetched_entry>();
+        {
+            auto lock = std::lock_guard<std::mutex>(prefetch_mutex_);
+            entries.swap(prefetched_);
+            has_prefetched_.store(false, std::memory_order_relaxed);
+        }
+
+        for(auto& e : entries) {
+            // key is written after the read begins or it's already in cache
+            auto h = (rocksdb::Cache::Handle*)nullptr;
+            if(versions_[version_index(e.key)].load(std::memory_order_relaxed) != e.version
+                || (h = cache_->Lookup(e.key)) != nullptr) {
+                if(h != nullptr) {
+                    cache_->Release(h);
+                }
+                e.deleter(e.key, e.value);
+                prefetch_dropped_.inc();
+                continue;
+            }
+
+            auto s = cache_->Insert(e.key, e.value, e.size, e.deleter, nullptr /* handle */);
+            FC_ASSERT(s == rocksdb::Status::OK());
+            prefetch_merged_.inc();
+        }
+        return true;
+    }
+
     template<typename T, bool RtnPTR = false, typename U = std::decay_t<T>>
     std::conditional_t<RtnPTR, std::unique_ptr<U, cache_deleter<U>>, void>
     put_token(token_type type, action_op op, const std::optional<name128>& domain, const name128& key, T&& data)  {
@@ -119,6 +258,7 @@ public:
 
         auto v = make_db_value(data);
         db_.put_token(type, op, domain, key, v.as_string_view());
+        bump_version(k);
         
         if(h != nullptr) {
             // if there's already cache item, no need to insert new one
@@ -145,19 +285,75 @@ public:
     }
 
 private:
+    template<typename T>
+    std::unique_ptr<T, cache_deleter<T>>
+    lookup_entry(const std::string& k) {
+        auto h = cache_->Lookup(k);
+        if(h == nullptr && merge_prefetched()) {
+            // key may be just prefetched
+            h = cache_->Lookup(k);
+        }
+        if(h == nullptr) {
+            return nullptr;
+        }
+
+        hits_.inc();
+        auto entry = (cache_entry<T>*)cache_->Value(h);
+        jmzk_ASSERT2(entry->ti == boost::typeindex::type_id<T>(), token_database_cache_exception,
+            "Types are not matched between cache({}) and query({})", entry->ti.pretty_name(), boost::typeindex::type_id<T>().pretty_name());
+        return std::unique_ptr<T, cache_deleter<T>>(&entry->data, cache_deleter<T>(this, h));
+    }
+
+    static size_t
+    version_index(const rocksdb::Slice& key) {
+        return std::hash<std::string_view>()(std::string_view(key.data(), key.size())) % kVersionSlots;
+    }
+
+    // called after the value in database is changed
+    void
+    bump_version(const rocksdb::Slice& key) {
+        versions_[version_index(key)].fetch_add(1, std::memory_order_release);
+    }
+
     void
     watch_db() {
+        // both are emitted after the values in database are rolled back
         db_.rollback_token_value.connect([this](auto& key) {
+            bump_version(key);
             cache_->Erase(key);
         });
         db_.remove_token_value.connect([this](auto& key) {
+            bump_version(key);
             cache_->Erase(key);
         });
     }
 
+private:
+    struct prefetched_entry {
+        std::string key;
+        void*       value;
+        size_t      size;
+        uint32_t    version;
+        void (*deleter)(const rocksdb::Slice& key, void* value);
+    };
+
+    enum { kVersionSlots = 4096, kMaxPrefetched = 16384 };
+
 private:
     token_database&                 db_;
     std::shared_ptr<rocksdb::Cache> cache_;
+
+    // versions of the keys hashed into slots, prefetched entries are dropped if the slot is changed
+    std::array<std::atomic<uint32_t>, kVersionSlots> versions_ = {};
+
+    std::mutex                    prefetch_mutex_;
+    std::vector<prefetched_entry> prefetched_;
+    std::atomic<bool>             has_prefetched_ = false;
+
+    utilities::metrics::counter& hits_;
+    utilities::metrics::counter& misses_;
+    utilities::metrics::counter& prefetch_merged_;
+    utilities::metrics::counter& prefetch_dropped_;
 };
 
 template<typename T>
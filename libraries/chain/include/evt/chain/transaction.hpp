@@ -4,6 +4,7 @@
  */
 #pragma once
 
+#include <mutex>
 #include <numeric>
 #include <jmzk/chain/action.hpp>
 #include <jmzk/chain/address.hpp>
@@ -91,6 +92,55 @@ struct signed_transaction : public transaction {
                                              bool                 allow_duplicate_keys = false) const;
 };
 
+/**
+ *  Caches the signing digest of a transaction for the latest chain id.
+ *  It can be read from multiple threads, and is copied along with the transaction.
+ */
+class sig_digest_cache {
+public:
+    sig_digest_cache() = default;
+    sig_digest_cache(const sig_digest_cache& rhs) : value_(rhs.get()) {}
+
+    sig_digest_cache&
+    operator=(const sig_digest_cache& rhs) {
+        if(this != &rhs) {
+            auto v    = rhs.get();
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            value_    = std::move(v);
+        }
+        return *this;
+    }
+
+public:
+    template<typename Func>
+    digest_type
+    get_or_compute(const chain_id_type& chain_id, Func&& func) const {
+        {
+            auto lock = std::lock_guard<std::mutex>(mutex_);
+            if(value_.has_value() && value_->first == chain_id) {
+                return value_->second;
+            }
+        }
+
+        // computes without holding the lock, racing threads get the same digest
+        auto digest = func();
+        auto lock   = std::lock_guard<std::mutex>(mutex_);
+        value_      = std::make_pair(chain_id, digest);
+        return digest;
+    }
+
+private:
+    std::optional<std::pair<chain_id_type, digest_type>>
+    get() const {
+        auto lock = std::lock_guard<std::mutex>(mutex_);
+        return value_;
+    }
+
+private:
+    mutable std::mutex                                           mutex_;
+    mutable std::optional<std::pair<chain_id_type, digest_type>> value_;
+};
+
 struct packed_transaction : fc::reflect_init {
 public:
     enum compression_type {
@@ -132,8 +182,13 @@ public:
 
     digest_type packed_digest() const;
 
-    transaction_id_type id() const { return unpacked_trx.id(); }
-    bytes               get_raw_transaction() const;
+    // digests are computed once when the transaction is packed or unpacked
+    const transaction_id_type& id() const { return trx_id; }
+    const digest_type&         signed_id() const { return signed_trx_id; }
+    digest_type                sig_digest(const chain_id_type& chain_id) const;
+    public_keys_set            get_signature_keys(const chain_id_type& chain_id, bool allow_duplicate_keys = false) const;
+
+    bytes get_raw_transaction() const;
 
     time_point_sec            expiration() const { return unpacked_trx.expiration; }
     const transaction&        get_transaction() const { return unpacked_trx; }
@@ -150,6 +205,8 @@ private:
 private:
     void local_unpack_transaction();
     void local_pack_transaction();
+    void compute_digests(const bytes& raw_trx);
+    void compute_digests_unpacked(const bytes& raw_trx);
 
     friend struct fc::reflector<packed_transaction>;
     friend struct fc::reflector_init_visitor<packed_transaction>;
@@ -159,6 +216,12 @@ private:
 private:
     // cache unpacked trx, for thread safety do not modify after construction
     signed_transaction unpacked_trx;
+
+    // cache digests, for thread safety do not modify after construction
+    transaction_id_type trx_id;
+    digest_type         signed_trx_id;
+    sig_digest_cache    trx_sig_digest;
+    bool                canonical_packed = true;  // false if received bytes differ from the re-packed ones
 };
 
 using packed_transaction_ptr = std::shared_ptr<packed_transaction>;
@@ -170,5 +233,5 @@ FC_REFLECT_ENUM(jmzk::chain::transaction_ext, (suspend_name));
 FC_REFLECT_DERIVED(jmzk::chain::transaction, (jmzk::chain::transaction_header), (actions)(payer)(transaction_extensions));
 FC_REFLECT_DERIVED(jmzk::chain::signed_transaction, (jmzk::chain::transaction), (signatures));
 FC_REFLECT_ENUM(jmzk::chain::packed_transaction::compression_type, (none)(zlib));
-// @ignore unpacked_trx
+// @ignore unpacked_trx trx_id signed_trx_id trx_sig_digest canonical_packed
 FC_REFLECT(jmzk::chain::packed_transaction, (signatures)(compression)(packed_trx));
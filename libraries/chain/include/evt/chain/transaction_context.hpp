@@ -62,6 +62,7 @@ public:
     fc::time_point        start;
 
     small_vector<action_receipt, 4> executed;
+    uint64_t                        global_action_sequence = 0;  // last sequence taken, reserved by controller
 
     bool      is_input    = false;
     bool      is_implicit = false;
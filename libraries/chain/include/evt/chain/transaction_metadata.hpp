@@ -3,18 +3,35 @@
  *  @copyright defined in jmzk/LICENSE.txt
  */
 #pragma once
+#include <future>
 #include <boost/noncopyable.hpp>
 #include <jmzk/chain/block.hpp>
 #include <jmzk/chain/trace.hpp>
 #include <jmzk/chain/transaction.hpp>
+#include <jmzk/chain/contracts/jmzk_link.hpp>
+
+namespace boost { namespace asio {
+class thread_pool;
+}}  // namespace boost::asio
 
 namespace jmzk { namespace chain {
 
+class transaction_metadata;
+using transaction_metadata_ptr = std::shared_ptr<transaction_metadata>;
+
 /**
  *  This data structure should store context-free cached data about a transaction such as
  *  packed/unpacked/compressed and recovered keys
  */
 class transaction_metadata : boost::noncopyable {
+public:
+    struct link_keys {
+        contracts::jmzk_link::signatures_type signatures;
+        public_keys_set                       keys;
+    };
+    // keys restored from the jmzk-links embedded in everipass and everipay actions, keyed by link digest
+    using link_keys_map = fc::flat_map<fc::sha256, link_keys>;
+
 public:
     transaction_id_type                             id;
     transaction_id_type                             signed_id;
@@ -22,28 +39,32 @@ public:
     optional<pair<chain_id_type, public_keys_set>>  signing_keys;
     bool                                            accepted = false;
     bool                                            implicit = false;
+    std::shared_future<link_keys_map>               link_keys_future;
 
 public:
     explicit transaction_metadata(const signed_transaction& t, packed_transaction::compression_type c = packed_transaction::none)
-        : id(t.id()), packed_trx(std::make_shared<packed_transaction>(t, c)) {
-        signed_id = digest_type::hash(*packed_trx);
+        : packed_trx(std::make_shared<packed_transaction>(t, c)) {
+        id        = packed_trx->id();
+        signed_id = packed_trx->signed_id();
     }
 
     explicit transaction_metadata(const packed_transaction_ptr& ptrx)
-        : id(ptrx->id()), packed_trx(ptrx) {
-        signed_id = digest_type::hash(*packed_trx);
-    }
+        : id(ptrx->id()), signed_id(ptrx->signed_id()), packed_trx(ptrx) {}
 
 public:
-    const public_keys_set&
-    recover_keys(const chain_id_type& chain_id) {
-        if(!signing_keys.has_value() || signing_keys->first != chain_id) {  // Unlikely for more than one chain_id to be used in one nodeos instance
-            signing_keys = std::make_pair(chain_id, packed_trx->get_signed_transaction().get_signature_keys(chain_id));
-        }
-        return signing_keys->second;
-    }
-};
+    const public_keys_set& recover_keys(const chain_id_type& chain_id);
 
-using transaction_metadata_ptr = std::shared_ptr<transaction_metadata>;
+    /**
+     *  Returns the keys which signed the link, the keys are taken from the ones restored
+     *  ahead of execution when available, otherwise they are restored in place.
+     */
+    public_keys_set get_link_keys(const contracts::jmzk_link& link) const;
+
+    /**
+     *  Parses the jmzk-links embedded in the actions of `mtrx` and restores their signing keys on `thread_pool`.
+     *  It's a no-op if the keys are already being restored or the transaction doesn't have any links.
+     */
+    static void start_restore_link_keys(const transaction_metadata_ptr& mtrx, boost::asio::thread_pool& thread_pool);
+};
 
 }}  // namespace jmzk::chain
@@ -45,15 +45,23 @@ merkle(vector<digest_type> ids) {
         return digest_type();
     }
 
+    static_assert(sizeof(digest_type) == 32, "canonical pairs are hashed from the digests in place");
+
+    auto next = vector<digest_type>();
     while(ids.size() > 1) {
         if(ids.size() % 2)
             ids.push_back(ids.back());
 
-        for(auto i = 0u; i < ids.size() / 2; i++) {
-            ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+        // after being made canonical, every two adjacent digests are exactly the bytes of one pair,
+        // so the whole level is hashed in one batch
+        for(auto i = 0u; i < ids.size(); i += 2) {
+            ids[i]._hash[0]     &= 0xFFFFFFFFFFFFFF7FULL;
+            ids[i + 1]._hash[0] |= 0x0000000000000080ULL;
         }
 
-        ids.resize(ids.size() / 2);
+        next.resize(ids.size() / 2);
+        digest_type::hash_many(ids.front().data(), sizeof(digest_type) * 2, next.size(), next.data());
+        std::swap(ids, next);
     }
 
     return ids.front();
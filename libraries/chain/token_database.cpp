@@ -8,10 +8,17 @@
 #define __cpp_lib_string_view
 #endif
 
+#include <array>
+#include <cerrno>
+#include <cstring>
 #include <deque>
 #include <fstream>
 #include <string_view>
 #include <unordered_set>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <rocksdb/db.h>
 #include <rocksdb/cache.h>
@@ -23,14 +30,18 @@
 
 #include <llvm/ADT/StringSet.h>
 #include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Allocator.h>
 
 #include <fc/filesystem.hpp>
 #include <fc/io/datastream.hpp>
 #include <fc/io/raw.hpp>
 #include <fc/container/ring_vector.hpp>
+#include <fc/crypto/city.hpp>
+#include <fc/interprocess/file_mapping.hpp>
 
 #include <jmzk/chain/config.hpp>
 #include <jmzk/chain/exceptions.hpp>
+#include <jmzk/utilities/metrics.hpp>
 
 namespace jmzk { namespace chain {
 
@@ -48,10 +59,43 @@ namespace internal {
 #error jmzk can only be compiled in X86-64 architecture
 #endif
 
-const char*  kAssetsColumnFamilyName = "Assets";
-const size_t kSymbolIdSize           = sizeof(symbol_id_type);
-const size_t kPublicKeySize          = sizeof(fc::ecc::public_key_shim);
-const size_t kDefaultSavePointsSize  = (4 / 3 * 24 + 1) * 12;
+const char*  kTokensColumnFamilyName  = "Tokens";
+const char*  kHistoryColumnFamilyName = "History";
+const char*  kAssetsColumnFamilyName  = "Assets";
+const size_t kSymbolIdSize            = sizeof(symbol_id_type);
+const size_t kPublicKeySize           = sizeof(fc::ecc::public_key_shim);
+const size_t kDefaultSavePointsSize   = (4 / 3 * 24 + 1) * 12;
+const size_t kMigrateBatchSize        = 10'000;
+
+// meta column is the default column family
+enum column_family {
+    kMetaColumn = 0,
+    kTokensColumn,
+    kHistoryColumn,
+    kAssetsColumn,
+    kColumnsNum
+};
+
+const char* column_family_names[] = { "meta", "tokens", "history", "assets" };
+
+column_family
+get_column_family(token_type type) {
+    switch(type) {
+    case token_type::asset: {
+        return kAssetsColumn;
+    }
+    case token_type::token: {
+        return kTokensColumn;
+    }
+    case token_type::jmzklink:
+    case token_type::psvbonus_dist: {
+        return kHistoryColumn;
+    }
+    default: {
+        return kMetaColumn;
+    }
+    }  // switch
+}
 
 struct db_token_key : boost::noncopyable {
 public:
@@ -178,9 +222,20 @@ public:
     };
 };
 
+// previous value of a key before its first write in the savepoint
+struct undo_value {
+    uint8_t         type;    // token type, decides the column family
+    uint8_t         exists;  // key is deleted in rollback if it didn't exist
+    llvm::StringRef value;   // allocated in the arena of the undo log
+};
+
+// keys and values are both allocated in the arena, which is released at once with the savepoint
+using undo_log = llvm::StringMap<undo_value, llvm::BumpPtrAllocator>;
+
 struct rt_group {
     const void*                rb_snapshot;
     small_vector<rt_action, 4> actions;
+    std::unique_ptr<undo_log>  undo;  // only if `enable_undo_log` is set
 };
 
 // persistent action
@@ -238,102 +293,365 @@ struct rt_asset_key {
     char key[kSymbolIdSize + kPublicKeySize];
 };
 
+void
+free_rt_action(const rt_action& act) {
+    switch(act.get_data_type()) {
+    case kTokenKey:
+    case kTokenFullKey:
+    case kAssetKey: {
+        free(GETPOINTER(void, act.data));
+        break;
+    }
+    case kTokenKeys: {
+        auto p = GETPOINTER(rt_token_keys, act.data);
+        //need to call dtor of keys manually
+        p->keys.~token_keys_t();
+        free(p);
+        break;
+    }
+    }  // switch
+}
+
 struct pd_header {
     int dirty_flag;
 };
 
+// fixed size fields and length prefixed bytes used in savepoints journal
+template<typename T>
+void
+jnl_append(std::string& out, const T& v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    out.append((const char*)&v, sizeof(T));
+}
+
+void
+jnl_append_str(std::string& out, const std::string_view& v) {
+    jnl_append(out, (uint32_t)v.size());
+    out.append(v.data(), v.size());
+}
+
+template<typename T>
+T
+jnl_read(fc::datastream<const char*>& ds) {
+    auto v = T();
+    ds.read((char*)&v, sizeof(T));
+    return v;
+}
+
+std::string_view
+jnl_read_str(fc::datastream<const char*>& ds) {
+    auto size = jnl_read<uint32_t>(ds);
+    jmzk_ASSERT(ds.remaining() >= size, token_database_journal_exception, "Invalid bytes in savepoints journal");
+
+    auto v = std::string_view(ds.pos(), size);
+    ds.skip(size);
+    return v;
+}
+
 }  // namespace internal
 
+// Write cache of the asset balances, all the keys are `db_asset_key` in fixed size.
+// Entries are kept in a flat open-addressing table and the values are allocated in
+// the bump arena of the savepoint which writes them, so no allocation is made per write.
 class write_cache_layer : boost::noncopyable {
+public:
+    static constexpr size_t kKeySize = internal::kSymbolIdSize + internal::kPublicKeySize;
+
 private:
+    static constexpr size_t kInitSlotsSize  = 1024;
+    static constexpr size_t kArenaBlockSize = 8 * 1024;
+    static constexpr size_t kBatchOverhead  = 16;  // tag, column family and varint lengths of one record in `WriteBatch`
+
+    using block_ptr = std::unique_ptr<char[]>;
+
     struct cache_entry {
     public:
-        cache_entry(int32_t used_count, std::string&& value)
-            : used_count(used_count)
-            , value(std::move(value)) {}
+        std::string_view key_view() const { return std::string_view(key, kKeySize); }
+        std::string_view value_view() const { return std::string_view(value, size); }
 
     public:
-        int32_t     used_count;
-        std::string value;
+        const char* value;
+        uint32_t    size;
+        uint32_t    used_count;  // zero for empty slot
+        uint32_t    hash;
+        char        key[kKeySize];
     };
 
-    using data_map_t = llvm::StringMap<cache_entry>;
-
     struct data_op {
-    public:
-        data_op(data_map_t::iterator& it, std::string&& pv)
-            : it(&(*it)), pv(std::move(pv)) {}
+        const char* pv;  // previous value, lives in the arena of one savepoint not after this one
+        uint32_t    pv_size;
+        char        key[kKeySize];
+    };
 
-    public:
-        data_map_t::value_type* it;
-        std::string             pv;
+    struct value_arena {
+        std::vector<block_ptr> blocks;
+        std::vector<block_ptr> large;  // values cannot fit in one block
+        size_t                 used = 0;  // used bytes of the last block
     };
 
     struct data_ops {
         int64_t              seq;
+        size_t               bytes;  // upper bound of the size of `WriteBatch` to persist these ops
         std::vector<data_op> vec;
+        value_arena          arena;
     };
 
 public:
-    write_cache_layer() : ops_(internal::kDefaultSavePointsSize) {}
+    write_cache_layer()
+        : slots_(kInitSlotsSize)
+        , size_(0)
+        , mask_(kInitSlotsSize - 1)
+        , ops_(internal::kDefaultSavePointsSize)
+        , size_gauge_(utilities::metrics::registry::instance().get_gauge(
+            "jmzk_tokendb_write_cache_size", "Number of entries in the write cache layer of token database")) {}
 
 public:
     void put(const std::string_view& key, const std::string_view& value);
-    int read(const std::string_view& key, std::string& value) const;
+    int read_view(const std::string_view& key, std::string_view& value) const;  // valid until next write
     int exists(const std::string_view& key) const;
 
+    template<typename Func>
+    void
+    for_each(Func&& func) const {
+        for(auto& e : slots_) {
+            if(e.used_count > 0) {
+                func(e.key_view(), e.value_view());
+            }
+        }
+    }
+
 public:
     void add_savepoint(int64_t seq);
     void rollback_to_latest_savepoint();
     void squash();
-    void pop_front(std::function<void(const llvm::StringRef&, std::string&&)> persist_func);
+    void pop_front(std::function<void(const std::string_view&, const std::string_view&)> persist_func);
     void pop_back();
 
+    size_t front_batch_size() const { return ops_.front().bytes; }
+
     void clear();
     void persist_savepoints(std::ostream& os) const;
     void load_savepoints(std::istream& is);
 
+    // exact state including the entries kept by `pop_back`, used to checkpoint the journal
+    void dump_state(std::string& out) const;
+    void load_state(fc::datastream<const char*>& ds);
+
 private:
-    data_map_t                data_;
+    static uint32_t hash_key(const char* key) { return (uint32_t)fc::city_hash64(key, kKeySize); }
+
+    const cache_entry* find(const char* key) const;
+    cache_entry*       find(const char* key);
+    cache_entry&       emplace(const char* key, bool& inserted);
+    void               erase(cache_entry& entry);
+    void               grow();
+
+    const char* alloc_value(value_arena& arena, const std::string_view& value);
+    void        release_arena(value_arena& arena);
+    void        retain_arena(value_arena& arena);
+
+    void update_size() { size_gauge_.set(size_); }
+
+private:
+    std::vector<cache_entry> slots_;
+    size_t                   size_;
+    size_t                   mask_;
+
+    std::vector<block_ptr> free_blocks_;
+    value_arena            retained_;     // arenas of ops dropped by `pop_back`, entries keep referencing them
+
     fc::ring_vector<data_ops> ops_;
 
+    utilities::metrics::gauge& size_gauge_;
+
 private:
     friend class token_database_impl;
 };
 
+const write_cache_layer::cache_entry*
+write_cache_layer::find(const char* key) const {
+    auto h = hash_key(key);
+    for(auto i = h & mask_;; i = (i + 1) & mask_) {
+        auto& e = slots_[i];
+        if(e.used_count == 0) {
+            return nullptr;
+        }
+        if(e.hash == h && memcmp(e.key, key, kKeySize) == 0) {
+            return &e;
+        }
+    }
+}
+
+write_cache_layer::cache_entry*
+write_cache_layer::find(const char* key) {
+    return const_cast<cache_entry*>(std::as_const(*this).find(key));
+}
+
+write_cache_layer::cache_entry&
+write_cache_layer::emplace(const char* key, bool& inserted) {
+    // keeps load factor under 3/4
+    if((size_ + 1) * 4 > slots_.size() * 3) {
+        grow();
+    }
+
+    auto h = hash_key(key);
+    for(auto i = h & mask_;; i = (i + 1) & mask_) {
+        auto& e = slots_[i];
+        if(e.used_count == 0) {
+            e.hash = h;
+            memcpy(e.key, key, kKeySize);
+            size_++;
+
+            inserted = true;
+            return e;
+        }
+        if(e.hash == h && memcmp(e.key, key, kKeySize) == 0) {
+            inserted = false;
+            return e;
+        }
+    }
+}
+
+void
+write_cache_layer::erase(cache_entry& entry) {
+    // backward shift deletion, no tombstones are left in the table
+    auto i = (size_t)(&entry - slots_.data());
+    for(auto j = (i + 1) & mask_;; j = (j + 1) & mask_) {
+        auto& e = slots_[j];
+        if(e.used_count == 0) {
+            break;
+        }
+        // entry at `j` can be moved to `i` only if its home slot is not in (i, j]
+        if(((j - (e.hash & mask_)) & mask_) >= ((j - i) & mask_)) {
+            slots_[i] = e;
+            i = j;
+        }
+    }
+    slots_[i].used_count = 0;
+    size_--;
+}
+
+void
+write_cache_layer::grow() {
+    auto old = std::vector<cache_entry>(slots_.size() * 2);
+    old.swap(slots_);
+    mask_ = slots_.size() - 1;
+
+    for(auto& e : old) {
+        if(e.used_count == 0) {
+            continue;
+        }
+        auto i = e.hash & mask_;
+        while(slots_[i].used_count != 0) {
+            i = (i + 1) & mask_;
+        }
+        slots_[i] = e;
+    }
+}
+
+const char*
+write_cache_layer::alloc_value(value_arena& arena, const std::string_view& value) {
+    if(value.size() > kArenaBlockSize) {
+        auto& b = arena.large.emplace_back(new char[value.size()]);
+        memcpy(b.get(), value.data(), value.size());
+        return b.get();
+    }
+
+    if(arena.blocks.empty() || arena.used + value.size() > kArenaBlockSize) {
+        if(!free_blocks_.empty()) {
+            arena.blocks.emplace_back(std::move(free_blocks_.back()));
+            free_blocks_.pop_back();
+        }
+        else {
+            arena.blocks.emplace_back(new char[kArenaBlockSize]);
+        }
+        arena.used = 0;
+    }
+
+    auto p = arena.blocks.back().get() + arena.used;
+    memcpy(p, value.data(), value.size());
+    arena.used += value.size();
+    return p;
+}
+
+void
+write_cache_layer::release_arena(value_arena& arena) {
+    for(auto& b : arena.blocks) {
+        free_blocks_.emplace_back(std::move(b));
+    }
+    arena.blocks.clear();
+    arena.large.clear();
+    arena.used = 0;
+}
+
+void
+write_cache_layer::retain_arena(value_arena& arena) {
+    for(auto& b : arena.blocks) {
+        retained_.blocks.emplace_back(std::move(b));
+    }
+    for(auto& b : arena.large) {
+        retained_.large.emplace_back(std::move(b));
+    }
+    arena.blocks.clear();
+    arena.large.clear();
+    arena.used = 0;
+}
+
 void
 write_cache_layer::put(const std::string_view& key, const std::string_view& value) {
     assert(!ops_.empty());
+    assert(key.size() == kKeySize);
 
-    auto pair = data_.try_emplace(llvm::StringRef(key.data(), key.size()), 1, std::string(value.data(), value.size()));
-    if(!pair.second) {
-        auto pv = std::move(pair.first->second.value);
-        pair.first->second.used_count += 1;
-        pair.first->second.value       = std::string(value.data(), value.size());
-        ops_.back().vec.emplace_back(data_op(pair.first, std::move(pv)));
-        return;
+    auto& ops = ops_.back();
+    auto  v   = alloc_value(ops.arena, value);
+
+    auto  inserted = false;
+    auto& e        = emplace(key.data(), inserted);
+
+    auto& op = ops.vec.emplace_back();
+    memcpy(op.key, key.data(), kKeySize);
+    if(inserted) {
+        e.used_count = 1;
+        op.pv        = nullptr;
+        op.pv_size   = 0;
+        update_size();
+    }
+    else {
+        e.used_count += 1;
+        op.pv         = e.value;
+        op.pv_size    = e.size;
     }
-    ops_.back().vec.emplace_back(data_op(pair.first, std::string()));
+    e.value = v;
+    e.size  = value.size();
+
+    ops.bytes += kKeySize + value.size() + kBatchOverhead;
 }
 
 int
-write_cache_layer::read(const std::string_view& key, std::string& value) const {
-    auto it = data_.find(llvm::StringRef(key.data(), key.size()));
-    if(it == data_.end()) {
+write_cache_layer::read_view(const std::string_view& key, std::string_view& value) const {
+    assert(key.size() == kKeySize);
+
+    auto e = find(key.data());
+    if(e == nullptr) {
         return 0;
     }
-    value = it->second.value;
+    value = e->value_view();
     return 1;
 }
 
 int
 write_cache_layer::exists(const std::string_view& key) const {
-    return data_.find(llvm::StringRef(key.data(), key.size())) != data_.end();
+    assert(key.size() == kKeySize);
+    return find(key.data()) != nullptr;
 }
 
 void
 write_cache_layer::add_savepoint(int64_t seq) {
-    ops_.push_back(data_ops{ .seq = seq, .vec = {} });
+    auto& ops = ops_.recycle_back();
+    assert(ops.vec.empty() && ops.arena.blocks.empty());
+
+    ops.seq   = seq;
+    ops.bytes = 0;
 }
 
 void
@@ -341,15 +659,22 @@ write_cache_layer::rollback_to_latest_savepoint() {
     auto& ops = ops_.back();
     for(auto it = ops.vec.rbegin(); it != ops.vec.rend(); it++) {
         auto& op = *it;
-        if(--op.it->second.used_count == 0) {
-            data_.erase(op.it->first());
+        auto  e  = find(op.key);
+        assert(e != nullptr);
+
+        if(--e->used_count == 0) {
+            erase(*e);
         }
         else {
-            assert(!op.it->second.value.empty());
-            op.it->second.value = std::move(op.pv);
+            e->value = op.pv;
+            e->size  = op.pv_size;
         }
     }
+    ops.vec.clear();
+    release_arena(ops.arena);
+
     ops_.pop_back();
+    update_size();
 }
 
 void
@@ -359,23 +684,82 @@ write_cache_layer::squash() {
     auto& b2 = ops_[ops_.size() - 2];
 
     b2.vec.insert(b2.vec.end(), b1.vec.begin(), b1.vec.end());
+    b2.bytes += b1.bytes;
+
+    // values of b1 are still referenced, the blocks are moved and allocation goes on in the last one of b1
+    if(!b1.arena.blocks.empty()) {
+        for(auto& b : b1.arena.blocks) {
+            b2.arena.blocks.emplace_back(std::move(b));
+        }
+        b2.arena.used = b1.arena.used;
+    }
+    for(auto& b : b1.arena.large) {
+        b2.arena.large.emplace_back(std::move(b));
+    }
+    b1.vec.clear();
+    b1.arena.blocks.clear();
+    b1.arena.large.clear();
+    b1.arena.used = 0;
+
     ops_.pop_back();
 }
 
 void
-write_cache_layer::pop_front(std::function<void(const llvm::StringRef&, std::string&&)> persist_func) {
-    for(auto& op : ops_.front().vec) {
-        if(--op.it->second.used_count == 0) {
-            persist_func(op.it->first(), std::move(op.it->second.value));
-            data_.erase(op.it->first());
+write_cache_layer::pop_front(std::function<void(const std::string_view&, const std::string_view&)> persist_func) {
+    auto& ops = ops_.front();
+    for(auto& op : ops.vec) {
+        auto e = find(op.key);
+        assert(e != nullptr);
+
+        if(--e->used_count == 0) {
+            persist_func(e->key_view(), e->value_view());
+            erase(*e);
         }
     }
 
+    // keys written again later still reference the values in this arena, either by `pv` of their
+    // next op or by the entry itself when only dropped ops follow. Those values are persisted and
+    // copied into the retained arena, so that this arena can be released. The arena of the later
+    // savepoint cannot hold them: rolling it back restores `pv` into the entry and then frees it.
+    auto pending = std::unordered_set<std::string_view>();
+    for(auto& op : ops.vec) {
+        if(find(op.key) != nullptr) {
+            pending.emplace(op.key, kKeySize);
+        }
+    }
+    for(auto i = 1u; i < ops_.size() && !pending.empty(); i++) {
+        auto& later = ops_[i];
+        for(auto& op : later.vec) {
+            auto it = pending.find(std::string_view(op.key, kKeySize));
+            if(it == pending.end()) {
+                continue;
+            }
+            auto pv = std::string_view(op.pv, op.pv_size);
+            persist_func(*it, pv);
+            op.pv = alloc_value(retained_, pv);
+            pending.erase(it);
+        }
+    }
+    for(auto& k : pending) {
+        auto e = find(k.data());
+        persist_func(k, e->value_view());
+        e->value = alloc_value(retained_, e->value_view());
+    }
+
+    ops.vec.clear();
+    release_arena(ops.arena);
+
     ops_.pop_front();
+    update_size();
 }
 
 void
 write_cache_layer::pop_back() {
+    // entries written in the popped ops are kept in the cache with their values
+    auto& ops = ops_.back();
+    ops.vec.clear();
+    retain_arena(ops.arena);
+
     ops_.pop_back();
 }
 
@@ -395,8 +779,19 @@ struct wc_entry_pack {
 
 void
 write_cache_layer::clear() {
-    data_.clear();
-    ops_.clear();
+    while(!ops_.empty()) {
+        auto& ops = ops_.back();
+        ops.vec.clear();
+        release_arena(ops.arena);
+        ops_.pop_back();
+    }
+    release_arena(retained_);
+
+    for(auto& e : slots_) {
+        e.used_count = 0;
+    }
+    size_ = 0;
+    update_size();
 }
 
 void
@@ -411,9 +806,12 @@ write_cache_layer::persist_savepoints(std::ostream& os) const {
         auto& epack = pack[i];
         epack.seq   = ops.seq;
         for(auto& op : ops.vec) {
+            auto e = find(op.key);
+            assert(e != nullptr);
+
             epack.vec.emplace_back(wc_entry {
-                .k  = op.it->first().str(),
-                .v  = op.it->second.value
+                .k  = std::string(op.key, kKeySize),
+                .v  = std::string(e->value, e->size)
             });
         }
     }
@@ -435,6 +833,294 @@ write_cache_layer::load_savepoints(std::istream& is) {
     }
 }
 
+void
+write_cache_layer::dump_state(std::string& out) const {
+    using namespace internal;
+
+    jnl_append(out, (uint64_t)size_);
+    for(auto& e : slots_) {
+        if(e.used_count > 0) {
+            out.append(e.key, kKeySize);
+            jnl_append(out, e.used_count);
+            jnl_append_str(out, e.value_view());
+        }
+    }
+
+    jnl_append(out, (uint64_t)ops_.size());
+    for(auto i = 0u; i < ops_.size(); i++) {
+        auto& ops = ops_[i];
+        jnl_append(out, ops.seq);
+        jnl_append(out, (uint64_t)ops.bytes);
+        jnl_append(out, (uint64_t)ops.vec.size());
+        for(auto& op : ops.vec) {
+            out.append(op.key, kKeySize);
+            jnl_append(out, (uint8_t)(op.pv != nullptr));
+            if(op.pv != nullptr) {
+                jnl_append_str(out, std::string_view(op.pv, op.pv_size));
+            }
+        }
+    }
+}
+
+void
+write_cache_layer::load_state(fc::datastream<const char*>& ds) {
+    using namespace internal;
+
+    clear();
+
+    // loaded values are referenced across savepoints, all of them live in the retained arena until next `clear`
+    auto key = std::array<char, kKeySize>();
+
+    auto entries = jnl_read<uint64_t>(ds);
+    for(auto i = 0u; i < entries; i++) {
+        ds.read(key.data(), kKeySize);
+
+        auto  inserted = false;
+        auto& e        = emplace(key.data(), inserted);
+        assert(inserted);
+
+        e.used_count = jnl_read<uint32_t>(ds);
+        auto v       = jnl_read_str(ds);
+        e.value      = alloc_value(retained_, v);
+        e.size       = v.size();
+    }
+
+    auto n = jnl_read<uint64_t>(ds);
+    for(auto i = 0u; i < n; i++) {
+        auto& ops = ops_.recycle_back();
+        assert(ops.vec.empty() && ops.arena.blocks.empty());
+
+        ops.seq   = jnl_read<int64_t>(ds);
+        ops.bytes = jnl_read<uint64_t>(ds);
+
+        auto size = jnl_read<uint64_t>(ds);
+        for(auto j = 0u; j < size; j++) {
+            auto& op = ops.vec.emplace_back();
+            ds.read(op.key, kKeySize);
+            op.pv      = nullptr;
+            op.pv_size = 0;
+            if(jnl_read<uint8_t>(ds)) {
+                auto pv    = jnl_read_str(ds);
+                op.pv      = alloc_value(retained_, pv);
+                op.pv_size = pv.size();
+            }
+        }
+    }
+    update_size();
+}
+
+// Append-only journal of the savepoints, replayed on startup instead of persisting all of them on close.
+// Each record is `[size:u32][checksum:u32][type:u8][payload]`, size and checksum cover type and payload,
+// so a torn tail left by a crash is detected and dropped while replaying.
+class savepoint_journal : boost::noncopyable {
+public:
+    enum record_type : uint8_t {
+        kSavepoint = 0,  // seq, new runtime savepoint
+        kGroup,          // seq, savepoint restored from a checkpoint, write cache layer is in `kLayerState`
+        kUndo,           // type, exists, key, value: old value of a token before its first write in latest savepoint
+        kPut,            // key, value: asset written into write cache layer
+        kRollback,
+        kSquash,
+        kPopFront,
+        kPopBack,
+        kLayerState      // exact state of write cache layer, first record of a checkpoint
+    };
+
+private:
+    static constexpr size_t kHeaderSize    = 2 * sizeof(uint32_t);
+    static constexpr size_t kMaxBufferSize = 64 * 1024;
+
+public:
+    ~savepoint_journal() { close(); }
+
+public:
+    void open(const fc::path& path);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+
+    void add_record(record_type type);
+    void add_seq_record(record_type type, int64_t seq);
+    void add_undo_record(uint8_t type, uint8_t exists, const std::string_view& key, const std::string_view& value);
+    void add_put_record(const std::string_view& key, const std::string_view& value);
+    void add_layer_record(const write_cache_layer& layer);
+
+    void flush();
+    void sync();
+
+    size_t size() const { return size_ + buf_.size(); }
+
+    // calls `func(type, ds)` for each valid record and returns the length of the valid prefix
+    template<typename Func>
+    static size_t replay(const char* data, size_t size, Func&& func);
+
+private:
+    // payload is appended to the returned buffer between `begin_record` and `end_record`
+    std::string& begin_record(record_type type);
+    void         end_record();
+
+private:
+    int         fd_          = -1;
+    size_t      size_        = 0;  // bytes written to the file
+    size_t      synced_size_ = 0;
+    size_t      record_begin_ = 0;
+    std::string buf_;
+};
+
+void
+savepoint_journal::open(const fc::path& path) {
+    assert(!is_open());
+
+    fd_ = ::open(path.to_native_ansi_path().c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    jmzk_ASSERT(fd_ >= 0, token_database_journal_exception, "Cannot open savepoints journal: ${err}", ("err", strerror(errno)));
+
+    size_        = (size_t)::lseek(fd_, 0, SEEK_END);
+    synced_size_ = size_;
+    buf_.clear();
+}
+
+void
+savepoint_journal::close() {
+    if(!is_open()) {
+        return;
+    }
+    ::close(fd_);
+    fd_          = -1;
+    size_        = 0;
+    synced_size_ = 0;
+    buf_.clear();
+}
+
+std::string&
+savepoint_journal::begin_record(record_type type) {
+    assert(is_open());
+
+    record_begin_ = buf_.size();
+    buf_.append(kHeaderSize, '\0');
+    buf_.push_back((char)type);
+    return buf_;
+}
+
+void
+savepoint_journal::end_record() {
+    auto body   = buf_.data() + record_begin_ + kHeaderSize;
+    auto header = std::array<uint32_t, 2>();
+    header[0]   = (uint32_t)(buf_.size() - record_begin_ - kHeaderSize);
+    header[1]   = (uint32_t)fc::city_hash64(body, header[0]);
+    memcpy(buf_.data() + record_begin_, header.data(), kHeaderSize);
+
+    if(buf_.size() >= kMaxBufferSize) {
+        flush();
+    }
+}
+
+void
+savepoint_journal::add_record(record_type type) {
+    begin_record(type);
+    end_record();
+}
+
+void
+savepoint_journal::add_seq_record(record_type type, int64_t seq) {
+    internal::jnl_append(begin_record(type), seq);
+    end_record();
+}
+
+void
+savepoint_journal::add_undo_record(uint8_t type, uint8_t exists, const std::string_view& key, const std::string_view& value) {
+    using namespace internal;
+
+    auto& buf = begin_record(kUndo);
+    jnl_append(buf, type);
+    jnl_append(buf, exists);
+    jnl_append_str(buf, key);
+    jnl_append_str(buf, value);
+    end_record();
+}
+
+void
+savepoint_journal::add_put_record(const std::string_view& key, const std::string_view& value) {
+    using namespace internal;
+
+    auto& buf = begin_record(kPut);
+    jnl_append_str(buf, key);
+    jnl_append_str(buf, value);
+    end_record();
+}
+
+void
+savepoint_journal::add_layer_record(const write_cache_layer& layer) {
+    layer.dump_state(begin_record(kLayerState));
+    end_record();
+}
+
+void
+savepoint_journal::flush() {
+    auto p = buf_.data();
+    auto n = buf_.size();
+    while(n > 0) {
+        auto r = ::write(fd_, p, n);
+        if(r < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Write savepoints journal failed: ${err}", ("err", strerror(errno)));
+        }
+        p += r;
+        n -= r;
+    }
+    size_ += buf_.size();
+    buf_.clear();
+}
+
+void
+savepoint_journal::sync() {
+    flush();
+    if(size_ == synced_size_) {
+        return;
+    }
+    if(::fdatasync(fd_) != 0) {
+        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Sync savepoints journal failed: ${err}", ("err", strerror(errno)));
+    }
+    synced_size_ = size_;
+}
+
+// makes a rename in the directory durable
+void
+sync_directory(const fc::path& dir) {
+    auto fd = ::open(dir.to_native_ansi_path().c_str(), O_RDONLY | O_DIRECTORY);
+    if(fd < 0) {
+        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Open directory of savepoints journal failed: ${err}", ("err", strerror(errno)));
+    }
+    auto r = ::fsync(fd);
+    auto e = errno;
+    ::close(fd);
+    if(r != 0) {
+        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Sync directory of savepoints journal failed: ${err}", ("err", strerror(e)));
+    }
+}
+
+template<typename Func>
+size_t
+savepoint_journal::replay(const char* data, size_t size, Func&& func) {
+    auto pos = size_t(0);
+    while(size - pos >= kHeaderSize + 1) {
+        auto header = std::array<uint32_t, 2>();
+        memcpy(header.data(), data + pos, kHeaderSize);
+
+        auto body = data + pos + kHeaderSize;
+        if(header[0] == 0 || header[0] > size - pos - kHeaderSize
+            || header[1] != (uint32_t)fc::city_hash64(body, header[0])) {
+            break;
+        }
+
+        auto ds = fc::datastream<const char*>(body + 1, header[0] - 1);
+        func((record_type)body[0], ds);
+
+        pos += kHeaderSize + header[0];
+    }
+    return pos;
+}
+
 class token_database_impl : boost::noncopyable {
 public:
     token_database_impl(token_database& self, const token_database::config& config);
@@ -452,13 +1138,19 @@ public:
                     const small_vector_base<std::string_view>& data);
     void put_asset(const address& addr, const symbol_id_type sym_id, const std::string_view& data);
 
-    int exists_token(const name128& prefix, const name128& key) const;
+    int exists_token(token_type type, const name128& prefix, const name128& key) const;
     int exists_asset(const address& addr, const symbol_id_type sym_id) const;
 
-    int read_token(const name128& prefix, const name128& key, std::string& out, bool no_throw = false) const;
+    int read_token(token_type type, const name128& prefix, const name128& key, std::string& out, bool no_throw = false) const;
     int read_asset(const address& addr, const symbol_id_type sym_id, std::string& out, bool no_throw = false) const;
 
-    int read_tokens_range(const name128& prefix, int skip, const read_value_func& func) const;
+    int read_token_view(token_type type, const name128& prefix, const name128& key, const read_view_func& func, bool no_throw = false) const;
+    int read_asset_view(const address& addr, const symbol_id_type sym_id, const read_view_func& func, bool no_throw = false) const;
+
+    int read_tokens(token_type type, const name128& prefix, const small_vector_base<name128>& keys, const read_batch_func& func) const;
+    void prefetch_asset(const address& addr, const symbol_id_type sym_id) const;
+
+    int read_tokens_range(token_type type, const name128& prefix, int skip, const read_value_func& func) const;
     int read_assets_range(const symbol_id_type sym_id, int skip, const read_value_func& func) const;
 
 public:
@@ -467,6 +1159,7 @@ public:
     void pop_savepoints(int64_t until);
     void pop_back_savepoint();
     void squash();
+    void sync_savepoints();
 
     int64_t latest_savepoint_seq() const;
     int64_t new_savepoint_session_seq() const;
@@ -478,6 +1171,8 @@ public:
     int should_record() { return !savepoints_.empty(); }
 
     void record(uint8_t action_type, uint8_t op, uint8_t data_type, void* data);
+    bool capture_undo(token_type type, action_op op, const rocksdb::Slice& key);
+    void rollback_undo_log(internal::rt_group*);
     void free_savepoint(internal::savepoint&);
     void free_all_savepoints();
 
@@ -487,7 +1182,18 @@ public:
     void load_savepoints(std::istream&);
     void flush() const;
 
+    void replay_journal();
+    void checkpoint_journal();
+
     std::string get_db_path() const { return config_.db_path.to_native_ansi_path(); }
+    fc::path    get_journal_path() const { return config_.db_path / config::token_database_journal_filename; }
+
+    rocksdb::ColumnFamilyHandle* get_handle(token_type type) const { return handles_[internal::get_column_family(type)]; }
+
+private:
+    rocksdb::ColumnFamilyOptions get_column_options(int cf, const token_database::column_config& cfg);
+    void migrate_columns(bool legacy);
+    int  migrate_prefix(const name128& prefix, int cf);
 
 public:
     token_database&        self_;
@@ -497,12 +1203,20 @@ public:
     rocksdb::ReadOptions  read_opts_;
     rocksdb::WriteOptions write_opts_;
 
-    rocksdb::ColumnFamilyHandle* tokens_handle_;
-    rocksdb::ColumnFamilyHandle* assets_handle_;
+    std::array<rocksdb::ColumnFamilyHandle*, internal::kColumnsNum> handles_;
+    std::array<std::shared_ptr<rocksdb::Cache>, internal::kColumnsNum> caches_;
 
     write_cache_layer assets_write_cache_;
 
     fc::ring_vector<internal::savepoint> savepoints_;
+
+    savepoint_journal journal_;
+    size_t            journal_checkpoint_size_;  // size of journal after last checkpoint
+
+    utilities::metrics::counter& token_reads_;
+    utilities::metrics::counter& asset_cache_reads_;
+    utilities::metrics::counter& asset_db_reads_;
+    std::optional<uint64_t>      stats_collector_;
 };
 
 token_database_impl::token_database_impl(token_database& self, const token_database::config& config)
@@ -511,36 +1225,62 @@ token_database_impl::token_database_impl(token_database& self, const token_datab
     , db_(nullptr)
     , read_opts_()
     , write_opts_()
-    , tokens_handle_(nullptr)
-    , assets_handle_(nullptr)
-    , savepoints_(internal::kDefaultSavePointsSize) {}
-
-void
-token_database_impl::open(int load_persistence) {
+    , handles_{}
+    , savepoints_(internal::kDefaultSavePointsSize)
+    , journal_checkpoint_size_(0)
+    , token_reads_(utilities::metrics::registry::instance().get_counter(
+        "jmzk_tokendb_reads_total", "Reads of token database", {{"type", "token"}, {"source", "db"}}))
+    , asset_cache_reads_(utilities::metrics::registry::instance().get_counter(
+        "jmzk_tokendb_reads_total", "Reads of token database", {{"type", "asset"}, {"source", "write_cache"}}))
+    , asset_db_reads_(utilities::metrics::registry::instance().get_counter(
+        "jmzk_tokendb_reads_total", "Reads of token database", {{"type", "asset"}, {"source", "db"}})) {}
+
+rocksdb::ColumnFamilyOptions
+token_database_impl::get_column_options(int cf, const token_database::column_config& cfg) {
     using namespace rocksdb;
     using namespace internal;
 
-    jmzk_ASSERT(db_ == nullptr, token_database_exception, "Token database is already opened");
-
-    auto options = Options();
-    options.OptimizeUniversalStyleCompaction();
+    auto options = ColumnFamilyOptions();
+    switch(cfg.compaction) {
+    case db_compaction::level: {
+        options.OptimizeLevelStyleCompaction();
+        break;
+    }
+    case db_compaction::universal: {
+        options.OptimizeUniversalStyleCompaction();
+        break;
+    }
+    default: {
+        jmzk_THROW(token_database_exception, "Unknown compaction style of column: ${c}", ("c",column_family_names[cf]));
+    }
+    }  // switch
 
-    options.create_if_missing               = true;
-    options.compression                     = CompressionType::kLZ4Compression;
-    options.bottommost_compression          = CompressionType::kZSTD;
-    options.allow_concurrent_memtable_write = false;
-    options.prefix_extractor.reset(NewFixedPrefixTransform(sizeof(name128)));
-    options.memtable_factory.reset(NewHashSkipListRepFactory());
-    if(config_.enable_stats) {
-        options.statistics = rocksdb::CreateDBStatistics();
-#if ROCKSDB_MAJOR >= 6
-        options.statistics->set_stats_level(StatsLevel::kExceptTimeForMutex);
-#else
-        options.statistics->stats_level_ = StatsLevel::kExceptTimeForMutex;
-#endif
+    // level style optimization sets compression per level, which overrides the one below
+    options.compression_per_level.clear();
+    switch(cfg.compression) {
+    case db_compression::none: {
+        options.compression            = CompressionType::kNoCompression;
+        options.bottommost_compression = CompressionType::kDisableCompressionOption;
+        break;
+    }
+    case db_compression::lz4: {
+        options.compression            = CompressionType::kLZ4Compression;
+        options.bottommost_compression = CompressionType::kZSTD;
+        break;
     }
+    case db_compression::zstd: {
+        options.compression            = CompressionType::kZSTD;
+        options.bottommost_compression = CompressionType::kZSTD;
+        break;
+    }
+    default: {
+        jmzk_THROW(token_database_exception, "Unknown compression type of column: ${c}", ("c",column_family_names[cf]));
+    }
+    }  // switch
 
-    auto assets_options = ColumnFamilyOptions(options);
+    auto prefix_size = (cf == kAssetsColumn) ? kSymbolIdSize : sizeof(name128);
+    options.prefix_extractor.reset(NewFixedPrefixTransform(prefix_size));
+    options.memtable_factory.reset(NewHashSkipListRepFactory());
 
     if(config_.profile == storage_profile::disk) {
         auto table_opts = BlockBasedTableOptions();
@@ -548,89 +1288,262 @@ token_database_impl::open(int load_persistence) {
         table_opts.index_type     = BlockBasedTableOptions::kHashSearch;
         table_opts.checksum       = kxxHash64;
         table_opts.format_version = 4;
-        table_opts.block_cache    = NewLRUCache(config_.block_cache_size);
-        table_opts.filter_policy.reset(NewBloomFilterPolicy(10, false));
+        if(cfg.block_cache_ratio > 0) {
+            caches_[cf] = NewLRUCache((size_t)config_.block_cache_size * cfg.block_cache_ratio / 100);
+            table_opts.block_cache = caches_[cf];
+        }
+        else {
+            table_opts.no_block_cache = true;
+        }
+        if(cfg.bloom_bits > 0) {
+            table_opts.filter_policy.reset(NewBloomFilterPolicy(cfg.bloom_bits, false));
+        }
 
         options.table_factory.reset(NewBlockBasedTableFactory(table_opts));
-        assets_options.prefix_extractor.reset(NewFixedPrefixTransform(kSymbolIdSize));
     }
     else if(config_.profile == storage_profile::memory) {
-        auto tokens_table_options = PlainTableOptions();
-        auto assets_table_options = PlainTableOptions();
-        tokens_table_options.user_key_len = sizeof(name128) + sizeof(name128);
-        assets_table_options.user_key_len = kPublicKeySize + kSymbolIdSize;
+        auto table_opts = PlainTableOptions();
 
-        options.table_factory.reset(NewPlainTableFactory(tokens_table_options));
-        assets_options.table_factory.reset(NewPlainTableFactory(assets_table_options));
-        assets_options.prefix_extractor.reset(NewFixedPrefixTransform(kSymbolIdSize));
+        table_opts.user_key_len       = (cf == kAssetsColumn) ? (kPublicKeySize + kSymbolIdSize) : (sizeof(name128) + sizeof(name128));
+        table_opts.bloom_bits_per_key = cfg.bloom_bits;
+
+        options.table_factory.reset(NewPlainTableFactory(table_opts));
     }
     else {
         jmzk_THROW(token_database_exception, "Unknown token database profile");
     }
 
-    read_opts_.total_order_seek     = false;
-    read_opts_.prefix_same_as_start = true;
-    read_opts_.tailing              = true;
+    return options;
+}
+
+void
+token_database_impl::open(int load_persistence) {
+    using namespace rocksdb;
+    using namespace internal;
+
+    jmzk_ASSERT(db_ == nullptr, token_database_exception, "Token database is already opened");
+
+    auto ratios = config_.meta_column.block_cache_ratio + config_.tokens_column.block_cache_ratio
+                + config_.history_column.block_cache_ratio + config_.assets_column.block_cache_ratio;
+    jmzk_ASSERT(ratios <= 100, token_database_exception, "Sum of block cache ratios of columns cannot be larger than 100");
+
+    auto options = DBOptions();
+
+    options.create_if_missing               = true;
+    options.create_missing_column_families  = true;
+    options.allow_concurrent_memtable_write = false;
+    if(config_.enable_stats) {
+        options.statistics = rocksdb::CreateDBStatistics();
+#if ROCKSDB_MAJOR >= 6
+        options.statistics->set_stats_level(StatsLevel::kExceptTimeForMutex);
+#else
+        options.statistics->stats_level_ = StatsLevel::kExceptTimeForMutex;
+#endif
+    }
 
     auto columns = std::vector<ColumnFamilyDescriptor>();
     auto handles = std::vector<ColumnFamilyHandle*>();
-    columns.emplace_back(kDefaultColumnFamilyName, options);
+    columns.emplace_back(kDefaultColumnFamilyName, get_column_options(kMetaColumn, config_.meta_column));
+    columns.emplace_back(kTokensColumnFamilyName, get_column_options(kTokensColumn, config_.tokens_column));
+    columns.emplace_back(kHistoryColumnFamilyName, get_column_options(kHistoryColumn, config_.history_column));
+    columns.emplace_back(kAssetsColumnFamilyName, get_column_options(kAssetsColumn, config_.assets_column));
+
+    read_opts_.total_order_seek     = false;
+    read_opts_.prefix_same_as_start = true;
+    read_opts_.tailing              = true;
 
+    // databases created before the split keep all the tokens in the default column family
+    auto legacy = false;
     if(!fc::exists(config_.db_path)) {
-        auto t = config_.db_path.to_native_ansi_path();
-        // create new database and open
         fc::create_directories(config_.db_path);
-        
-        auto status  = DB::Open(options, config_.db_path.to_native_ansi_path(), columns, &handles, &db_);
-        if(!status.ok()) {
-            jmzk_THROW(token_database_rocksdb_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+    }
+    else {
+        auto names = std::vector<std::string>();
+        if(DB::ListColumnFamilies(options, get_db_path(), &names).ok()) {
+            legacy = std::find(names.cbegin(), names.cend(), kTokensColumnFamilyName) == names.cend();
+        }
+    }
+
+    auto status = DB::Open(options, get_db_path(), columns, &handles, &db_);
+    if(!status.ok()) {
+        jmzk_THROW(token_database_rocksdb_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+    }
+
+    assert(handles.size() == kColumnsNum);
+    std::copy(handles.cbegin(), handles.cend(), handles_.begin());
+
+    migrate_columns(legacy);
+
+    if(config_.enable_stats) {
+        auto& registry = utilities::metrics::registry::instance();
+        auto& hits     = registry.get_gauge("jmzk_tokendb_block_cache_hits", "Block cache hits of token database");
+        auto& misses   = registry.get_gauge("jmzk_tokendb_block_cache_misses", "Block cache misses of token database");
+        auto& memtable = registry.get_gauge("jmzk_tokendb_memtable_hits", "Memtable hits of token database");
+
+        auto usages = std::vector<std::pair<utilities::metrics::gauge*, std::shared_ptr<Cache>>>();
+        for(auto i = 0; i < kColumnsNum; i++) {
+            if(caches_[i]) {
+                auto& g = registry.get_gauge("jmzk_tokendb_block_cache_usage_bytes", "Block cache usage of token database",
+                    {{"column", column_family_names[i]}});
+                usages.emplace_back(&g, caches_[i]);
+            }
         }
 
-        assert(handles.size() == 1);
-        tokens_handle_ = handles[0];
+        stats_collector_ = registry.add_collector([&hits, &misses, &memtable, usages, stats = options.statistics] {
+            hits.set(stats->getTickerCount(Tickers::BLOCK_CACHE_HIT));
+            misses.set(stats->getTickerCount(Tickers::BLOCK_CACHE_MISS));
+            memtable.set(stats->getTickerCount(Tickers::MEMTABLE_HIT));
+            for(auto& u : usages) {
+                u.first->set(u.second->GetUsage());
+            }
+        });
+    }
+
+    if(!load_persistence) {
+        // savepoints are dropped by `close(false)`, so are the cached ops of them
+        assets_write_cache_.clear();
+        if(config_.enable_journal) {
+            checkpoint_journal();
+        }
+        return;
+    }
+
+    auto journal = get_journal_path();
+    auto legacy  = config_.db_path / config::token_database_persisit_filename;
+    if(fc::exists(journal)) {
+        replay_journal();
+        if(config_.enable_journal) {
+            if(fc::exists(legacy)) {
+                fc::remove(legacy);
+            }
+            journal_.open(journal);
+            journal_checkpoint_size_ = journal_.size();
+        }
+        else {
+            // switches back to persist all the savepoints on close
+            persist_savepoints();
+            fc::remove(journal);
+        }
+        return;
+    }
+
+    load_savepoints();
+    if(config_.enable_journal) {
+        checkpoint_journal();
+        if(fc::exists(legacy)) {
+            fc::remove(legacy);
+        }
+    }
+}
+
+int
+token_database_impl::migrate_prefix(const name128& prefix, int cf) {
+    using namespace internal;
+
+    auto read_opts    = read_opts_;
+    read_opts.tailing = false;
 
-        status = db_->CreateColumnFamily(assets_options, kAssetsColumnFamilyName, &assets_handle_);
-        if(!status.ok()) {
-            jmzk_THROW(token_database_rocksdb_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
-        }
+    auto it    = std::unique_ptr<rocksdb::Iterator>(db_->NewIterator(read_opts, handles_[kMetaColumn]));
+    auto batch = rocksdb::WriteBatch();
+    auto count = 0;
+
+    it->Seek(rocksdb::Slice((char*)&prefix, sizeof(prefix)));
+    while(it->Valid()) {
+        batch.Put(handles_[cf], it->key(), it->value());
+        batch.Delete(handles_[kMetaColumn], it->key());
+        count++;
 
-        if(load_persistence) {
-            load_savepoints();
+        if(batch.Count() >= kMigrateBatchSize * 2) {
+            db_->Write(write_opts_, &batch);
+            batch.Clear();
         }
-        return;
+        it->Next();
+    }
+    if(!it->status().ok()) {
+        jmzk_THROW(token_database_rocksdb_exception, "Rocksdb internal error: ${err}", ("err", it->status().getState()));
+    }
+    if(batch.Count() > 0) {
+        db_->Write(write_opts_, &batch);
     }
+    return count;
+}
 
-    columns.emplace_back(kAssetsColumnFamilyName, assets_options);
+/**
+ *  Moves the tokens and the histories out of the default column family in place.
+ *  Every key is moved in the same batch as its deletion, and a mark is kept in the meta column until all of
+ *  them are moved, so an interrupted migration is resumed when the database is opened next time.
+ */
+void
+token_database_impl::migrate_columns(bool legacy) {
+    using namespace internal;
 
-    auto status = DB::Open(options, config_.db_path.to_native_ansi_path(), columns, &handles, &db_);
-    if(!status.ok()) {
-        jmzk_THROW(token_database_rocksdb_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+    auto mark   = db_token_key(N128(.tokendb), N128(.migrating));
+    auto value  = std::string();
+    auto status = db_->Get(read_opts_, handles_[kMetaColumn], mark.as_slice(), &value);
+    if(!legacy && !status.ok()) {
+        return;
     }
 
-    assert(handles.size() == 2);
-    tokens_handle_ = handles[0];
-    assets_handle_ = handles[1];
+    auto sync_write_opts = write_opts_;
+    sync_write_opts.sync = true;
+    db_->Put(sync_write_opts, handles_[kMetaColumn], mark.as_slice(), rocksdb::Slice());
+
+    ilog("Migrating token database into column families...");
+
+    // tokens are prefixed by their domains
+    auto domains = std::vector<name128>();
+    read_tokens_range(token_type::domain, action_key_prefixes[(int)token_type::domain], 0, [&](auto& key, auto&&) {
+        auto name = name128();
+        memcpy(&name, key.data(), sizeof(name));
+        domains.emplace_back(name);
+        return true;
+    });
+
+    auto tokens = 0;
+    for(auto& d : domains) {
+        tokens += migrate_prefix(d, kTokensColumn);
+    }
+    auto history = migrate_prefix(action_key_prefixes[(int)token_type::jmzklink], kHistoryColumn)
+                 + migrate_prefix(action_key_prefixes[(int)token_type::psvbonus_dist], kHistoryColumn);
 
-    if(load_persistence) {
-        load_savepoints();
+    db_->Delete(sync_write_opts, handles_[kMetaColumn], mark.as_slice());
+    for(auto h : handles_) {
+        db_->Flush(rocksdb::FlushOptions(), h);
     }
+
+    ilog("Migrating token database into column families... Done, ${t} tokens in ${d} domains and ${h} histories moved",
+        ("t",tokens)("d",domains.size())("h",history));
 }
 
 void
 token_database_impl::close(int persist) {
+    if(stats_collector_.has_value()) {
+        utilities::metrics::registry::instance().remove_collector(*stats_collector_);
+        stats_collector_.reset();
+    }
     if(db_) {
-        if(persist) {
+        if(journal_.is_open()) {
+            // savepoints are all in the journal already
+            if(persist) {
+                journal_.sync();
+            }
+            journal_.close();
+        }
+        else if(persist) {
             persist_savepoints();
         }
         if(!savepoints_.empty()) {
             free_all_savepoints();
         }
         
-        delete tokens_handle_;
-        delete assets_handle_;
+        for(auto& h : handles_) {
+            db_->DestroyColumnFamilyHandle(h);
+            h = nullptr;
+        }
         delete db_;
 
         db_ = nullptr;
+        caches_.fill(nullptr);
     }
 }
 
@@ -638,8 +1551,12 @@ void
 token_database_impl::put_token(token_type type, action_op op, const name128& prefix, const name128& key, const std::string_view& data) {
     using namespace internal;
 
-    auto dbkey  = db_token_key(prefix, key);
-    auto status = db_->Put(write_opts_, dbkey.as_slice(), data);
+    auto dbkey = db_token_key(prefix, key);
+    if(should_record() && capture_undo(type, op, dbkey.as_slice())) {
+        journal_.flush();
+    }
+
+    auto status = db_->Put(write_opts_, get_handle(type), dbkey.as_slice(), data);
     if(!status.ok()) {
         FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
     }
@@ -674,9 +1591,20 @@ token_database_impl::put_tokens(token_type type,
     using namespace internal;
     assert(keys.size() == data.size());
 
+    auto handle = get_handle(type);
+    if(should_record()) {
+        // undo records of all the keys are flushed at once ahead of the writes
+        auto journaled = false;
+        for(auto& k : keys) {
+            journaled |= capture_undo(type, op, db_token_key(prefix, k).as_slice());
+        }
+        if(journaled) {
+            journal_.flush();
+        }
+    }
     for(auto i = 0u; i < keys.size(); i++) {
         auto dbkey  = db_token_key(prefix, keys[i]);
-        auto status = db_->Put(write_opts_, dbkey.as_slice(), data[i]);
+        auto status = db_->Put(write_opts_, handle, dbkey.as_slice(), data[i]);
         if(!status.ok()) {
             FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
         }
@@ -697,10 +1625,13 @@ token_database_impl::put_asset(const address& addr, const symbol_id_type sym_id,
     auto dbkey = db_asset_key(addr, sym_id);
     if(should_record()) {
         assets_write_cache_.put(dbkey.as_string_view(), data);
+        if(journal_.is_open()) {
+            journal_.add_put_record(dbkey.as_string_view(), data);
+        }
         return;
     }
     else {
-        auto status = db_->Put(write_opts_, assets_handle_, dbkey.as_slice(), data);
+        auto status = db_->Put(write_opts_, get_handle(token_type::asset), dbkey.as_slice(), data);
         if(!status.ok()) {
             FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
         }
@@ -708,12 +1639,12 @@ token_database_impl::put_asset(const address& addr, const symbol_id_type sym_id,
 }
 
 int
-token_database_impl::exists_token(const name128& prefix, const name128& key) const {
+token_database_impl::exists_token(token_type type, const name128& prefix, const name128& key) const {
     using namespace internal;
 
     auto dbkey  = db_token_key(prefix, key);
-    auto value  = std::string();
-    auto status = db_->Get(read_opts_, dbkey.as_slice(), &value);
+    auto value  = rocksdb::PinnableSlice();
+    auto status = db_->Get(read_opts_, get_handle(type), dbkey.as_slice(), &value);
     return status.ok();
 }
 
@@ -722,21 +1653,29 @@ token_database_impl::exists_asset(const address& addr, const symbol_id_type sym_
     using namespace internal;
 
     auto dbkey  = db_asset_key(addr, sym_id);
-    auto value  = std::string();
+    auto value  = rocksdb::PinnableSlice();
 
     if(assets_write_cache_.exists(dbkey.as_string_view())) {
         return true;
     }
-    auto status = db_->Get(read_opts_, assets_handle_, dbkey.as_slice(), &value);
+    auto status = db_->Get(read_opts_, get_handle(token_type::asset), dbkey.as_slice(), &value);
     return status.ok();
 }
 
 int
-token_database_impl::read_token(const name128& prefix, const name128& key, std::string& out, bool no_throw) const {
+token_database_impl::read_token(token_type type, const name128& prefix, const name128& key, std::string& out, bool no_throw) const {
+    return read_token_view(type, prefix, key, [&out](auto& v) { out.assign(v.data(), v.size()); }, no_throw);
+}
+
+int
+token_database_impl::read_token_view(token_type type, const name128& prefix, const name128& key, const read_view_func& func, bool no_throw) const {
     using namespace internal;
 
+    // value is pinned in the block cache if it's there, no copy is made
     auto dbkey  = db_token_key(prefix, key);
-    auto status = db_->Get(read_opts_, dbkey.as_slice(), &out);
+    auto value  = rocksdb::PinnableSlice();
+    auto status = db_->Get(read_opts_, get_handle(type), dbkey.as_slice(), &value);
+    token_reads_.inc();
     if(!status.ok()) {
         if(!status.IsNotFound()) {
             FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
@@ -746,19 +1685,82 @@ token_database_impl::read_token(const name128& prefix, const name128& key, std::
         }
         return false;
     }
+    func(std::string_view(value.data(), value.size()));
     return true;
 }
 
+int
+token_database_impl::read_tokens(token_type type, const name128& prefix, const small_vector_base<name128>& keys, const read_batch_func& func) const {
+    using namespace internal;
+
+    if(keys.empty()) {
+        return 0;
+    }
+
+    // all the db keys are laid out in one buffer
+    auto buf    = std::string(keys.size() * sizeof(name128) * 2, '\0');
+    auto slices = std::vector<rocksdb::Slice>();
+    slices.reserve(keys.size());
+    for(auto i = 0u; i < keys.size(); i++) {
+        auto p = buf.data() + i * sizeof(name128) * 2;
+        memcpy(p, &prefix, sizeof(name128));
+        memcpy(p + sizeof(name128), &keys[i], sizeof(name128));
+        slices.emplace_back(p, sizeof(name128) * 2);
+    }
+
+    // one MultiGet shares the snapshot and the version of memtables and files among all the keys
+    auto handles = std::vector<rocksdb::ColumnFamilyHandle*>(keys.size(), get_handle(type));
+    auto values  = std::vector<std::string>();
+    auto status  = db_->MultiGet(read_opts_, handles, slices, &values);
+    token_reads_.inc(keys.size());
+
+    auto found = 0;
+    for(auto i = 0u; i < keys.size(); i++) {
+        if(!status[i].ok()) {
+            if(!status[i].IsNotFound()) {
+                FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status[i].getState()));
+            }
+            continue;
+        }
+        found++;
+        func(i, values[i]);
+    }
+    return found;
+}
+
+void
+token_database_impl::prefetch_asset(const address& addr, const symbol_id_type sym_id) const {
+    using namespace internal;
+
+    // write cache is not thread-safe and is skipped, the value is only brought into block cache
+    auto dbkey  = db_asset_key(addr, sym_id);
+    auto value  = rocksdb::PinnableSlice();
+    auto status = db_->Get(read_opts_, get_handle(token_type::asset), dbkey.as_slice(), &value);
+    if(!status.ok() && !status.IsNotFound()) {
+        FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+    }
+}
+
 int
 token_database_impl::read_asset(const address& addr, const symbol_id_type sym_id, std::string& out, bool no_throw) const {
+    return read_asset_view(addr, sym_id, [&out](auto& v) { out.assign(v.data(), v.size()); }, no_throw);
+}
+
+int
+token_database_impl::read_asset_view(const address& addr, const symbol_id_type sym_id, const read_view_func& func, bool no_throw) const {
     using namespace internal;
 
     auto key = db_asset_key(addr, sym_id);
-    if(assets_write_cache_.read(key.as_string_view(), out)) {
+    auto cv  = std::string_view();
+    if(assets_write_cache_.read_view(key.as_string_view(), cv)) {
+        asset_cache_reads_.inc();
+        func(cv);
         return true;
     }
 
-    auto status = db_->Get(read_opts_, assets_handle_, key.as_slice(), &out);
+    auto value  = rocksdb::PinnableSlice();
+    auto status = db_->Get(read_opts_, get_handle(token_type::asset), key.as_slice(), &value);
+    asset_db_reads_.inc();
     if(!status.ok()) {
         if(!status.IsNotFound()) {
             FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
@@ -768,14 +1770,15 @@ token_database_impl::read_asset(const address& addr, const symbol_id_type sym_id
         }
         return false;
     }
+    func(std::string_view(value.data(), value.size()));
     return true;
 }
 
 int
-token_database_impl::read_tokens_range(const name128& prefix, int skip, const read_value_func& func) const {
+token_database_impl::read_tokens_range(token_type type, const name128& prefix, int skip, const read_value_func& func) const {
     using namespace internal;
 
-    auto it    = db_->NewIterator(read_opts_);
+    auto it    = db_->NewIterator(read_opts_, get_handle(type));
     auto key   = rocksdb::Slice((char*)&prefix, sizeof(prefix));
     auto i     = 0;
     auto count = 0;
@@ -810,14 +1813,12 @@ token_database_impl::read_assets_range(const symbol_id_type sym_id, int skip, co
     auto ss = db_->GetSnapshot();
     
     // write new values from cache into db
-    for(auto& it : assets_write_cache_.data_) {
-        auto k = rocksdb::Slice(it.first().data(), it.first().size());
-        auto v = rocksdb::Slice(it.second.value.data(), it.second.value.size());
-        db_->Put(write_opts_, assets_handle_, k, v);
-    }
+    assets_write_cache_.for_each([&](const auto& k, const auto& v) {
+        db_->Put(write_opts_, get_handle(token_type::asset), k, v);
+    });
 
     // scan values
-    auto it    = db_->NewIterator(read_opts_, assets_handle_);
+    auto it    = db_->NewIterator(read_opts_, get_handle(token_type::asset));
     auto key   = rocksdb::Slice((char*)&sym_id, sizeof(sym_id));
     auto count = 0;
     auto i     = 0;
@@ -847,22 +1848,21 @@ token_database_impl::read_assets_range(const symbol_id_type sym_id, int skip, co
     snapshot_read_opts_.snapshot = ss;
 
     auto batch = rocksdb::WriteBatch();
-    for(auto& it : assets_write_cache_.data_) {
+    assets_write_cache_.for_each([&](const auto& k, const auto&) {
         auto v = std::string();
-        auto k = rocksdb::Slice(it.first().data(), it.first().size());
-        auto s = db_->Get(snapshot_read_opts_, assets_handle_, k, &v);
+        auto s = db_->Get(snapshot_read_opts_, get_handle(token_type::asset), k, &v);
         if(s.ok()) {
             // put value back
-            batch.Put(assets_handle_, k, v);
+            batch.Put(get_handle(token_type::asset), k, v);
         }
         else if(s.code() == rocksdb::Status::kNotFound) {
             // remove value
-            batch.Delete(assets_handle_, k);
+            batch.Delete(get_handle(token_type::asset), k);
         }
         else {
             FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", s.getState()));
         }
-    }
+    });
     auto sync_write_opts = write_opts_;
     sync_write_opts.sync = true;
     db_->Write(sync_write_opts, &batch);
@@ -883,10 +1883,18 @@ token_database_impl::add_savepoint(int64_t seq) {
     }
 
     savepoints_.push_back(savepoint(seq, kRuntime));
-    auto rt = new rt_group { .rb_snapshot = (const void*)db_->GetSnapshot(), .actions = {} }; 
+    auto rt = new rt_group {
+        .rb_snapshot = (const void*)db_->GetSnapshot(),
+        .actions     = {},
+        .undo        = (config_.enable_undo_log || config_.enable_journal) ? std::make_unique<undo_log>() : nullptr
+    };
     SETPOINTER(void, savepoints_.back().node.group, rt);
 
     assets_write_cache_.add_savepoint(seq);
+
+    if(journal_.is_open()) {
+        journal_.add_seq_record(savepoint_journal::kSavepoint, seq);
+    }
 }
 
 void
@@ -899,21 +1907,7 @@ token_database_impl::free_savepoint(internal::savepoint& sp) {
     case kRuntime: {
         auto rt = GETPOINTER(rt_group, n.group);
         for(auto& act : rt->actions) {
-            switch(act.get_data_type()) {
-            case kTokenKey:
-            case kTokenFullKey:
-            case kAssetKey: {
-                free(GETPOINTER(void, act.data));
-                break;
-            }
-            case kTokenKeys: {
-                auto p = GETPOINTER(rt_token_keys, act.data);
-                //need to call dtor of keys manually
-                p->keys.~token_keys_t();
-                free(p);
-                break;
-            }
-            }  // switch
+            free_rt_action(act);
         }
         db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
         delete rt;
@@ -937,6 +1931,16 @@ token_database_impl::free_all_savepoints() {
 
 void
 token_database_impl::pop_savepoints(int64_t until) {
+    using namespace internal;
+
+    if(savepoints_.empty() || savepoints_.front().seq >= until) {
+        return;
+    }
+    if(journal_.is_open()) {
+        // savepoints must be durable before their assets get persisted
+        journal_.sync();
+    }
+
     while(!savepoints_.empty() && savepoints_.front().seq < until) {
         auto it = std::move(savepoints_.front());
         savepoints_.pop_front();
@@ -944,13 +1948,24 @@ token_database_impl::pop_savepoints(int64_t until) {
 
         // pop write cache and persist into underlying db
         assert(assets_write_cache_.ops_.front().seq == it.seq);
-        auto batch = rocksdb::WriteBatch();
-        assets_write_cache_.pop_front([&](auto& k, auto&& v) {
-            batch.Put(assets_handle_, rocksdb::Slice(k.data(), k.size()), v);
+        auto batch = rocksdb::WriteBatch(assets_write_cache_.front_batch_size());
+        assets_write_cache_.pop_front([&](auto& k, auto& v) {
+            batch.Put(get_handle(token_type::asset), k, v);
         });
         auto sync_write_opts = write_opts_;
         sync_write_opts.sync = true;
         db_->Write(sync_write_opts, &batch);
+
+        if(journal_.is_open()) {
+            journal_.add_record(savepoint_journal::kPopFront);
+        }
+    }
+
+    if(journal_.is_open()) {
+        journal_.sync();
+        if(journal_.size() > config_.journal_compact_size && journal_.size() > 2 * journal_checkpoint_size_) {
+            checkpoint_journal();
+        }
     }
 }
 
@@ -963,6 +1978,10 @@ token_database_impl::pop_back_savepoint() {
     free_savepoint(it);
 
     assets_write_cache_.pop_back();
+
+    if(journal_.is_open()) {
+        journal_.add_record(savepoint_journal::kPopBack);
+    }
 }
 
 void
@@ -983,11 +2002,38 @@ token_database_impl::squash() {
     // add all actions from rt1 into end of rt2
     rt2->actions.insert(rt2->actions.cend(), rt1->actions.cbegin(), rt1->actions.cend());
 
+    // values captured in rt2 are older, only the keys first written in rt1 are taken
+    if(rt2->undo != nullptr && rt1->undo != nullptr) {
+        for(auto& it : *rt1->undo) {
+            auto r = rt2->undo->try_emplace(it.first(), it.second);
+            if(r.second && !it.second.value.empty()) {
+                auto buf = (char*)rt2->undo->getAllocator().Allocate(it.second.value.size(), 1);
+                memcpy(buf, it.second.value.data(), it.second.value.size());
+                r.first->second.value = llvm::StringRef(buf, it.second.value.size());
+            }
+        }
+    }
+    else {
+        // falls back to read old values from snapshot
+        rt2->undo.reset();
+    }
+
     // just release rt1's snapshot
     db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt1->rb_snapshot);
     delete rt1;
 
     assets_write_cache_.squash();
+
+    if(journal_.is_open()) {
+        journal_.add_record(savepoint_journal::kSquash);
+    }
+}
+
+void
+token_database_impl::sync_savepoints() {
+    if(journal_.is_open()) {
+        journal_.sync();
+    }
 }
 
 int64_t
@@ -1018,6 +2064,98 @@ token_database_impl::record(uint8_t action_type, uint8_t op, uint8_t data_type,
     GETPOINTER(rt_group, n.group)->actions.emplace_back(rt_action(action_type, op, data_type, data));
 }
 
+// returns true if an undo record is appended to the journal, the caller flushes it before writing the key.
+// Flushing is a `write(2)` without sync, which covers process crashes: the record reaches page cache ahead
+// of the token write. A power loss between two commit points may still lose records of the writes kept by
+// the unsynced WAL of rocksdb, only the savepoints of committed blocks are durable. Syncing here would cost
+// one fdatasync per key instead of one per block.
+bool
+token_database_impl::capture_undo(token_type type, action_op op, const rocksdb::Slice& key) {
+    using namespace internal;
+
+    auto n = savepoints_.back().node;
+    if(n.f.type != kRuntime) {
+        return false;
+    }
+    auto rt = GETPOINTER(rt_group, n.group);
+    if(rt->undo == nullptr) {
+        return false;
+    }
+
+    // only the value before the first write in this savepoint is restored
+    auto r = rt->undo->try_emplace(llvm::StringRef(key.data(), key.size()), undo_value { (uint8_t)type, 0, llvm::StringRef() });
+    if(!r.second) {
+        return false;
+    }
+    // key cannot exist before `add`, so there is nothing to capture.
+    // The read below is paid once per key per savepoint, not per write, and only with undo log enabled.
+    // Callers write serialized tokens and never hold the old bytes, and the contracts have read the same
+    // key right before updating it, so the value is served from memtable or block cache. It replaces the
+    // snapshot read that rollback without undo log does for every updated key.
+    if(op != action_op::add) {
+        auto value  = rocksdb::PinnableSlice();
+        auto status = db_->Get(read_opts_, get_handle(type), key, &value);
+        if(status.ok()) {
+            auto buf = (char*)rt->undo->getAllocator().Allocate(value.size(), 1);
+            memcpy(buf, value.data(), value.size());
+
+            r.first->second.exists = 1;
+            r.first->second.value  = llvm::StringRef(buf, value.size());
+        }
+        else if(!status.IsNotFound()) {
+            FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
+        }
+    }
+
+    if(!journal_.is_open()) {
+        return false;
+    }
+    // tokens are written into db directly, so the old value must reach the journal ahead of the write
+    auto& v = r.first->second;
+    journal_.add_undo_record(v.type, v.exists, std::string_view(key.data(), key.size()), std::string_view(v.value.data(), v.value.size()));
+    return true;
+}
+
+void
+token_database_impl::rollback_undo_log(internal::rt_group* rt) {
+    using namespace internal;
+
+    // old values are all in the log, rollback is a single write without reading the snapshot
+    auto batch = rocksdb::WriteBatch();
+    for(auto& it : *rt->undo) {
+        auto  key    = rocksdb::Slice(it.first().data(), it.first().size());
+        auto& v      = it.second;
+        auto  handle = get_handle((token_type)v.type);
+
+        if(v.exists) {
+            batch.Put(handle, key, rocksdb::Slice(v.value.data(), v.value.size()));
+        }
+        else {
+            batch.Delete(handle, key);
+        }
+    }
+
+    auto sync_write_opts = write_opts_;
+    sync_write_opts.sync = true;
+    db_->Write(sync_write_opts, &batch);
+
+    // signals are emitted after the write, so that the values read by other threads afterwards are the old ones
+    for(auto& it : *rt->undo) {
+        auto key = rocksdb::Slice(it.first().data(), it.first().size());
+        if(it.second.exists) {
+            self_.rollback_token_value(key);
+        }
+        else {
+            self_.remove_token_value(key);
+        }
+    }
+
+    for(auto& act : rt->actions) {
+        free_rt_action(act);
+    }
+    db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
+}
+
 namespace internal {
 
 std::string
@@ -1052,23 +2190,31 @@ token_database_impl::rollback_rt_group(internal::rt_group* rt) {
         db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
         return;
     }
+    if(rt->undo != nullptr) {
+        rollback_undo_log(rt);
+        return;
+    }
 
     auto snapshot_read_opts_     = read_opts_;
     snapshot_read_opts_.snapshot = (const rocksdb::Snapshot*)rt->rb_snapshot;
 
     auto key_set = keys_hash_set();
     auto batch   = rocksdb::WriteBatch();
+    auto removed = std::vector<std::string>();
+    auto rolled  = std::vector<std::string>();
     
     for(auto it = rt->actions.begin(); it < rt->actions.end(); it++) {
         auto data = GETPOINTER(void, it->data);
 
         auto fn = [&](auto& key, auto type, auto op) {
+            auto handle = get_handle(type);
+
             switch(op) {
             case action_op::add: {
                 assert(key_set.find(key) == key_set.end());
 
-                batch.Delete(key);
-                self_.remove_token_value(key);
+                batch.Delete(handle, key);
+                removed.emplace_back(key);
             
                 // insert key into key set
                 key_set.insert(key);
@@ -1080,12 +2226,12 @@ token_database_impl::rollback_rt_group(internal::rt_group* rt) {
                     break;
                 }
                 auto old_value = std::string();
-                auto status    = db_->Get(snapshot_read_opts_, key, &old_value);
+                auto status    = db_->Get(snapshot_read_opts_, handle, key, &old_value);
                 if(!status.ok()) {
                     FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
                 }
-                batch.Put(key, old_value);
-                self_.rollback_token_value(key);
+                batch.Put(handle, key, old_value);
+                rolled.emplace_back(key);
 
                 // insert key into key set
                 key_set.insert(key);
@@ -1097,8 +2243,6 @@ token_database_impl::rollback_rt_group(internal::rt_group* rt) {
                     break;
                 }
 
-                // Asset type only has put op
-                auto handle    = (type == token_type::asset) ? assets_handle_ : tokens_handle_;
                 auto old_value = std::string();
                 auto status    = db_->Get(snapshot_read_opts_, handle, key, &old_value);
 
@@ -1108,14 +2252,14 @@ token_database_impl::rollback_rt_group(internal::rt_group* rt) {
                         FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
                     }
                     batch.Delete(handle, key);
-                    if(handle == tokens_handle_) {
-                        self_.remove_token_value(key);
+                    if(type != token_type::asset) {
+                        removed.emplace_back(key);
                     }
                 }
                 else {
                     batch.Put(handle, key, old_value);
-                    if(handle == tokens_handle_) {
-                        self_.rollback_token_value(key);
+                    if(type != token_type::asset) {
+                        rolled.emplace_back(key);
                     }
                 }
 
@@ -1159,6 +2303,14 @@ token_database_impl::rollback_rt_group(internal::rt_group* rt) {
     sync_write_opts.sync = true;
     db_->Write(sync_write_opts, &batch);
 
+    // signals are emitted after the write, same as rolling back from undo log
+    for(auto& key : removed) {
+        self_.remove_token_value(key);
+    }
+    for(auto& key : rolled) {
+        self_.rollback_token_value(key);
+    }
+
     db_->ReleaseSnapshot((const rocksdb::Snapshot*)rt->rb_snapshot);
 }
 
@@ -1176,20 +2328,20 @@ token_database_impl::rollback_pd_group(internal::pd_group* pd) {
     // because cache cannot have persist value objects
     auto batch = rocksdb::WriteBatch();
     for(auto it = pd->actions.begin(); it < pd->actions.end(); it++) {
+        auto handle = get_handle((token_type)it->type);
+
         switch((action_op)it->op) {
         case action_op::add: {
             assert(it->value.empty());
-            batch.Delete(it->key);
+            batch.Delete(handle, it->key);
             break;
         }
         case action_op::update: {
             assert(!it->value.empty());
-            batch.Put(it->key, it->value);
+            batch.Put(handle, it->key, it->value);
             break;
         }
         case action_op::put: {
-            // Asset type only has put op
-            auto handle = (it->type == (int)token_type::asset) ? assets_handle_ : tokens_handle_;
             if(it->value.empty()) {
                 batch.Delete(handle, it->key);
             }
@@ -1235,6 +2387,11 @@ token_database_impl::rollback_to_latest_savepoint() {
 
     assert(seq == assets_write_cache_.ops_.back().seq);
     assets_write_cache_.rollback_to_latest_savepoint();
+
+    if(journal_.is_open()) {
+        journal_.add_record(savepoint_journal::kRollback);
+        journal_.flush();
+    }
 }
 
 void
@@ -1328,7 +2485,8 @@ token_database_impl::persist_savepoints(std::ostream& os) const {
                 auto data = GETPOINTER(void, act.data);
 
                 auto fn = [&](const auto& key, auto type, auto op) {
-                    auto value = std::string();
+                    auto value  = std::string();
+                    auto handle = get_handle(type);
 
                     switch(op) {
                     case action_op::add: {
@@ -1343,7 +2501,7 @@ token_database_impl::persist_savepoints(std::ostream& os) const {
                             break;
                         }
 
-                        auto status = db_->Get(snapshot_read_opts_, key, &value);
+                        auto status = db_->Get(snapshot_read_opts_, handle, key, &value);
                         if(!status.ok()) {
                             FC_THROW_EXCEPTION(fc::unrecoverable_exception, "Rocksdb internal error: ${err}", ("err", status.getState()));
                         }
@@ -1356,7 +2514,6 @@ token_database_impl::persist_savepoints(std::ostream& os) const {
                             break;
                         }
 
-                        auto handle = (type == token_type::asset) ? assets_handle_ : tokens_handle_;
                         auto status = db_->Get(snapshot_read_opts_, handle, key, &value);
                         
                         // key may not existed in latest snapshot
@@ -1430,6 +2587,193 @@ token_database_impl::load_savepoints(std::istream& is) {
     }
 }
 
+void
+token_database_impl::replay_journal() {
+    using namespace internal;
+
+    auto filename = get_journal_path();
+    auto size     = (size_t)fc::file_size(filename);
+    auto valid    = size_t(0);
+
+    // delete old savepoints if existed (from snapshot)
+    savepoints_.clear();
+    assets_write_cache_.clear();
+
+    // undo records are loaded as persist savepoints
+    auto groups = std::deque<pd_group>();
+    auto check  = [&](size_t n) {
+        jmzk_ASSERT(groups.size() >= n, token_database_journal_exception, "Invalid savepoints journal: ${n} savepoints are required", ("n", n));
+    };
+
+    try {
+        if(size > 0) {
+            auto mapping = fc::file_mapping(filename.to_native_ansi_path().c_str(), fc::read_only);
+            auto region  = fc::mapped_region(mapping, fc::read_only, 0, size);
+
+            valid = savepoint_journal::replay((const char*)region.get_address(), size, [&](auto type, auto& ds) {
+                switch(type) {
+                case savepoint_journal::kSavepoint:
+                case savepoint_journal::kGroup: {
+                    auto seq = jnl_read<int64_t>(ds);
+                    groups.emplace_back(pd_group { .seq = seq, .actions = {} });
+                    if(type == savepoint_journal::kSavepoint) {
+                        assets_write_cache_.add_savepoint(seq);
+                    }
+                    break;
+                }
+                case savepoint_journal::kUndo: {
+                    check(1);
+                    auto t      = jnl_read<uint8_t>(ds);
+                    auto exists = jnl_read<uint8_t>(ds);
+                    auto key    = jnl_read_str(ds);
+                    auto value  = jnl_read_str(ds);
+
+                    groups.back().actions.emplace_back(pd_action {
+                        .op    = (uint16_t)(exists ? action_op::put : action_op::add),
+                        .type  = t,
+                        .key   = std::string(key),
+                        .value = std::string(exists ? value : std::string_view())
+                    });
+                    break;
+                }
+                case savepoint_journal::kPut: {
+                    check(1);
+                    auto key   = jnl_read_str(ds);
+                    auto value = jnl_read_str(ds);
+                    jmzk_ASSERT(key.size() == write_cache_layer::kKeySize, token_database_journal_exception, "Invalid asset key in savepoints journal");
+
+                    assets_write_cache_.put(key, value);
+                    break;
+                }
+                case savepoint_journal::kRollback: {
+                    check(1);
+                    groups.pop_back();
+                    assets_write_cache_.rollback_to_latest_savepoint();
+                    break;
+                }
+                case savepoint_journal::kSquash: {
+                    check(2);
+                    auto& g1 = groups[groups.size() - 1];
+                    auto& g2 = groups[groups.size() - 2];
+
+                    // values captured in g2 are older, only the keys first written in g1 are taken
+                    auto keys = keys_hash_set();
+                    for(auto& act : g2.actions) {
+                        keys.insert(act.key);
+                    }
+                    for(auto& act : g1.actions) {
+                        if(keys.insert(act.key).second) {
+                            g2.actions.emplace_back(std::move(act));
+                        }
+                    }
+                    groups.pop_back();
+                    assets_write_cache_.squash();
+                    break;
+                }
+                case savepoint_journal::kPopFront: {
+                    check(1);
+                    groups.pop_front();
+                    // values are persisted into db before the record is written
+                    assets_write_cache_.pop_front([](auto&, auto&) {});
+                    break;
+                }
+                case savepoint_journal::kPopBack: {
+                    check(1);
+                    groups.pop_back();
+                    assets_write_cache_.pop_back();
+                    break;
+                }
+                case savepoint_journal::kLayerState: {
+                    jmzk_ASSERT(groups.empty(), token_database_journal_exception, "Invalid savepoints journal: layer state is not the first record");
+                    assets_write_cache_.load_state(ds);
+                    break;
+                }
+                default: {
+                    jmzk_THROW(token_database_journal_exception, "Unknown record type in savepoints journal: ${t}", ("t", (int)type));
+                }
+                }  // switch
+            });
+        }
+
+        if(valid < size) {
+            wlog("Drop torn tail of savepoints journal, ${v} of ${s} bytes are valid", ("v",valid)("s",size));
+            fc::resize_file(filename, valid);
+        }
+    }
+    jmzk_CAPTURE_AND_RETHROW(token_database_journal_exception);
+
+    for(auto& pd : groups) {
+        savepoints_.push_back(savepoint(pd.seq, kPersist));
+
+        auto ppd = new pd_group(std::move(pd));
+        SETPOINTER(void, savepoints_.back().node.group, ppd);
+    }
+    ilog("Replayed savepoints journal of token database, ${n} savepoints restored", ("n",savepoints_.size()));
+}
+
+void
+token_database_impl::checkpoint_journal() {
+    using namespace internal;
+
+    try {
+        auto filename = get_journal_path();
+        auto tmpname  = fc::path(filename.to_native_ansi_path() + ".tmp");
+
+        journal_.close();
+        if(fc::exists(tmpname)) {
+            fc::remove(tmpname);
+        }
+
+        // new journal is written aside and replaces the old one at once
+        auto jnl = savepoint_journal();
+        jnl.open(tmpname);
+        jnl.add_layer_record(assets_write_cache_);
+
+        for(auto i = 0u; i < savepoints_.size(); i++) {
+            auto& sp = savepoints_[i];
+            jnl.add_seq_record(savepoint_journal::kGroup, sp.seq);
+
+            auto n = sp.node;
+            switch(n.f.type) {
+            case kRuntime: {
+                auto rt = GETPOINTER(rt_group, n.group);
+                assert(rt->undo != nullptr);
+
+                for(auto& it : *rt->undo) {
+                    auto& v = it.second;
+                    jnl.add_undo_record(v.type, v.exists, std::string_view(it.first().data(), it.first().size()),
+                        std::string_view(v.value.data(), v.value.size()));
+                }
+                break;
+            }
+            case kPersist: {
+                auto pd   = GETPOINTER(pd_group, n.group);
+                auto keys = keys_hash_set();
+
+                for(auto& act : pd->actions) {
+                    // only the first action of each key holds its old value
+                    if(!keys.insert(act.key).second) {
+                        continue;
+                    }
+                    auto exists = (action_op)act.op != action_op::add && !act.value.empty();
+                    jnl.add_undo_record((uint8_t)act.type, exists, act.key, act.value);
+                }
+                break;
+            }
+            }  // switch
+        }
+        jnl.sync();
+        jnl.close();
+
+        fc::rename(tmpname, filename);
+        sync_directory(config_.db_path);
+
+        journal_.open(filename);
+        journal_checkpoint_size_ = journal_.size();
+    }
+    jmzk_CAPTURE_AND_RETHROW(token_database_journal_exception);
+}
+
 void
 token_database_impl::flush() const {
     auto status = db_->Flush(rocksdb::FlushOptions());
@@ -1491,7 +2835,7 @@ token_database::exists_token(token_type type, const std::optional<name128>& doma
     assert(type != token_type::asset);
     assert((type == token_type::token) != (!domain.has_value()));
     auto& prefix = domain.has_value() ? *domain : action_key_prefixes[(int)type];
-    return my_->exists_token(prefix, key);
+    return my_->exists_token(type, prefix, key);
 }
 
 int
@@ -1506,7 +2850,7 @@ token_database::read_token(token_type type, const std::optional<name128>& domain
     assert(type != token_type::asset);
     assert((type == token_type::token) != (!domain.has_value()));
     auto& prefix = domain.has_value() ? *domain : action_key_prefixes[(int)type];
-    return my_->read_token(prefix, key, out, no_throw);
+    return my_->read_token(type, prefix, key, out, no_throw);
 }
 
 int
@@ -1514,6 +2858,36 @@ token_database::read_asset(const address& addr, const symbol_id_type sym_id, std
     return my_->read_asset(addr, sym_id, out, no_throw);
 }
 
+int
+token_database::read_token_view(token_type type, const std::optional<name128>& domain, const name128& key, const read_view_func& func, bool no_throw) const {
+    using namespace internal;
+
+    assert(type != token_type::asset);
+    assert((type == token_type::token) != (!domain.has_value()));
+    auto& prefix = domain.has_value() ? *domain : action_key_prefixes[(int)type];
+    return my_->read_token_view(type, prefix, key, func, no_throw);
+}
+
+int
+token_database::read_asset_view(const address& addr, const symbol_id_type sym_id, const read_view_func& func, bool no_throw) const {
+    return my_->read_asset_view(addr, sym_id, func, no_throw);
+}
+
+int
+token_database::read_tokens(token_type type, const std::optional<name128>& domain, const small_vector_base<name128>& keys, const read_batch_func& func) const {
+    using namespace internal;
+
+    assert(type != token_type::asset);
+    assert((type == token_type::token) != (!domain.has_value()));
+    auto& prefix = domain.has_value() ? *domain : action_key_prefixes[(int)type];
+    return my_->read_tokens(type, prefix, keys, func);
+}
+
+void
+token_database::prefetch_asset(const address& addr, const symbol_id_type sym_id) const {
+    my_->prefetch_asset(addr, sym_id);
+}
+
 int
 token_database::read_tokens_range(token_type type, const std::optional<name128>& domain, int skip, const read_value_func& func) const {
     using namespace internal;
@@ -1521,7 +2895,7 @@ token_database::read_tokens_range(token_type type, const std::optional<name128>&
     assert(type != token_type::asset);
     assert((type == token_type::token) != (!domain.has_value()));
     auto& prefix = domain.has_value() ? *domain : action_key_prefixes[(int)type];
-    return my_->read_tokens_range(prefix, skip, func);
+    return my_->read_tokens_range(type, prefix, skip, func);
 }
 
 int
@@ -1572,6 +2946,11 @@ token_database::squash() {
     my_->squash();
 }
 
+void
+token_database::sync_savepoints() {
+    my_->sync_savepoints();
+}
+
 int64_t
 token_database::latest_savepoint_seq() const {
     return my_->latest_savepoint_seq();
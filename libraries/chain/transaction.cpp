@@ -48,6 +48,25 @@ transaction::sig_digest(const chain_id_type& chain_id) const {
     return enc.result();
 }
 
+namespace internal {
+
+public_keys_set
+recover_signature_keys(const signatures_base_type& signatures, const digest_type& digest, bool allow_duplicate_keys) {
+    auto recovered_pub_keys = public_keys_set();
+    for(auto& sig : signatures) {
+        auto successful_insertion                   = false;
+        std::tie(std::ignore, successful_insertion) = recovered_pub_keys.emplace(sig, digest);
+        jmzk_ASSERT(allow_duplicate_keys || successful_insertion, tx_duplicate_sig,
+                   "transaction includes more than one signature signed using the same key associated with public "
+                   "key: ${key}",
+                   ("key", public_key_type(sig, digest)));
+    }
+
+    return recovered_pub_keys;
+}
+
+}  // namespace internal
+
 public_keys_set
 transaction::get_signature_keys(const signatures_base_type& signatures, const chain_id_type& chain_id,
                                 bool allow_duplicate_keys) const {
@@ -56,19 +75,7 @@ transaction::get_signature_keys(const signatures_base_type& signatures, const ch
     }
 
     try {
-        auto digest = sig_digest(chain_id);
-
-        auto recovered_pub_keys = public_keys_set();
-        for(auto& sig : signatures) {
-            auto successful_insertion                   = false;
-            std::tie(std::ignore, successful_insertion) = recovered_pub_keys.emplace(sig, digest);
-            jmzk_ASSERT(allow_duplicate_keys || successful_insertion, tx_duplicate_sig,
-                       "transaction includes more than one signature signed using the same key associated with public "
-                       "key: ${key}",
-                       ("key", public_key_type(sig, digest)));
-        }
-
-        return recovered_pub_keys;
+        return internal::recover_signature_keys(signatures, sig_digest(chain_id), allow_duplicate_keys);
     }
     FC_CAPTURE_AND_RETHROW()
 }
@@ -129,6 +136,53 @@ packed_transaction::packed_digest() const {
     return enc.result();
 }
 
+digest_type
+packed_transaction::sig_digest(const chain_id_type& chain_id) const {
+    return trx_sig_digest.get_or_compute(chain_id, [&] {
+        if(compression != none || !canonical_packed) {
+            return unpacked_trx.sig_digest(chain_id);
+        }
+
+        // uncompressed canonical packed trx is exactly the packed transaction, no need to pack again
+        digest_type::encoder enc;
+        fc::raw::pack(enc, chain_id);
+        enc.write(packed_trx.data(), packed_trx.size());
+        return enc.result();
+    });
+}
+
+public_keys_set
+packed_transaction::get_signature_keys(const chain_id_type& chain_id, bool allow_duplicate_keys) const {
+    if(signatures.empty()) {
+        return public_keys_set();
+    }
+
+    try {
+        return internal::recover_signature_keys(signatures, sig_digest(chain_id), allow_duplicate_keys);
+    }
+    FC_CAPTURE_AND_RETHROW()
+}
+
+void
+packed_transaction::compute_digests(const bytes& raw_trx) {
+    trx_id        = digest_type::hash(raw_trx.data(), raw_trx.size());
+    signed_trx_id = digest_type::hash(*this);
+}
+
+// Received bytes may use a non-canonical encoding (like non-minimal varints) which unpacks to the same
+// transaction. They are accepted as before, but the digests must match `transaction::id()` and
+// `sig_digest()`, so the received bytes are only hashed directly when they are canonical.
+void
+packed_transaction::compute_digests_unpacked(const bytes& raw_trx) {
+    auto canonical = fc::raw::pack(static_cast<const transaction&>(unpacked_trx));
+    if(canonical == raw_trx) {
+        compute_digests(raw_trx);
+        return;
+    }
+    canonical_packed = false;
+    compute_digests(canonical);
+}
+
 namespace bio = boost::iostreams;
 
 template <size_t Limit>
@@ -174,20 +228,13 @@ zlib_decompress(const bytes& data) {
     }
 }
 
-static transaction
-zlib_decompress_transaction(const bytes& data) {
-    bytes out = zlib_decompress(data);
-    return unpack_transaction(out);
-}
-
 static bytes
 pack_transaction(const transaction& t) {
     return fc::raw::pack(t);
 }
 
 static bytes
-zlib_compress_transaction(const transaction& t) {
-    auto in   = pack_transaction(t);
+zlib_compress(const bytes& in) {
     auto out  = bytes();
     auto comp = bio::filtering_ostream();
 
@@ -202,12 +249,17 @@ void
 packed_transaction::local_unpack_transaction() {
     try {
         switch(compression) {
-        case none:
+        case none: {
             unpacked_trx = signed_transaction(unpack_transaction(packed_trx), signatures);
+            compute_digests_unpacked(packed_trx);
             break;
-        case zlib:
-            unpacked_trx = signed_transaction(zlib_decompress_transaction(packed_trx), signatures);
+        }
+        case zlib: {
+            auto raw     = zlib_decompress(packed_trx);
+            unpacked_trx = signed_transaction(unpack_transaction(raw), signatures);
+            compute_digests_unpacked(raw);
             break;
+        }
         default:
             jmzk_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
         }
@@ -219,12 +271,17 @@ void
 packed_transaction::local_pack_transaction() {
     try {
         switch(compression) {
-        case none:
+        case none: {
             packed_trx = pack_transaction(unpacked_trx);
+            compute_digests(packed_trx);
             break;
-        case zlib:
-            packed_trx = zlib_compress_transaction(unpacked_trx);
+        }
+        case zlib: {
+            auto raw   = pack_transaction(unpacked_trx);
+            packed_trx = zlib_compress(raw);
+            compute_digests(raw);
             break;
+        }
         default:
             jmzk_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
         }
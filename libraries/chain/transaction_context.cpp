@@ -10,6 +10,7 @@
 #include <jmzk/chain/exceptions.hpp>
 #include <jmzk/chain/global_property_object.hpp>
 #include <jmzk/chain/transaction_object.hpp>
+#include <jmzk/utilities/metrics.hpp>
 
 namespace jmzk { namespace chain {
 
@@ -95,6 +96,9 @@ transaction_context::init_for_suspend_trx() {
 
 void
 transaction_context::exec() {
+    static auto& auth_histogram = utilities::metrics::registry::instance().get_histogram(
+        "jmzk_trx_authorization_us", "Time to check authorization of actions in microseconds");
+
     jmzk_ASSERT(is_initialized, transaction_exception, "must first initialize");
 
     const auto& keys  = trx_meta->recover_keys(control.get_chain_id());
@@ -102,6 +106,7 @@ transaction_context::exec() {
 
     for(auto& act : trx.actions) {
         if(check) {
+            auto timer = utilities::metrics::scoped_timer(auth_histogram);
             control.check_authorization(keys, act);
         }
 
@@ -170,13 +175,10 @@ transaction_context::check_charge() {
 
 #define READ_DB_ASSET_NO_THROW(ADDR, SYM_ID, VALUEREF)                     \
     {                                                                      \
-        auto str = std::string();                                          \
-        if(!tokendb.read_asset(ADDR, SYM_ID, str, true /* no throw */)) {  \
+        auto read = [&](auto& v) { extract_db_value(v, VALUEREF); };       \
+        if(!tokendb.read_asset_view(ADDR, SYM_ID, read, true)) {           \
             VALUEREF = property();                                         \
         }                                                                  \
-        else {                                                             \
-            extract_db_value(str, VALUEREF);                               \
-        }                                                                  \
     }
 
 void
@@ -252,7 +254,7 @@ transaction_context::finalize_pay() {
 
     auto act   = action();
     act.name   = contracts::paycharge::get_action_name();
-    act.data   = fc::raw::pack(pcact);
+    act.data   = action_data::from_value(pcact);
     act.domain = N128(.charge);
     
     switch(pcact.payer.type()) {
@@ -0,0 +1,85 @@
+/**
+ *  @file
+ *  @copyright defined in jmzk/LICENSE.txt
+ */
+#include <jmzk/chain/transaction_metadata.hpp>
+
+#include <algorithm>
+#include <jmzk/chain/thread_utils.hpp>
+#include <jmzk/utilities/metrics.hpp>
+
+namespace jmzk { namespace chain {
+
+using namespace contracts;
+
+namespace internal {
+
+inline bool
+has_link(const action& act) {
+    return act.name == N(everipass) || act.name == N(everipay);
+}
+
+}  // namespace internal
+
+const public_keys_set&
+transaction_metadata::recover_keys(const chain_id_type& chain_id) {
+    static auto& histogram = utilities::metrics::registry::instance().get_histogram(
+        "jmzk_trx_recover_keys_us", "Time to recover signing keys of transactions in microseconds");
+
+    if(!signing_keys.has_value() || signing_keys->first != chain_id) {  // Unlikely for more than one chain_id to be used in one nodeos instance
+        auto timer   = utilities::metrics::scoped_timer(histogram);
+        signing_keys = std::make_pair(chain_id, packed_trx->get_signature_keys(chain_id));
+    }
+    return signing_keys->second;
+}
+
+public_keys_set
+transaction_metadata::get_link_keys(const jmzk_link& link) const {
+    if(link_keys_future.valid()) {
+        auto& links = link_keys_future.get();
+        auto  it    = links.find(link.digest());
+        if(it != links.end() && it->second.signatures == link.get_signatures()) {
+            return it->second.keys;
+        }
+    }
+    return link.restore_keys();
+}
+
+void
+transaction_metadata::start_restore_link_keys(const transaction_metadata_ptr& mtrx, boost::asio::thread_pool& thread_pool) {
+    if(mtrx->link_keys_future.valid()) {
+        return;
+    }
+
+    auto& acts = mtrx->packed_trx->get_transaction().actions;
+    if(std::none_of(acts.cbegin(), acts.cend(), internal::has_link)) {
+        return;
+    }
+
+    // only reads `name` and `data` of actions, the decoded cache of action is left to main thread
+    mtrx->link_keys_future = async_thread_pool(thread_pool, [ptrx = mtrx->packed_trx]() {
+        auto links = link_keys_map();
+        for(auto& act : ptrx->get_transaction().actions) {
+            if(!internal::has_link(act)) {
+                continue;
+            }
+
+            try {
+                // link is always the first field in all the versions of everipass and everipay
+                auto ds   = fc::datastream<const char*>(act.data.data(), act.data.size());
+                auto link = jmzk_link();
+                fc::raw::unpack(ds, link);
+
+                auto& lk      = links[link.digest()];
+                lk.signatures = link.get_signatures();
+                lk.keys       = link.restore_keys();
+            }
+            catch(...) {
+                // invalid links are left to be reported by the contracts
+            }
+        }
+        return links;
+    });
+}
+
+}}  // namespace jmzk::chain
@@ -1,5 +1,7 @@
 
 #pragma once
+#include <utility>
+#include <vector>
 
 namespace fc {
 
@@ -28,6 +30,21 @@ public:
         }
     }
 
+    /**
+     * Appends the slot at the tail as it is and returns it.
+     * Popped elements are not destroyed, so the caller can reuse the buffers left in the slot.
+     */
+    T&
+    recycle_back() {
+        if(++tail_ >= capacity_) {
+            tail_ = 0;
+        }
+        if(head_ == tail_) {
+            expand();
+        }
+        return back();
+    }
+
     void
     pop_front() {
         assert(head_ != tail_);
@@ -106,7 +123,7 @@ private:
         auto new_vec = std::vector<T>();
         new_vec.resize(capacity_ * 2);
         for(auto i = 0u; i < capacity_; i++) {
-            new_vec[i] = buf_[(head_ + i) % capacity_];
+            new_vec[i] = std::move(buf_[(head_ + i) % capacity_]);
         }
 
         head_      = 0;
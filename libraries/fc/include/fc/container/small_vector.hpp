@@ -12,8 +12,15 @@ pack(Stream& s, const small_vector<T, N>& v) {
     FC_ASSERT(v.size() <= MAX_NUM_ARRAY_ELEMENTS);
     fc::raw::pack(s, unsigned_int((uint32_t)v.size()));
 
-    for(auto& e : v) {
-        fc::raw::pack(s, e);
+    if constexpr(is_trivially_packed_v<T>) {
+        if(v.size()) {
+            s.write((const char*)v.data(), v.size() * sizeof(T));
+        }
+    }
+    else {
+        for(auto& e : v) {
+            fc::raw::pack(s, e);
+        }
     }
 }
 
@@ -25,8 +32,15 @@ unpack(Stream& s, small_vector<T, N>& v) {
     FC_ASSERT(size.value <= MAX_NUM_ARRAY_ELEMENTS);
 
     v.resize(size.value);
-    for(auto& e : v) {
-        fc::raw::unpack(s, e);
+    if constexpr(is_trivially_packed_v<T>) {
+        if(v.size()) {
+            s.read((char*)v.data(), v.size() * sizeof(T));
+        }
+    }
+    else {
+        for(auto& e : v) {
+            fc::raw::unpack(s, e);
+        }
     }
 }
 
@@ -33,6 +33,12 @@ public:
     explicit public_key(const char* base58str);
     explicit operator string() const;
 
+    /**
+     * Strings of the hot keys are cached, at most `capacity` keys are kept and 0 disables the cache.
+     * The cache is disabled by default.
+     */
+    static void set_string_cache_capacity(size_t capacity);
+
 private:
     storage_type _storage;
 
@@ -46,6 +52,7 @@ private:
     friend bool operator<(const public_key& p1, const public_key& p2);
     
     friend struct reflector<public_key>;
+    friend struct std::hash<public_key>;
     friend class private_key;
 };  // public_key
 
@@ -56,4 +63,11 @@ void to_variant(const crypto::public_key& var, variant& vo);
 void from_variant(const variant& var, crypto::public_key& vo);
 }  // namespace fc
 
+namespace std {
+template<>
+struct hash<fc::crypto::public_key> {
+    size_t operator()(const fc::crypto::public_key& key) const;
+};
+}  // namespace std
+
 FC_REFLECT(fc::crypto::public_key, (_storage));
@@ -24,6 +24,22 @@ public:
     static sha256 hash(const string&);
     static sha256 hash(const sha256&);
 
+    /**
+     * Hashes `n` independent messages at once, `out[i]` is the same as `hash(d[i], dlen[i])`.
+     * Uses SHA-NI or 8-way AVX2 lanes when the cpu supports them and falls back to `hash` otherwise.
+     * `out` must not overlap with the input messages.
+     */
+    static void hash_many(const char* const* d, const uint32_t* dlen, size_t n, sha256* out);
+    // messages are `dlen` bytes each and stored one after another from `d`
+    static void hash_many(const char* d, uint32_t dlen, size_t n, sha256* out);
+
+    // implementations of `hash_many`, `scalar` calls `hash` for each message
+    enum class batch_impl { scalar = 0, shani, avx2 };
+
+    static bool batch_impl_supported(batch_impl impl);
+    // forces one implementation instead of the one picked from cpu features, for tests and benchmarks
+    static void hash_many(batch_impl impl, const char* const* d, const uint32_t* dlen, size_t n, sha256* out);
+
     template<typename T>
     static sha256 hash(const T& t) {
         sha256::encoder e;
@@ -123,3 +139,4 @@ struct hash<fc::sha256> {
 
 #include <fc/reflect/reflect.hpp>
 FC_REFLECT_TYPENAME(fc::sha256);
+FC_RAW_TRIVIALLY_PACKED(fc::sha256);
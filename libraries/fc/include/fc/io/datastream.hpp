@@ -1,6 +1,8 @@
 #pragma once
 #include <string.h>
 #include <stdint.h>
+#include <algorithm>
+#include <memory>
 #include <fc/utility.hpp>
 
 namespace fc {
@@ -109,6 +111,131 @@ private:
     size_t _size;
 };
 
+/**
+ *  Write-only stream which grows its buffer on demand, so an object can be packed
+ *  in a single pass instead of running the "test run" above first.
+ *  The first `N` bytes go to an inline buffer which is left uninitialized,
+ *  larger outputs are moved to a heap buffer that doubles when it's full.
+ */
+template<size_t N>
+class growable_datastream {
+public:
+    growable_datastream()
+        : _start(_inline)
+        , _pos(_inline)
+        , _end(_inline + N) {}
+
+    growable_datastream(const growable_datastream& rhs)
+        : growable_datastream() {
+        write(rhs._start, rhs.tellp());
+    }
+
+    growable_datastream(growable_datastream&& rhs) noexcept
+        : growable_datastream() {
+        take(rhs);
+    }
+
+    growable_datastream&
+    operator=(const growable_datastream& rhs) {
+        if(this != &rhs) {
+            _pos = _start;
+            write(rhs._start, rhs.tellp());
+        }
+        return *this;
+    }
+
+    growable_datastream&
+    operator=(growable_datastream&& rhs) noexcept {
+        if(this != &rhs) {
+            _heap.reset();
+            _start = _pos = _inline;
+            _end   = _inline + N;
+            take(rhs);
+        }
+        return *this;
+    }
+
+    inline bool skip(size_t s) {
+        reserve(s);
+        _pos += s;
+        return true;
+    }
+
+    inline bool write(const char* d, size_t s) {
+        reserve(s);
+        memcpy(_pos, d, s);
+        _pos += s;
+        return true;
+    }
+
+    inline bool put(char c) {
+        reserve(1);
+        *_pos++ = c;
+        return true;
+    }
+
+    inline bool valid() const { return true; }
+
+    inline bool seekp(size_t p) {
+        if(p > tellp()) {
+            reserve(p - tellp());
+        }
+        _pos = _start + p;
+        return true;
+    }
+
+    inline size_t tellp() const { return _pos - _start; }
+    inline size_t remaining() const { return _end - _pos; }
+
+    const char* data() const { return _start; }
+
+private:
+    inline void
+    reserve(size_t s) {
+        if(size_t(_end - _pos) < s) {
+            grow(s);
+        }
+    }
+
+    void
+    grow(size_t s) {
+        auto used = tellp();
+        auto cap  = std::max((size_t)(_end - _start) * 2, used + s);
+        auto buf  = std::unique_ptr<char[]>(new char[cap]);
+
+        memcpy(buf.get(), _start, used);
+        _heap  = std::move(buf);
+        _start = _heap.get();
+        _pos   = _start + used;
+        _end   = _start + cap;
+    }
+
+    void
+    take(growable_datastream& rhs) {
+        if(rhs._heap) {
+            _heap  = std::move(rhs._heap);
+            _start = rhs._start;
+            _pos   = rhs._pos;
+            _end   = rhs._end;
+
+            rhs._start = rhs._pos = rhs._inline;
+            rhs._end   = rhs._inline + N;
+        }
+        else {
+            memcpy(_inline, rhs._inline, rhs.tellp());
+            _pos     = _inline + rhs.tellp();
+            rhs._pos = rhs._inline;
+        }
+    }
+
+private:
+    char*                   _start;
+    char*                   _pos;
+    char*                   _end;
+    std::unique_ptr<char[]> _heap;
+    char                    _inline[N];
+};
+
 template<typename ST>
 inline datastream<ST>&
 operator<<(datastream<ST>& ds, const __int128& d) {
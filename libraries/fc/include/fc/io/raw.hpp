@@ -728,11 +728,18 @@ inline void
 pack(Stream& s, const std::vector<T>& value) {
     FC_ASSERT(value.size() <= MAX_NUM_ARRAY_ELEMENTS);
     fc::raw::pack(s, unsigned_int((uint32_t)value.size()));
-    auto itr = value.begin();
-    auto end = value.end();
-    while(itr != end) {
-        fc::raw::pack(s, *itr);
-        ++itr;
+    if constexpr(is_trivially_packed_v<T>) {
+        if(value.size()) {
+            s.write((const char*)value.data(), value.size() * sizeof(T));
+        }
+    }
+    else {
+        auto itr = value.begin();
+        auto end = value.end();
+        while(itr != end) {
+            fc::raw::pack(s, *itr);
+            ++itr;
+        }
     }
 }
 
@@ -743,11 +750,18 @@ unpack(Stream& s, std::vector<T>& value) {
     fc::raw::unpack(s, size);
     FC_ASSERT(size.value <= MAX_NUM_ARRAY_ELEMENTS);
     value.resize(size.value);
-    auto itr = value.begin();
-    auto end = value.end();
-    while(itr != end) {
-        fc::raw::unpack(s, *itr);
-        ++itr;
+    if constexpr(is_trivially_packed_v<T>) {
+        if(value.size()) {
+            s.read((char*)value.data(), value.size() * sizeof(T));
+        }
+    }
+    else {
+        auto itr = value.begin();
+        auto end = value.end();
+        while(itr != end) {
+            fc::raw::unpack(s, *itr);
+            ++itr;
+        }
     }
 }
 
@@ -827,37 +841,39 @@ unpack(Stream& s, T& v) {
 template<typename T>
 inline size_t
 pack_size(const T& v) {
-    datastream<size_t> ps;
-    fc::raw::pack(ps, v);
-    return ps.tellp();
+    if constexpr(is_trivially_packed_v<T>) {
+        return sizeof(T);
+    }
+    else {
+        datastream<size_t> ps;
+        fc::raw::pack(ps, v);
+        return ps.tellp();
+    }
 }
 
+// objects are packed in one pass into a stack buffer (spilling to heap when larger)
+// and then copied once into the result, which is cheaper than walking them twice
+constexpr size_t kPackInlineSize = 1024;
+
 template<typename T>
 inline std::vector<char>
 pack(const T& v) {
-    datastream<size_t> ps;
-    fc::raw::pack(ps, v);
-    std::vector<char> vec(ps.tellp());
-
-    if(vec.size()) {
-        datastream<char*> ds(vec.data(), size_t(vec.size()));
+    if constexpr(is_trivially_packed_v<T>) {
+        return std::vector<char>((const char*)&v, (const char*)&v + sizeof(T));
+    }
+    else {
+        auto ds = growable_datastream<kPackInlineSize>();
         fc::raw::pack(ds, v);
+        return std::vector<char>(ds.data(), ds.data() + ds.tellp());
     }
-    return vec;
 }
 
 template<typename T, typename... Next>
 inline std::vector<char>
 pack(const T& v, Next... next) {
-    datastream<size_t> ps;
-    fc::raw::pack(ps, v, next...);
-    std::vector<char> vec(ps.tellp());
-
-    if(vec.size()) {
-        datastream<char*> ds(vec.data(), size_t(vec.size()));
-        fc::raw::pack(ds, v, next...);
-    }
-    return vec;
+    auto ds = growable_datastream<kPackInlineSize>();
+    fc::raw::pack(ds, v, next...);
+    return std::vector<char>(ds.data(), ds.data() + ds.tellp());
 }
 
 template<typename T>
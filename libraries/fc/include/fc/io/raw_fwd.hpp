@@ -3,6 +3,7 @@
 #include <deque>
 #include <map>
 #include <set>
+#include <type_traits>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -49,6 +50,18 @@ template<typename Storage>
 class fixed_string;
 
 namespace raw {
+
+/**
+ * Types whose packed form is exactly their in-memory bytes, so a single value has a fixed
+ * pack size known at compile time and ranges of them can be packed with one memcpy.
+ * Only arithmetic types are included by default, other types opt in by `FC_RAW_TRIVIALLY_PACKED`.
+ */
+template<typename T>
+struct is_trivially_packed : std::bool_constant<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>> {};
+
+template<typename T>
+constexpr bool is_trivially_packed_v = is_trivially_packed<T>::value;
+
 template<typename T>
 inline size_t pack_size(const T& v);
 
@@ -219,3 +232,16 @@ void unpack(Stream& s, boost::multiprecision::number<T>& n);
 
 }  // namespace raw
 }  // namespace fc
+
+/**
+ * Declares that packing TYPE writes exactly its `sizeof(TYPE)` bytes in memory order,
+ * i.e. it has no padding and all of its reflected members are trivially packed and listed in declaration order.
+ * Must be used at global namespace.
+ */
+#define FC_RAW_TRIVIALLY_PACKED(TYPE)                                                                \
+    namespace fc { namespace raw {                                                                   \
+    static_assert(std::is_trivially_copyable_v<TYPE>, #TYPE " is not trivially copyable");           \
+    static_assert(std::has_unique_object_representations_v<TYPE>, #TYPE " has padding bytes");       \
+    template<>                                                                                       \
+    struct is_trivially_packed<TYPE> : std::true_type {};                                            \
+    }}
@@ -18,533 +18,107 @@
 #include <vector>
 #include <limits>
 #include <algorithm>
+#include <cctype>
 #include <string.h>
 
 #include <fc/log/logger.hpp>
 #include <fc/string.hpp>
 #include <fc/exception/exception.hpp>
 
-#include <stdexcept>
-#include <vector>
-#include <openssl/bn.h>
+static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
-/** Errors thrown by the bignum class */
-class bignum_error : public std::runtime_error {
-public:
-    explicit bignum_error(const std::string& str)
-        : std::runtime_error(str) {}
+// Digits are converted in limbs of 32 bits and of 5 base58 digits (58^5 < 2^32), so there are no
+// bignum contexts to allocate. Keys and addresses are less than 64 bytes, buffers of them are on stack.
+static const uint32_t kBase58Pow5 = 58 * 58 * 58 * 58 * 58;
+static const size_t   kStackLimbs = 32;
+
+static const int8_t kBase58Map[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1, 0, 1, 2, 3, 4, 5, 6,  7, 8,-1,-1,-1,-1,-1,-1,
+    -1, 9,10,11,12,13,14,15, 16,-1,17,18,19,20,21,-1,
+    22,23,24,25,26,27,28,29, 30,31,32,-1,-1,-1,-1,-1,
+    -1,33,34,35,36,37,38,39, 40,41,42,43,-1,44,45,46,
+    47,48,49,50,51,52,53,54, 55,56,57,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
 };
 
-/** RAII encapsulated BN_CTX (OpenSSL bignum context) */
-class CAutoBN_CTX {
-protected:
-    BN_CTX* pctx;
-    BN_CTX* operator=(BN_CTX* pnew) { return pctx = pnew; }
-
+// limbs on stack for short inputs, on heap otherwise
+class limb_buffer {
 public:
-    CAutoBN_CTX() {
-        pctx = BN_CTX_new();
-        if(pctx == NULL)
-            throw bignum_error("CAutoBN_CTX : BN_CTX_new() returned NULL");
+    explicit limb_buffer(size_t n)
+        : heap_(n > kStackLimbs ? n : 0)
+        , data_(n > kStackLimbs ? heap_.data() : stack_) {
+        memset(data_, 0, n * sizeof(uint32_t));
     }
 
-    ~CAutoBN_CTX() {
-        if(pctx != NULL)
-            BN_CTX_free(pctx);
-    }
+    uint32_t& operator[](size_t i) { return data_[i]; }
 
-    operator BN_CTX*() { return pctx; }
-    BN_CTX&  operator*() { return *pctx; }
-    BN_CTX** operator&() { return &pctx; }
-    bool     operator!() { return (pctx == NULL); }
+private:
+    uint32_t              stack_[kStackLimbs];
+    std::vector<uint32_t> heap_;
+    uint32_t*             data_;
 };
 
-/** C++ wrapper for BIGNUM (OpenSSL bignum) */
-class CBigNum {
-    BIGNUM* bn;
-
-public:
-    CBigNum()
-        : bn(BN_new()) {}
-
-    CBigNum(const CBigNum& b)
-        : CBigNum() {
-        if(!BN_copy(bn, b.bn)) {
-            BN_clear_free(bn);
-            throw bignum_error("CBigNum::CBigNum(const CBigNum&) : BN_copy failed");
-        }
-    }
-
-    CBigNum& operator=(const CBigNum& b) {
-        if(!BN_copy(bn, b.bn))
-            throw bignum_error("CBigNum::operator= : BN_copy failed");
-        return (*this);
-    }
-
-    ~CBigNum() {
-        BN_clear_free(bn);
-    }
-
-    //CBigNum(char n) is not portable.  Use 'signed char' or 'unsigned char'.
-    CBigNum(signed char n)
-        : CBigNum() {
-        if(n >= 0)
-            setulong(n);
-        else
-            setint64(n);
-    }
-    CBigNum(short n)
-        : CBigNum() {
-        if(n >= 0)
-            setulong(n);
-        else
-            setint64(n);
-    }
-    CBigNum(int n)
-        : CBigNum() {
-        if(n >= 0)
-            setulong(n);
-        else
-            setint64(n);
-    }
-    CBigNum(int64_t n)
-        : CBigNum() { setint64(n); }
-    CBigNum(unsigned char n)
-        : CBigNum() { setulong(n); }
-    CBigNum(unsigned short n)
-        : CBigNum() { setulong(n); }
-    CBigNum(unsigned int n)
-        : CBigNum() { setulong(n); }
-    CBigNum(uint64_t n)
-        : CBigNum() { setuint64(n); }
-
-    explicit CBigNum(const std::vector<unsigned char>& vch)
-        : CBigNum() {
-        setvch(vch);
-    }
-
-    void setulong(unsigned long n) {
-        if(!BN_set_word(bn, n))
-            throw bignum_error("CBigNum conversion from unsigned long : BN_set_word failed");
-    }
-
-    unsigned long getulong() const {
-        return BN_get_word(bn);
-    }
-
-    unsigned int getuint() const {
-        return BN_get_word(bn);
-    }
-
-    int getint() const {
-        unsigned long n = BN_get_word(bn);
-        if(!BN_is_negative(bn))
-            return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::max() : n);
-        else
-            return (n > (unsigned long)std::numeric_limits<int>::max() ? std::numeric_limits<int>::min() : -(int)n);
-    }
-
-    void setint64(int64_t n) {
-        unsigned char  pch[sizeof(n) + 6];
-        unsigned char* p         = pch + 4;
-        bool           fNegative = false;
-        if(n < (int64_t)0) {
-            n         = -n;
-            fNegative = true;
-        }
-        bool fLeadingZeroes = true;
-        for(int i = 0; i < 8; i++) {
-            unsigned char c = (n >> 56) & 0xff;
-            n <<= 8;
-            if(fLeadingZeroes) {
-                if(c == 0)
-                    continue;
-                if(c & 0x80)
-                    *p++ = (fNegative ? 0x80 : 0);
-                else if(fNegative)
-                    c |= 0x80;
-                fLeadingZeroes = false;
-            }
-            *p++ = c;
-        }
-        unsigned int nSize = p - (pch + 4);
-        pch[0]             = (nSize >> 24) & 0xff;
-        pch[1]             = (nSize >> 16) & 0xff;
-        pch[2]             = (nSize >> 8) & 0xff;
-        pch[3]             = (nSize)&0xff;
-        BN_mpi2bn(pch, p - pch, bn);
-    }
-
-    void setuint64(uint64_t n) {
-        unsigned char  pch[sizeof(n) + 6];
-        unsigned char* p              = pch + 4;
-        bool           fLeadingZeroes = true;
-        for(int i = 0; i < 8; i++) {
-            unsigned char c = (n >> 56) & 0xff;
-            n <<= 8;
-            if(fLeadingZeroes) {
-                if(c == 0)
-                    continue;
-                if(c & 0x80)
-                    *p++ = 0;
-                fLeadingZeroes = false;
-            }
-            *p++ = c;
-        }
-        unsigned int nSize = p - (pch + 4);
-        pch[0]             = (nSize >> 24) & 0xff;
-        pch[1]             = (nSize >> 16) & 0xff;
-        pch[2]             = (nSize >> 8) & 0xff;
-        pch[3]             = (nSize)&0xff;
-        BN_mpi2bn(pch, p - pch, bn);
-    }
-
-    void setvch(const std::vector<unsigned char>& vch) {
-        std::vector<unsigned char> vch2(vch.size() + 4);
-        unsigned int               nSize = vch.size();
-        // BIGNUM's byte stream format expects 4 bytes of
-        // big endian size data info at the front
-        vch2[0] = (nSize >> 24) & 0xff;
-        vch2[1] = (nSize >> 16) & 0xff;
-        vch2[2] = (nSize >> 8) & 0xff;
-        vch2[3] = (nSize >> 0) & 0xff;
-        // swap data to big endian
-        reverse_copy(vch.begin(), vch.end(), vch2.begin() + 4);
-        BN_mpi2bn(&vch2[0], vch2.size(), bn);
-    }
-
-    std::vector<unsigned char> getvch() const {
-        unsigned int nSize = BN_bn2mpi(bn, NULL);
-        if(nSize <= 4)
-            return std::vector<unsigned char>();
-        std::vector<unsigned char> vch(nSize);
-        BN_bn2mpi(bn, &vch[0]);
-        vch.erase(vch.begin(), vch.begin() + 4);
-        reverse(vch.begin(), vch.end());
-        return vch;
-    }
-
-    CBigNum& SetCompact(unsigned int nCompact) {
-        unsigned int               nSize = nCompact >> 24;
-        std::vector<unsigned char> vch(4 + nSize);
-        vch[3] = nSize;
-        if(nSize >= 1)
-            vch[4] = (nCompact >> 16) & 0xff;
-        if(nSize >= 2)
-            vch[5] = (nCompact >> 8) & 0xff;
-        if(nSize >= 3)
-            vch[6] = (nCompact >> 0) & 0xff;
-        BN_mpi2bn(&vch[0], vch.size(), bn);
-        return *this;
-    }
-
-    unsigned int GetCompact() const {
-        unsigned int               nSize = BN_bn2mpi(bn, NULL);
-        std::vector<unsigned char> vch(nSize);
-        nSize -= 4;
-        BN_bn2mpi(bn, &vch[0]);
-        unsigned int nCompact = nSize << 24;
-        if(nSize >= 1)
-            nCompact |= (vch[4] << 16);
-        if(nSize >= 2)
-            nCompact |= (vch[5] << 8);
-        if(nSize >= 3)
-            nCompact |= (vch[6] << 0);
-        return nCompact;
+// Encode a byte sequence as a base58-encoded string
+inline std::string
+EncodeBase58(const unsigned char* pbegin, const unsigned char* pend) {
+    // Leading zeroes encoded as base58 zeros
+    auto zeros = 0u;
+    while(pbegin != pend && *pbegin == 0) {
+        pbegin++;
+        zeros++;
     }
 
-    void SetHex(const std::string& str) {
-        // skip 0x
-        const char* psz = str.c_str();
-        while(isspace(*psz))
-            psz++;
-        bool fNegative = false;
-        if(*psz == '-') {
-            fNegative = true;
-            psz++;
-        }
-        if(psz[0] == '0' && tolower(psz[1]) == 'x')
-            psz += 2;
-        while(isspace(*psz))
-            psz++;
-
-        // hex string to bignum
-        static signed char phexdigit[256] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                             0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                             0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                             0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 0,
-                                             0, 0, 0, 0, 0, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf,
-                                             0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-                                             0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xa, 0xb,
-                                             0xc, 0xd, 0xe, 0xf, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-        *this = 0;
-        while(isxdigit(*psz)) {
-            *this <<= 4;
-            int n = phexdigit[(unsigned char)*psz++];
-            *this += n;
+    // Expected size increase from base58 conversion is approximately 137%
+    // use 138% to be safe
+    auto size   = (size_t)(pend - pbegin);
+    auto nlimbs = (size * 138 / 100 + 1) / 5 + 1;
+    auto limbs  = limb_buffer(nlimbs);
+    auto used   = 0u;
+
+    // big endian input is taken 32 bits a time, the first word takes the remaining bytes
+    auto rest = size % 4;
+    for(auto p = pbegin; p < pend;) {
+        auto n     = (p == pbegin && rest) ? rest : 4;
+        auto carry = uint64_t(0);
+        for(auto i = 0u; i < n; i++) {
+            carry = (carry << 8) | *p++;
         }
-        if(fNegative)
-            BN_set_negative(bn, 1);
-    }
 
-    std::string ToString(int nBase = 10) const {
-        CAutoBN_CTX pctx;
-        CBigNum     bnBase = nBase;
-        CBigNum     bn0    = 0;
-        std::string str;
-        CBigNum     bn = *this;
-        BN_set_negative(bn.bn, false);
-        CBigNum dv;
-        CBigNum rem;
-        if(BN_cmp(bn.bn, bn0.bn) == 0)
-            return "0";
-        while(BN_cmp(bn.bn, bn0.bn) > 0) {
-            if(!BN_div(dv.bn, rem.bn, bn.bn, bnBase.bn, pctx))
-                throw bignum_error("CBigNum::ToString() : BN_div failed");
-            bn             = dv;
-            unsigned int c = rem.getulong();
-            str += "0123456789abcdef"[c];
+        auto i = 0u;
+        for(; i < used || carry; i++) {
+            auto t   = ((uint64_t)limbs[i] << (n * 8)) + carry;
+            limbs[i] = (uint32_t)(t % kBase58Pow5);
+            carry    = t / kBase58Pow5;
         }
-        if(BN_is_negative(this->bn))
-            str += "-";
-        reverse(str.begin(), str.end());
-        return str;
-    }
-
-    std::string GetHex() const {
-        return ToString(16);
-    }
-
-    bool operator!() const {
-        return BN_is_zero(bn);
-    }
-
-    CBigNum& operator+=(const CBigNum& b) {
-        if(!BN_add(bn, bn, b.bn))
-            throw bignum_error("CBigNum::operator+= : BN_add failed");
-        return *this;
-    }
-
-    CBigNum& operator-=(const CBigNum& b) {
-        if(!BN_sub(bn, bn, b.bn))
-            throw bignum_error("CBigNum::operator-= : BN_sub failed");
-        return *this;
-    }
-
-    CBigNum& operator*=(const CBigNum& b) {
-        CAutoBN_CTX pctx;
-        if(!BN_mul(bn, bn, b.bn, pctx))
-            throw bignum_error("CBigNum::operator*= : BN_mul failed");
-        return *this;
-    }
-
-    CBigNum& operator/=(const CBigNum& b) {
-        CAutoBN_CTX pctx;
-        if(!BN_div(bn, NULL, bn, b.bn, pctx))
-            throw bignum_error("CBigNum::operator/= : BN_div failed");
-        return *this;
-    }
-
-    CBigNum& operator%=(const CBigNum& b) {
-        CAutoBN_CTX pctx;
-        if(!BN_div(NULL, bn, bn, b.bn, pctx))
-            throw bignum_error("CBigNum::operator%= : BN_div failed");
-        return *this;
-    }
-
-    CBigNum& operator<<=(unsigned int shift) {
-        if(!BN_lshift(bn, bn, shift))
-            throw bignum_error("CBigNum:operator<<= : BN_lshift failed");
-        return *this;
+        used = i;
     }
 
-    CBigNum& operator>>=(unsigned int shift) {
-        // Note: BN_rshift segfaults on 64-bit if 2^shift is greater than the number
-        //   if built on ubuntu 9.04 or 9.10, probably depends on version of openssl
-        CBigNum a = 1;
-        a <<= shift;
-        if(BN_cmp(a.bn, bn) > 0) {
-            *this = 0;
-            return *this;
+    auto str = std::string(zeros + used * 5, pszBase58[0]);
+    auto out = str.rbegin();
+    for(auto i = 0u; i < used; i++) {
+        auto v = limbs[i];
+        for(auto j = 0; j < 5; j++) {
+            *out++ = pszBase58[v % 58];
+            v /= 58;
         }
-
-        if(!BN_rshift(bn, bn, shift))
-            throw bignum_error("CBigNum:operator>>= : BN_rshift failed");
-        return *this;
-    }
-
-    CBigNum& operator++() {
-        // prefix operator
-        if(!BN_add(bn, bn, BN_value_one()))
-            throw bignum_error("CBigNum::operator++ : BN_add failed");
-        return *this;
-    }
-
-    const CBigNum operator++(int) {
-        // postfix operator
-        const CBigNum ret = *this;
-        ++(*this);
-        return ret;
-    }
-
-    CBigNum& operator--() {
-        // prefix operator
-        CBigNum r;
-        if(!BN_sub(r.bn, bn, BN_value_one()))
-            throw bignum_error("CBigNum::operator-- : BN_sub failed");
-        *this = r;
-        return *this;
-    }
-
-    const CBigNum operator--(int) {
-        // postfix operator
-        const CBigNum ret = *this;
-        --(*this);
-        return ret;
     }
 
-    const BIGNUM* to_bignum() const {
-        return bn;
+    // the highest limb has zero digits on top
+    auto first = str.find_first_not_of(pszBase58[0], zeros);
+    if(first == std::string::npos) {
+        first = str.size();
     }
-    BIGNUM* to_bignum() {
-        return bn;
-    }
-};
-
-inline const CBigNum
-operator+(const CBigNum& a, const CBigNum& b) {
-    CBigNum r;
-    if(!BN_add(r.to_bignum(), a.to_bignum(), b.to_bignum()))
-        throw bignum_error("CBigNum::operator+ : BN_add failed");
-    return r;
-}
-
-inline const CBigNum
-operator-(const CBigNum& a, const CBigNum& b) {
-    CBigNum r;
-    if(!BN_sub(r.to_bignum(), a.to_bignum(), b.to_bignum()))
-        throw bignum_error("CBigNum::operator- : BN_sub failed");
-    return r;
-}
-
-inline const CBigNum
-operator-(const CBigNum& a) {
-    CBigNum r(a);
-    BN_set_negative(r.to_bignum(), !BN_is_negative(r.to_bignum()));
-    return r;
-}
-
-inline const CBigNum operator*(const CBigNum& a, const CBigNum& b) {
-    CAutoBN_CTX pctx;
-    CBigNum     r;
-    if(!BN_mul(r.to_bignum(), a.to_bignum(), b.to_bignum(), pctx))
-        throw bignum_error("CBigNum::operator* : BN_mul failed");
-    return r;
-}
-
-inline const CBigNum
-operator/(const CBigNum& a, const CBigNum& b) {
-    CAutoBN_CTX pctx;
-    CBigNum     r;
-    if(!BN_div(r.to_bignum(), NULL, a.to_bignum(), b.to_bignum(), pctx))
-        throw bignum_error("CBigNum::operator/ : BN_div failed");
-    return r;
-}
-
-inline const CBigNum
-operator%(const CBigNum& a, const CBigNum& b) {
-    CAutoBN_CTX pctx;
-    CBigNum     r;
-    if(!BN_mod(r.to_bignum(), a.to_bignum(), b.to_bignum(), pctx))
-        throw bignum_error("CBigNum::operator% : BN_div failed");
-    return r;
-}
-
-inline const CBigNum
-operator<<(const CBigNum& a, unsigned int shift) {
-    CBigNum r;
-    if(!BN_lshift(r.to_bignum(), a.to_bignum(), shift))
-        throw bignum_error("CBigNum:operator<< : BN_lshift failed");
-    return r;
-}
-
-inline const CBigNum
-operator>>(const CBigNum& a, unsigned int shift) {
-    CBigNum r = a;
-    r >>= shift;
-    return r;
-}
-
-inline bool
-operator==(const CBigNum& a, const CBigNum& b) {
-    return (BN_cmp(a.to_bignum(), b.to_bignum()) == 0);
-}
-
-inline bool
-operator!=(const CBigNum& a, const CBigNum& b) {
-    return (BN_cmp(a.to_bignum(), b.to_bignum()) != 0);
-}
-
-inline bool
-operator<=(const CBigNum& a, const CBigNum& b) {
-    return (BN_cmp(a.to_bignum(), b.to_bignum()) <= 0);
-}
-
-inline bool
-operator>=(const CBigNum& a, const CBigNum& b) {
-    return (BN_cmp(a.to_bignum(), b.to_bignum()) >= 0);
-}
-
-inline bool
-operator<(const CBigNum& a, const CBigNum& b) {
-    return (BN_cmp(a.to_bignum(), b.to_bignum()) < 0);
-}
-
-inline bool
-operator>(const CBigNum& a, const CBigNum& b) {
-    return (BN_cmp(a.to_bignum(), b.to_bignum()) > 0);
-}
-
-static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
-
-// Encode a byte sequence as a base58-encoded string
-inline std::string
-EncodeBase58(const unsigned char* pbegin, const unsigned char* pend) {
-    CAutoBN_CTX pctx;
-    CBigNum     bn58 = 58;
-    CBigNum     bn0  = 0;
-
-    // Convert big endian data to little endian
-    // Extra zero at the end make sure bignum will interpret as a positive number
-    std::vector<unsigned char> vchTmp(pend - pbegin + 1, 0);
-    reverse_copy(pbegin, pend, vchTmp.begin());
-
-    // Convert little endian data to bignum
-    CBigNum bn;
-    bn.setvch(vchTmp);
-
-    // Convert bignum to std::string
-    std::string str;
-    // Expected size increase from base58 conversion is approximately 137%
-    // use 138% to be safe
-    str.reserve((pend - pbegin) * 138 / 100 + 1);
-    CBigNum dv;
-    CBigNum rem;
-    while(bn > bn0) {
-        if(!BN_div(dv.to_bignum(), rem.to_bignum(), bn.to_bignum(), bn58.to_bignum(), pctx))
-            throw bignum_error("EncodeBase58 : BN_div failed");
-        bn             = dv;
-        unsigned int c = rem.getulong();
-        str += pszBase58[c];
-    }
-
-    // Leading zeroes encoded as base58 zeros
-    for(const unsigned char* p = pbegin; p < pend && *p == 0; p++)
-        str += pszBase58[0];
-
-    // Convert little endian std::string to big endian
-    reverse(str.begin(), str.end());
-    //    slog( "Encode '%s'", str.c_str() );
+    str.erase(zeros, first - zeros);
     return str;
 }
 
@@ -558,47 +132,64 @@ EncodeBase58(const std::vector<unsigned char>& vch) {
 // returns true if decoding is succesful
 inline bool
 DecodeBase58(const char* psz, std::vector<unsigned char>& vchRet) {
-    CAutoBN_CTX pctx;
     vchRet.clear();
-    CBigNum bn58 = 58;
-    CBigNum bn   = 0;
-    CBigNum bnChar;
     while(isspace(*psz))
         psz++;
 
-    // Convert big endian string to bignum
-    for(const char* p = psz; *p; p++) {
-        const char* p1 = strchr(pszBase58, *p);
-        if(p1 == NULL) {
-            while(isspace(*p))
-                p++;
-            if(*p != '\0') {
-                //slog( "%s  '%c'", pszBase58,*p );
-                return false;
-            }
-            break;
+    // Restore leading zeros
+    auto zeros = 0u;
+    while(psz[zeros] == pszBase58[0])
+        zeros++;
+
+    auto end = psz;
+    while(kBase58Map[(uint8_t)*end] >= 0)
+        end++;
+
+    // only trailing spaces are allowed
+    for(auto p = end; *p; p++) {
+        if(!isspace(*p)) {
+            return false;
         }
-        bnChar.setulong(p1 - pszBase58);
-        if(!BN_mul(bn.to_bignum(), bn.to_bignum(), bn58.to_bignum(), pctx))
-            throw bignum_error("DecodeBase58 : BN_mul failed");
-        bn += bnChar;
     }
 
-    // Get bignum as little endian data
-    std::vector<unsigned char> vchTmp = bn.getvch();
+    // little endian limbs of 32 bits, every 58 digits need less than 733 / 1000 bytes
+    auto nlimbs = ((size_t)(end - psz) * 733 / 1000 + 1) / 4 + 1;
+    auto limbs  = limb_buffer(nlimbs);
+    auto used   = 0u;
+
+    // digits are taken 5 a time, the first group takes the remaining ones
+    auto rest = (size_t)(end - psz) % 5;
+    for(auto p = psz; p < end;) {
+        auto n     = (p == psz && rest) ? rest : 5;
+        auto mul   = uint64_t(1);
+        auto carry = uint64_t(0);
+        for(auto i = 0u; i < n; i++) {
+            carry = carry * 58 + kBase58Map[(uint8_t)*p++];
+            mul *= 58;
+        }
 
-    // Trim off sign byte if present
-    if(vchTmp.size() >= 2 && vchTmp.end()[-1] == 0 && vchTmp.end()[-2] >= 0x80)
-        vchTmp.erase(vchTmp.end() - 1);
+        auto i = 0u;
+        for(; i < used || carry; i++) {
+            auto t   = (uint64_t)limbs[i] * mul + carry;
+            limbs[i] = (uint32_t)t;
+            carry    = t >> 32;
+        }
+        used = i;
+    }
 
-    // Restore leading zeros
-    int nLeadingZeros = 0;
-    for(const char* p = psz; *p == pszBase58[0]; p++)
-        nLeadingZeros++;
-    vchRet.assign(nLeadingZeros + vchTmp.size(), 0);
+    // Convert little endian limbs to big endian data without leading zero bytes
+    vchRet.assign(zeros + used * 4, 0);
+    auto out = vchRet.rbegin();
+    for(auto i = 0u; i < used; i++) {
+        auto v = limbs[i];
+        for(auto j = 0; j < 4; j++) {
+            *out++ = (unsigned char)v;
+            v >>= 8;
+        }
+    }
 
-    // Convert little endian data to big endian
-    reverse_copy(vchTmp.begin(), vchTmp.end(), vchRet.end() - vchTmp.size());
+    auto first = std::find_if(vchRet.begin() + zeros, vchRet.end(), [](auto c) { return c != 0; });
+    vchRet.erase(vchRet.begin() + zeros, first);
     return true;
 }
 
@@ -2,8 +2,97 @@
 #include <fc/crypto/common.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
 namespace fc { namespace crypto {
 
+namespace internal {
+
+/**
+ *  Bounded cache from the binary keys to their strings, it's sharded so that threads
+ *  rendering different keys rarely contend on the same lock.
+ */
+class key_string_cache {
+public:
+    static constexpr size_t kShards = 16;
+
+public:
+    void
+    set_capacity(size_t capacity) {
+        auto per_shard = (capacity + kShards - 1) / kShards;
+        for(auto& s : shards_) {
+            auto lock = std::lock_guard<std::mutex>(s.mutex);
+            s.map.clear();
+        }
+        capacity_.store(per_shard, std::memory_order_relaxed);
+    }
+
+    bool enabled() const { return capacity_.load(std::memory_order_relaxed) > 0; }
+
+    bool
+    get(const ecc::public_key_data& key, std::string& str) {
+        auto& s    = get_shard(key);
+        auto  lock = std::lock_guard<std::mutex>(s.mutex);
+        auto  it   = s.map.find(key);
+        if(it == s.map.end()) {
+            return false;
+        }
+        str = it->second;
+        return true;
+    }
+
+    void
+    put(const ecc::public_key_data& key, const std::string& str) {
+        auto  cap  = capacity_.load(std::memory_order_relaxed);
+        auto& s    = get_shard(key);
+        auto  lock = std::lock_guard<std::mutex>(s.mutex);
+        if(cap == 0) {
+            return;
+        }
+        // evicts an arbitrary key, hot keys are put back soon
+        if(s.map.size() >= cap) {
+            s.map.erase(s.map.begin());
+        }
+        s.map.emplace(key, str);
+    }
+
+private:
+    struct key_hash {
+        size_t
+        operator()(const ecc::public_key_data& key) const {
+            // skips the parity byte, the rest of the compressed key is uniformly distributed
+            auto h = size_t();
+            memcpy(&h, key.data() + 1, sizeof(h));
+            return h;
+        }
+    };
+
+    struct shard {
+        std::mutex                                                     mutex;
+        std::unordered_map<ecc::public_key_data, std::string, key_hash> map;
+    };
+
+    shard&
+    get_shard(const ecc::public_key_data& key) {
+        return shards_[(uint8_t)key[sizeof(size_t) + 1] % kShards];
+    }
+
+private:
+    std::array<shard, kShards> shards_;
+    std::atomic<size_t>        capacity_{0};
+};
+
+key_string_cache&
+get_key_string_cache() {
+    static key_string_cache cache;
+    return cache;
+}
+
+}  // namespace internal
+
 struct recovery_visitor : fc::visitor<public_key::storage_type> {
     recovery_visitor(const sha256& digest, bool check_canonical)
         : _digest(digest)
@@ -59,10 +148,26 @@ public_key::valid() const {
 }
 
 public_key::operator std::string() const {
+    FC_ASSERT(_storage.which() == 0);
+
+    auto& cache = internal::get_key_string_cache();
+    auto  str   = std::string();
+    if(cache.enabled() && cache.get(_storage.get<ecc::public_key_shim>().serialize(), str)) {
+        return str;
+    }
+
     auto data_str = _storage.visit(base58str_visitor<storage_type, config::public_key_prefix, 0>());
+    str = std::string(config::public_key_jmzk_prefix) + data_str;
 
-    FC_ASSERT(_storage.which() == 0);
-    return std::string(config::public_key_jmzk_prefix) + data_str;
+    if(cache.enabled()) {
+        cache.put(_storage.get<ecc::public_key_shim>().serialize(), str);
+    }
+    return str;
+}
+
+void
+public_key::set_string_cache_capacity(size_t capacity) {
+    internal::get_key_string_cache().set_capacity(capacity);
 }
 
 std::ostream&
@@ -86,8 +191,31 @@ operator<(const public_key& p1, const public_key& p2) {
     return less_comparator<public_key::storage_type>::apply(p1._storage, p2._storage);
 }
 
+struct public_key_hash_visitor : fc::visitor<size_t> {
+    template<typename KeyType>
+    size_t operator()(const KeyType& key) const {
+        // compressed keys are one parity byte followed by the x coordinate,
+        // whose leading bytes are already uniformly distributed
+        auto& data = key.serialize();
+        static_assert(sizeof(data) >= sizeof(size_t) + 1);
+
+        auto h = size_t();
+        memcpy(&h, data.data() + 1, sizeof(h));
+        return h;
+    }
+};
+
 }}  // namespace fc::crypto
 
+namespace std {
+
+size_t
+hash<fc::crypto::public_key>::operator()(const fc::crypto::public_key& key) const {
+    return key._storage.visit(fc::crypto::public_key_hash_visitor()) ^ key._storage.which();
+}
+
+}  // namespace std
+
 namespace fc {
 
 using namespace std;
@@ -0,0 +1,353 @@
+/**
+ *  @file
+ *  @copyright defined in jmzk/LICENSE.txt
+ */
+#include <fc/crypto/sha256.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace fc {
+
+namespace internal {
+
+#if defined(__x86_64__)
+
+bool
+has_shani() {
+    auto eax = 0u, ebx = 0u, ecx = 0u, edx = 0u;
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 29))
+        && __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+}
+
+bool
+has_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+sha256::batch_impl
+detect_batch_impl() {
+    if(has_shani()) {
+        return sha256::batch_impl::shani;
+    }
+    if(has_avx2()) {
+        return sha256::batch_impl::avx2;
+    }
+    return sha256::batch_impl::scalar;
+}
+
+alignas(16) const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const uint32_t H256[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// blocks of the message after being padded with 0x80 and the 64-bit length
+inline size_t
+padded_blocks(uint32_t dlen) {
+    return ((size_t)dlen + 9 + 63) / 64;
+}
+
+// writes the padded tail (the bytes after the last full block) into `buf`, returns the number of blocks written
+inline size_t
+pad_tail(const char* d, uint32_t dlen, uint8_t* buf) {
+    auto rest   = dlen % 64;
+    auto blocks = (rest + 9 + 63) / 64;
+
+    memset(buf, 0, blocks * 64);
+    memcpy(buf, d + (dlen - rest), rest);
+    buf[rest] = 0x80;
+
+    auto bits = (uint64_t)dlen * 8;
+    for(auto i = 0; i < 8; i++) {
+        buf[blocks * 64 - 1 - i] = (uint8_t)(bits >> (i * 8));
+    }
+    return blocks;
+}
+
+inline void
+write_digest(const uint32_t state[8], sha256& out) {
+    auto p = (uint32_t*)out.data();
+    for(auto i = 0; i < 8; i++) {
+        p[i] = __builtin_bswap32(state[i]);
+    }
+}
+
+__attribute__((target("sha,ssse3,sse4.1"))) void
+transform_shani(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const auto MASK = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    auto tmp    = _mm_loadu_si128((const __m128i*)&state[0]);
+    auto state1 = _mm_loadu_si128((const __m128i*)&state[4]);
+
+    tmp    = _mm_shuffle_epi32(tmp, 0xB1);          // CDAB
+    state1 = _mm_shuffle_epi32(state1, 0x1B);       // EFGH
+    auto state0 = _mm_alignr_epi8(tmp, state1, 8);  // ABEF
+    state1      = _mm_blend_epi16(state1, tmp, 0xF0);  // CDGH
+
+    while(blocks--) {
+        auto abef = state0;
+        auto cdgh = state1;
+
+        __m128i w[4];
+        for(auto g = 0; g < 16; g++) {
+            if(g < 4) {
+                w[g] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + g * 16)), MASK);
+            }
+            else {
+                // W[t] = s1(W[t-2]) + W[t-7] + s0(W[t-15]) + W[t-16], four words at a time
+                auto t = _mm_sha256msg1_epu32(w[g % 4], w[(g + 1) % 4]);
+                t      = _mm_add_epi32(t, _mm_alignr_epi8(w[(g + 3) % 4], w[(g + 2) % 4], 4));
+                w[g % 4] = _mm_sha256msg2_epu32(t, w[(g + 3) % 4]);
+            }
+
+            auto msg = _mm_add_epi32(w[g % 4], _mm_load_si128((const __m128i*)&K256[g * 4]));
+            state1   = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg      = _mm_shuffle_epi32(msg, 0x0E);
+            state0   = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+        data += 64;
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);       // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);       // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);    // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);       // HGFE
+
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+void
+hash_many_shani(const char* const* d, const uint32_t* dlen, size_t n, sha256* out) {
+    alignas(16) uint8_t tail[128];
+    for(auto i = 0u; i < n; i++) {
+        uint32_t state[8];
+        memcpy(state, H256, sizeof(state));
+
+        // full blocks are hashed from the message directly, only the tail needs a copy
+        transform_shani(state, (const uint8_t*)d[i], dlen[i] / 64);
+        auto blocks = pad_tail(d[i], dlen[i], tail);
+        transform_shani(state, tail, blocks);
+
+        write_digest(state, out[i]);
+    }
+}
+
+#define ROTR(x, n)  _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define SIGMA0(x)   _mm256_xor_si256(_mm256_xor_si256(ROTR((x), 2), ROTR((x), 13)), ROTR((x), 22))
+#define SIGMA1(x)   _mm256_xor_si256(_mm256_xor_si256(ROTR((x), 6), ROTR((x), 11)), ROTR((x), 25))
+#define sigma0(x)   _mm256_xor_si256(_mm256_xor_si256(ROTR((x), 7), ROTR((x), 18)), _mm256_srli_epi32((x), 3))
+#define sigma1(x)   _mm256_xor_si256(_mm256_xor_si256(ROTR((x), 17), ROTR((x), 19)), _mm256_srli_epi32((x), 10))
+
+inline uint32_t
+load_be32(const uint8_t* p) {
+    auto v = uint32_t();
+    memcpy(&v, p, sizeof(v));
+    return __builtin_bswap32(v);
+}
+
+/**
+ * Hashes 8 padded messages of the same number of blocks, lane `i` of every vector belongs to message `i`
+ */
+__attribute__((target("avx2"))) void
+transform_avx2_8way(uint32_t state[8][8], const uint8_t* const data[8], size_t blocks) {
+    __m256i s[8];
+    for(auto j = 0; j < 8; j++) {
+        s[j] = _mm256_set1_epi32((int)H256[j]);
+    }
+
+    __m256i w[64];
+    for(auto b = 0u; b < blocks; b++) {
+        auto off = b * 64;
+        for(auto t = 0; t < 16; t++) {
+            auto p = off + t * 4;
+            w[t] = _mm256_set_epi32((int)load_be32(data[7] + p), (int)load_be32(data[6] + p),
+                                    (int)load_be32(data[5] + p), (int)load_be32(data[4] + p),
+                                    (int)load_be32(data[3] + p), (int)load_be32(data[2] + p),
+                                    (int)load_be32(data[1] + p), (int)load_be32(data[0] + p));
+        }
+        for(auto t = 16; t < 64; t++) {
+            w[t] = _mm256_add_epi32(_mm256_add_epi32(sigma1(w[t - 2]), w[t - 7]),
+                                    _mm256_add_epi32(sigma0(w[t - 15]), w[t - 16]));
+        }
+
+        auto a = s[0], b_ = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+        for(auto t = 0; t < 64; t++) {
+            auto ch  = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            auto maj = _mm256_or_si256(_mm256_and_si256(a, b_), _mm256_and_si256(c, _mm256_or_si256(a, b_)));
+
+            auto t1 = _mm256_add_epi32(_mm256_add_epi32(h, SIGMA1(e)), ch);
+            t1      = _mm256_add_epi32(t1, _mm256_add_epi32(_mm256_set1_epi32((int)K256[t]), w[t]));
+            auto t2 = _mm256_add_epi32(SIGMA0(a), maj);
+
+            h  = g;
+            g  = f;
+            f  = e;
+            e  = _mm256_add_epi32(d, t1);
+            d  = c;
+            c  = b_;
+            b_ = a;
+            a  = _mm256_add_epi32(t1, t2);
+        }
+
+        s[0] = _mm256_add_epi32(s[0], a);
+        s[1] = _mm256_add_epi32(s[1], b_);
+        s[2] = _mm256_add_epi32(s[2], c);
+        s[3] = _mm256_add_epi32(s[3], d);
+        s[4] = _mm256_add_epi32(s[4], e);
+        s[5] = _mm256_add_epi32(s[5], f);
+        s[6] = _mm256_add_epi32(s[6], g);
+        s[7] = _mm256_add_epi32(s[7], h);
+    }
+
+    // transpose lanes back into per-message states
+    for(auto j = 0; j < 8; j++) {
+        alignas(32) uint32_t lanes[8];
+        _mm256_store_si256((__m256i*)lanes, s[j]);
+        for(auto i = 0; i < 8; i++) {
+            state[i][j] = lanes[i];
+        }
+    }
+}
+
+#undef sigma1
+#undef sigma0
+#undef SIGMA1
+#undef SIGMA0
+#undef ROTR
+
+void
+hash_many_avx2(const char* const* d, const uint32_t* dlen, size_t n, sha256* out) {
+    // lanes of one batch must have the same number of blocks, so group the messages by it
+    auto idx = std::vector<size_t>(n);
+    std::iota(idx.begin(), idx.end(), 0);
+    std::stable_sort(idx.begin(), idx.end(), [&](auto l, auto r) {
+        return padded_blocks(dlen[l]) < padded_blocks(dlen[r]);
+    });
+
+    auto buf = std::vector<uint8_t>();
+    auto i   = 0u;
+    while(i < n) {
+        auto blocks = padded_blocks(dlen[idx[i]]);
+        auto j      = i;
+        while(j < n && padded_blocks(dlen[idx[j]]) == blocks) {
+            j++;
+        }
+
+        buf.resize(blocks * 64 * 8);
+        for(; i + 8 <= j; i += 8) {
+            const uint8_t* data[8];
+            for(auto k = 0; k < 8; k++) {
+                auto m = idx[i + k];
+                auto p = buf.data() + k * blocks * 64;
+
+                auto full = dlen[m] / 64;
+                memcpy(p, d[m], full * 64);
+                pad_tail(d[m], dlen[m], p + full * 64);
+                data[k] = p;
+            }
+
+            uint32_t state[8][8];
+            transform_avx2_8way(state, data, blocks);
+            for(auto k = 0; k < 8; k++) {
+                write_digest(state[k], out[idx[i + k]]);
+            }
+        }
+        // not enough messages to fill the lanes
+        for(; i < j; i++) {
+            out[idx[i]] = sha256::hash(d[idx[i]], dlen[idx[i]]);
+        }
+    }
+}
+
+#endif  // __x86_64__
+
+void
+hash_many(sha256::batch_impl impl, const char* const* d, const uint32_t* dlen, size_t n, sha256* out) {
+    switch(impl) {
+#if defined(__x86_64__)
+    case sha256::batch_impl::shani: {
+        hash_many_shani(d, dlen, n, out);
+        return;
+    }
+    case sha256::batch_impl::avx2: {
+        hash_many_avx2(d, dlen, n, out);
+        return;
+    }
+#endif
+    default: break;
+    }  // switch
+    for(auto i = 0u; i < n; i++) {
+        out[i] = sha256::hash(d[i], dlen[i]);
+    }
+}
+
+}  // namespace internal
+
+bool
+sha256::batch_impl_supported(batch_impl impl) {
+    switch(impl) {
+    case batch_impl::scalar: {
+        return true;
+    }
+#if defined(__x86_64__)
+    case batch_impl::shani: {
+        return internal::has_shani();
+    }
+    case batch_impl::avx2: {
+        return internal::has_avx2();
+    }
+#endif
+    default: break;
+    }  // switch
+    return false;
+}
+
+void
+sha256::hash_many(batch_impl impl, const char* const* d, const uint32_t* dlen, size_t n, sha256* out) {
+    FC_ASSERT(batch_impl_supported(impl), "SHA-256 batch implementation is not supported by this cpu");
+    internal::hash_many(impl, d, dlen, n, out);
+}
+
+void
+sha256::hash_many(const char* const* d, const uint32_t* dlen, size_t n, sha256* out) {
+#if defined(__x86_64__)
+    static auto impl = internal::detect_batch_impl();
+#else
+    static auto impl = batch_impl::scalar;
+#endif
+    internal::hash_many(impl, d, dlen, n, out);
+}
+
+void
+sha256::hash_many(const char* d, uint32_t dlen, size_t n, sha256* out) {
+    auto ptrs = std::vector<const char*>(n);
+    auto lens = std::vector<uint32_t>(n, dlen);
+    for(auto i = 0u; i < n; i++) {
+        ptrs[i] = d + (size_t)i * dlen;
+    }
+    hash_many(ptrs.data(), lens.data(), n, out);
+}
+
+}  // namespace fc
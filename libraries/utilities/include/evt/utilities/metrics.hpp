@@ -0,0 +1,195 @@
+/**
+ *  @file
+ *  @copyright defined in jmzk/LICENSE.txt
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace jmzk { namespace utilities { namespace metrics {
+
+/**
+ *  Metrics are split into `kShards` cache lines, every thread is assigned one of them round-robin on its
+ *  first update (thread index mod `kShards`) and updates it with relaxed atomic operations, so the hot paths
+ *  never take a lock. Up to `kShards` threads never share a cache line, beyond that a few threads share one
+ *  shard and only contend with each other. The shards are only summed up when the metrics are scraped.
+ */
+constexpr size_t kShards = 16;
+
+namespace internal {
+
+size_t shard_index();
+
+struct alignas(64) padded_counter {
+    std::atomic<uint64_t> value{0};
+};
+
+}  // namespace internal
+
+using labels_type = std::vector<std::pair<std::string, std::string>>;
+
+class counter : boost::noncopyable {
+public:
+    void
+    inc(uint64_t v = 1) {
+        shards_[internal::shard_index()].value.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    uint64_t value() const;
+
+private:
+    std::array<internal::padded_counter, kShards> shards_;
+};
+
+class gauge : boost::noncopyable {
+public:
+    void set(int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(int64_t v) { value_.fetch_add(v, std::memory_order_relaxed); }
+
+    int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_{0};
+};
+
+/**
+ *  Histogram with fixed upper bounds of buckets, the last implicit bucket is +Inf.
+ */
+class histogram : boost::noncopyable {
+public:
+    explicit histogram(const std::vector<double>& bounds);
+
+public:
+    void observe(double v);
+
+    template<typename Duration>
+    void
+    observe_us(Duration d) {
+        observe((double)std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    }
+
+public:
+    struct snapshot {
+        std::vector<uint64_t> buckets;  // cumulative
+        double                sum;
+        uint64_t              count;
+    };
+
+    const std::vector<double>& bounds() const { return bounds_; }
+    snapshot get_snapshot() const;
+
+private:
+    struct alignas(64) shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;
+        std::atomic<uint64_t>                    count{0};
+        std::atomic<double>                      sum{0};
+    };
+
+    std::vector<double>           bounds_;
+    std::array<shard, kShards>    shards_;
+};
+
+/**
+ *  Measures the time from construction to destruction into a histogram
+ */
+class scoped_timer : boost::noncopyable {
+public:
+    explicit scoped_timer(histogram& h) : h_(h), start_(std::chrono::steady_clock::now()) {}
+    ~scoped_timer() { h_.observe_us(std::chrono::steady_clock::now() - start_); }
+
+private:
+    histogram&                            h_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// latency buckets in microseconds
+const std::vector<double>& default_latency_bounds();
+
+/**
+ *  Process-wide registry of metrics, the references returned are stable. Looking up takes a lock, so
+ *  callers on hot paths should keep the reference.
+ *  Series labeled by short-lived values (like peers) are taken by `share_*` handles instead and are
+ *  released once the last handle is dropped, series taken by reference are never released.
+ */
+class registry : boost::noncopyable {
+public:
+    static registry& instance();
+
+public:
+    counter& get_counter(const std::string& name, const std::string& help, const labels_type& labels = {});
+    gauge&   get_gauge(const std::string& name, const std::string& help, const labels_type& labels = {});
+
+    histogram& get_histogram(const std::string& name,
+                             const std::string& help,
+                             const labels_type& labels = {},
+                             const std::vector<double>& bounds = default_latency_bounds());
+
+    std::shared_ptr<counter> share_counter(const std::string& name, const std::string& help, const labels_type& labels = {});
+    std::shared_ptr<gauge>   share_gauge(const std::string& name, const std::string& help, const labels_type& labels = {});
+
+    // removes the series if no handle of it is held anymore, returns true if removed
+    bool release(const std::string& name, const labels_type& labels);
+
+    // merges the histograms of all the labels under `name`, returns empty snapshot if not found
+    histogram::snapshot merged_snapshot(const std::string& name) const;
+
+    /**
+     *  Collectors are invoked before every scrape to refresh the metrics which are cheaper to be
+     *  pulled than to be updated on every change, like statistics of rocksdb.
+     */
+    using collector = std::function<void()>;
+
+    uint64_t add_collector(collector&& c);
+    void     remove_collector(uint64_t id);
+
+    // Prometheus text exposition format
+    std::string exposition() const;
+
+private:
+    enum class metric_type { counter = 0, gauge, histogram };
+
+    // formatted labels to metric
+    template<typename T>
+    using metric_map = std::map<std::string, std::shared_ptr<T>>;
+
+    struct family {
+        std::string help;
+        metric_type type;
+
+        metric_map<counter>   counters;
+        metric_map<gauge>     gauges;
+        metric_map<histogram> histograms;
+    };
+
+    family& get_family(const std::string& name, const std::string& help, metric_type type);
+
+    template<typename T, typename... Args>
+    std::shared_ptr<T> get_metric(const std::string& name,
+                                  const std::string& help,
+                                  metric_type        type,
+                                  metric_map<T>      family::*member,
+                                  const labels_type& labels,
+                                  Args&&...          args);
+
+private:
+    mutable std::shared_mutex     mutex_;
+    std::map<std::string, family> families_;
+
+    mutable std::mutex              collectors_mutex_;
+    std::map<uint64_t, collector>   collectors_;
+    uint64_t                        next_collector_id_ = 0;
+};
+
+}}}  // namespace jmzk::utilities::metrics
@@ -0,0 +1,316 @@
+/**
+ *  @file
+ *  @copyright defined in jmzk/LICENSE.txt
+ */
+#include <jmzk/utilities/metrics.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <fmt/format.h>
+#include <fc/exception/exception.hpp>
+
+namespace jmzk { namespace utilities { namespace metrics {
+
+namespace internal {
+
+size_t
+shard_index() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local auto index = next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return index;
+}
+
+std::string
+escape_label_value(const std::string& v) {
+    auto r = std::string();
+    r.reserve(v.size());
+    for(auto c : v) {
+        switch(c) {
+        case '\\': r += "\\\\"; break;
+        case '"':  r += "\\\""; break;
+        case '\n': r += "\\n"; break;
+        default:   r += c;
+        }
+    }
+    return r;
+}
+
+std::string
+format_labels(const labels_type& labels) {
+    auto r = std::string();
+    for(auto& l : labels) {
+        if(!r.empty()) {
+            r += ',';
+        }
+        r += l.first;
+        r += "=\"";
+        r += escape_label_value(l.second);
+        r += '"';
+    }
+    return r;
+}
+
+// name{labels,extra}
+std::string
+format_series(const std::string& name, const std::string& labels, const std::string& extra = std::string()) {
+    if(labels.empty() && extra.empty()) {
+        return name;
+    }
+    if(labels.empty()) {
+        return fmt::format("{}{{{}}}", name, extra);
+    }
+    if(extra.empty()) {
+        return fmt::format("{}{{{}}}", name, labels);
+    }
+    return fmt::format("{}{{{},{}}}", name, labels, extra);
+}
+
+std::string
+format_bound(double v) {
+    return fmt::format("{}", v);
+}
+
+}  // namespace internal
+
+uint64_t
+counter::value() const {
+    auto v = uint64_t(0);
+    for(auto& s : shards_) {
+        v += s.value.load(std::memory_order_relaxed);
+    }
+    return v;
+}
+
+histogram::histogram(const std::vector<double>& bounds)
+    : bounds_(bounds) {
+    FC_ASSERT(std::is_sorted(bounds_.cbegin(), bounds_.cend()), "Bounds of histogram should be sorted");
+    for(auto& s : shards_) {
+        s.buckets = std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1);
+        for(auto i = 0u; i <= bounds_.size(); i++) {
+            s.buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void
+histogram::observe(double v) {
+    auto  b = std::lower_bound(bounds_.cbegin(), bounds_.cend(), v) - bounds_.cbegin();
+    auto& s = shards_[internal::shard_index()];
+
+    s.buckets[b].fetch_add(1, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+
+    // only the threads sharing the same shard contend here
+    auto sum = s.sum.load(std::memory_order_relaxed);
+    while(!s.sum.compare_exchange_weak(sum, sum + v, std::memory_order_relaxed)) {}
+}
+
+histogram::snapshot
+histogram::get_snapshot() const {
+    auto r = snapshot { .buckets = std::vector<uint64_t>(bounds_.size() + 1), .sum = 0, .count = 0 };
+    for(auto& s : shards_) {
+        for(auto i = 0u; i <= bounds_.size(); i++) {
+            r.buckets[i] += s.buckets[i].load(std::memory_order_relaxed);
+        }
+        r.sum   += s.sum.load(std::memory_order_relaxed);
+        r.count += s.count.load(std::memory_order_relaxed);
+    }
+    // buckets are cumulative in exposition
+    for(auto i = 1u; i < r.buckets.size(); i++) {
+        r.buckets[i] += r.buckets[i - 1];
+    }
+    return r;
+}
+
+const std::vector<double>&
+default_latency_bounds() {
+    static auto bounds = std::vector<double> {
+        10, 25, 50, 100, 250, 500, 1'000, 2'500, 5'000, 10'000, 25'000, 50'000, 100'000, 250'000, 500'000, 1'000'000
+    };
+    return bounds;
+}
+
+registry&
+registry::instance() {
+    static registry r;
+    return r;
+}
+
+registry::family&
+registry::get_family(const std::string& name, const std::string& help, metric_type type) {
+    auto it = families_.find(name);
+    if(it == families_.end()) {
+        it = families_.emplace(name, family { .help = help, .type = type }).first;
+    }
+    FC_ASSERT(it->second.type == type, "Metric ${n} is already registered with another type", ("n", name));
+    return it->second;
+}
+
+template<typename T, typename... Args>
+std::shared_ptr<T>
+registry::get_metric(const std::string& name,
+                     const std::string& help,
+                     metric_type        type,
+                     metric_map<T>      family::*member,
+                     const labels_type& labels,
+                     Args&&...          args) {
+    auto lbs = internal::format_labels(labels);
+    {
+        auto lock = std::shared_lock<std::shared_mutex>(mutex_);
+        auto fit  = families_.find(name);
+        if(fit != families_.end() && fit->second.type == type) {
+            auto& metrics = fit->second.*member;
+            auto  mit     = metrics.find(lbs);
+            if(mit != metrics.end()) {
+                return mit->second;
+            }
+        }
+    }
+
+    auto  lock = std::unique_lock<std::shared_mutex>(mutex_);
+    auto& m    = (get_family(name, help, type).*member)[lbs];
+    if(!m) {
+        m = std::make_shared<T>(std::forward<Args>(args)...);
+    }
+    return m;
+}
+
+counter&
+registry::get_counter(const std::string& name, const std::string& help, const labels_type& labels) {
+    return *get_metric(name, help, metric_type::counter, &family::counters, labels);
+}
+
+gauge&
+registry::get_gauge(const std::string& name, const std::string& help, const labels_type& labels) {
+    return *get_metric(name, help, metric_type::gauge, &family::gauges, labels);
+}
+
+histogram&
+registry::get_histogram(const std::string& name, const std::string& help, const labels_type& labels, const std::vector<double>& bounds) {
+    return *get_metric(name, help, metric_type::histogram, &family::histograms, labels, bounds);
+}
+
+std::shared_ptr<counter>
+registry::share_counter(const std::string& name, const std::string& help, const labels_type& labels) {
+    return get_metric(name, help, metric_type::counter, &family::counters, labels);
+}
+
+std::shared_ptr<gauge>
+registry::share_gauge(const std::string& name, const std::string& help, const labels_type& labels) {
+    return get_metric(name, help, metric_type::gauge, &family::gauges, labels);
+}
+
+bool
+registry::release(const std::string& name, const labels_type& labels) {
+    auto lbs  = internal::format_labels(labels);
+    auto lock = std::unique_lock<std::shared_mutex>(mutex_);
+
+    auto fit = families_.find(name);
+    if(fit == families_.end()) {
+        return false;
+    }
+
+    // handles are only copied under the lock, so the use count cannot grow meanwhile
+    auto fn = [&](auto& metrics) {
+        auto mit = metrics.find(lbs);
+        if(mit == metrics.end() || mit->second.use_count() > 1) {
+            return false;
+        }
+        metrics.erase(mit);
+        return true;
+    };
+
+    switch(fit->second.type) {
+    case metric_type::counter:   return fn(fit->second.counters);
+    case metric_type::gauge:     return fn(fit->second.gauges);
+    case metric_type::histogram: return fn(fit->second.histograms);
+    }  // switch
+    return false;
+}
+
+histogram::snapshot
+registry::merged_snapshot(const std::string& name) const {
+    auto lock = std::shared_lock<std::shared_mutex>(mutex_);
+    auto r    = histogram::snapshot { .buckets = {}, .sum = 0, .count = 0 };
+
+    auto it = families_.find(name);
+    if(it == families_.end()) {
+        return r;
+    }
+    for(auto& [lbs, h] : it->second.histograms) {
+        auto s = h->get_snapshot();
+        if(r.buckets.size() < s.buckets.size()) {
+            r.buckets.resize(s.buckets.size());
+        }
+        for(auto i = 0u; i < s.buckets.size(); i++) {
+            r.buckets[i] += s.buckets[i];
+        }
+        r.sum   += s.sum;
+        r.count += s.count;
+    }
+    return r;
+}
+
+uint64_t
+registry::add_collector(collector&& c) {
+    auto lock = std::lock_guard<std::mutex>(collectors_mutex_);
+    auto id   = next_collector_id_++;
+    collectors_.emplace(id, std::move(c));
+    return id;
+}
+
+void
+registry::remove_collector(uint64_t id) {
+    auto lock = std::lock_guard<std::mutex>(collectors_mutex_);
+    collectors_.erase(id);
+}
+
+std::string
+registry::exposition() const {
+    {
+        auto lock = std::lock_guard<std::mutex>(collectors_mutex_);
+        for(auto& it : collectors_) {
+            it.second();
+        }
+    }
+
+    auto lock = std::shared_lock<std::shared_mutex>(mutex_);
+    auto out  = fmt::memory_buffer();
+
+    for(auto& [name, fam] : families_) {
+        switch(fam.type) {
+        case metric_type::counter: {
+            fmt::format_to(out, "# HELP {} {}\n# TYPE {} counter\n", name, fam.help, name);
+            for(auto& [lbs, c] : fam.counters) {
+                fmt::format_to(out, "{} {}\n", internal::format_series(name, lbs), c->value());
+            }
+            break;
+        }
+        case metric_type::gauge: {
+            fmt::format_to(out, "# HELP {} {}\n# TYPE {} gauge\n", name, fam.help, name);
+            for(auto& [lbs, g] : fam.gauges) {
+                fmt::format_to(out, "{} {}\n", internal::format_series(name, lbs), g->value());
+            }
+            break;
+        }
+        case metric_type::histogram: {
+            fmt::format_to(out, "# HELP {} {}\n# TYPE {} histogram\n", name, fam.help, name);
+            for(auto& [lbs, h] : fam.histograms) {
+                auto  s      = h->get_snapshot();
+                auto& bounds = h->bounds();
+                for(auto i = 0u; i < bounds.size(); i++) {
+                    auto le = fmt::format("le=\"{}\"", internal::format_bound(bounds[i]));
+                    fmt::format_to(out, "{} {}\n", internal::format_series(name + "_bucket", lbs, le), s.buckets[i]);
+                }
+                fmt::format_to(out, "{} {}\n", internal::format_series(name + "_bucket", lbs, "le=\"+Inf\""), s.buckets.back());
+                fmt::format_to(out, "{} {}\n", internal::format_series(name + "_sum", lbs), s.sum);
+                fmt::format_to(out, "{} {}\n", internal::format_series(name + "_count", lbs), s.count);
+            }
+            break;
+        }
+        }  // switch
+    }
+    return fmt::to_string(out);
+}
+
+}}}  // namespace jmzk::utilities::metrics
@@ -256,6 +256,11 @@ chain_plugin::set_program_options(options_description& cli, options_description&
             "In \"disk\" profile database is optimized for the standard storage devices.\n"
             "In \"memory\" mode database is optimized for the usage in ultra-low latency devices like memory\n"
         )
+        ("token-db-undo-log", bpo::bool_switch()->default_value(false), "capture the old values in token database on write, so that rolling back blocks in fork switches needs no reads")
+        ("token-db-prefetch", bpo::bool_switch()->default_value(false), "read the objects of incoming transactions and blocks into token database caches on a background thread ahead of execution")
+        ("token-db-journal", bpo::bool_switch()->default_value(false), "journal the savepoints of token database incrementally, so that restarts only replay the uncommitted savepoints and survive crashes")
+        ("token-db-journal-compact-size-mb", bpo::value<uint64_t>()->default_value(64), "the size in MBytes over which the savepoints journal of token database is checkpointed")
+        ("key-string-cache-size", bpo::value<uint32_t>()->default_value(65536), "the number of public keys whose strings are cached for rendering addresses, 0 to disable")
         ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
         ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms), "Override default maximum ABI serialization time allowed in ms")
         ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024 * 1024)), "Maximum size (in MiB) of the chain state database")
@@ -263,6 +268,7 @@ chain_plugin::set_program_options(options_description& cli, options_description&
         ("reversible-blocks-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_cache_size / (1024 * 1024)), "Maximum size (in MiB) of the reversible blocks database")
         ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024 * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
         ("contracts-console", bpo::bool_switch()->default_value(false), "print contract's output to console")
+        ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size), "Number of worker threads in controller thread pool")
         ("read-mode", boost::program_options::value<jmzk::chain::db_read_mode>()->default_value(jmzk::chain::db_read_mode::SPECULATIVE),
             "Database read mode (\"speculative\", \"head\", or \"read-only\").\n"// or \"irreversible\").\n"
             "In \"speculative\" mode database contains changes done up to the head block plus changes made by transactions not yet included to the blockchain.\n"
@@ -415,6 +421,15 @@ chain_plugin::plugin_initialize(const variables_map& options) {
             my->chain_config->db_config.profile = options.at("token-db-profile").as<storage_profile>();
         }
 
+        my->chain_config->db_config.enable_undo_log = options.at("token-db-undo-log").as<bool>();
+        my->chain_config->db_config.enable_prefetch = options.at("token-db-prefetch").as<bool>();
+        my->chain_config->db_config.enable_journal  = options.at("token-db-journal").as<bool>();
+        my->chain_config->db_config.journal_compact_size = options.at("token-db-journal-compact-size-mb").as<uint64_t>() * 1024 * 1024;
+
+        if(options.count("key-string-cache-size")) {
+            fc::crypto::public_key::set_string_cache_capacity(options.at("key-string-cache-size").as<uint32_t>());
+        }
+
         if(options.count("chain-state-db-size-mb")) {
             my->chain_config->state_size = options.at("chain-state-db-size-mb").as<uint64_t>() * 1024 * 1024;
         }
@@ -437,6 +452,12 @@ chain_plugin::plugin_initialize(const variables_map& options) {
         my->chain_config->charge_free_mode    = options.at("charge-free-mode").as<bool>();
         my->chain_config->contracts_console   = options.at("contracts-console").as<bool>();
 
+        if(options.count("chain-threads")) {
+            my->chain_config->thread_pool_size = options.at("chain-threads").as<uint16_t>();
+            jmzk_ASSERT(my->chain_config->thread_pool_size > 0, plugin_config_exception,
+                "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size));
+        }
+
         if(options.count("extract-genesis-json") || options.at("print-genesis-json").as<bool>()) {
             genesis_state gs;
 
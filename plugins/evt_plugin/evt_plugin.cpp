@@ -79,10 +79,7 @@ namespace jmzk_apis {
    
 #define READ_DB_ASSET(ADDR, SYM, VALUEREF)                                                         \
     try {                                                                                          \
-        auto str = std::string();                                                                  \
-        tokendb.read_asset(ADDR, SYM.id(), str);                                                   \
-                                                                                                   \
-        extract_db_value(str, VALUEREF);                                                           \
+        tokendb.read_asset_view(ADDR, SYM.id(), [&](auto& v) { extract_db_value(v, VALUEREF); });  \
     }                                                                                              \
     catch(token_database_exception&) {                                                             \
         jmzk_THROW2(balance_exception, "There's no balance left in {} with sym id: {}", ADDR, SYM); \
@@ -90,13 +87,10 @@ namespace jmzk_apis {
 
 #define READ_DB_ASSET_NO_THROW(ADDR, SYM, VALUEREF)                         \
     {                                                                       \
-        auto str = std::string();                                           \
-        if(!tokendb.read_asset(ADDR, SYM.id(), str, true /* no throw */)) { \
+        auto read = [&](auto& v) { extract_db_value(v, VALUEREF); };        \
+        if(!tokendb.read_asset_view(ADDR, SYM.id(), read, true)) {          \
             VALUEREF = MAKE_PROPERTY(0, SYM);                               \
         }                                                                   \
-        else {                                                              \
-            extract_db_value(str, VALUEREF);                                \
-        }                                                                   \
     }
 
 #define DECLARE_TOKEN_DB()                     \
@@ -168,6 +162,7 @@ read_only::get_tokens(const get_tokens_params& params) {
         jmzk_ASSERT(t <= 100, chain::exceed_query_limit_exception, "Exceed limit of max actions return allowed for each query, limit: 100 per query");
     }
 
+    // keys are not known ahead, one iterator scans the domain so there is no point lookup to batch
     int i = 0;
     tokendb.read_tokens_range(token_type::token, params.domain, s, [&](auto& key, auto&& value) {
         auto var = fc::variant();
@@ -708,10 +708,7 @@ pg_query::get_fungibles_balance_async(int id, const read_only::get_fungibles_bal
 
 #define READ_DB_ASSET(ADDR, SYM_ID, VALUEREF)                                                         \
     try {                                                                                             \
-        auto str = std::string();                                                                     \
-        tokendb.read_asset(ADDR, SYM_ID, str);                                                        \
-                                                                                                      \
-        extract_db_value(str, VALUEREF);                                                              \
+        tokendb.read_asset_view(ADDR, SYM_ID, [&](auto& v) { extract_db_value(v, VALUEREF); });       \
     }                                                                                                 \
     catch(token_database_exception&) {                                                                \
         jmzk_THROW2(balance_exception, "There's no balance left in {} with sym id: {}", ADDR, SYM_ID); \
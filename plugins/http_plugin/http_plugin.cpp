@@ -5,7 +5,9 @@
 #include <jmzk/http_plugin/http_plugin.hpp>
 
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <shared_mutex>
 #include <thread>
 #include <type_traits>
 #include <regex>
@@ -17,6 +19,9 @@
 #include <fc/reflect/variant.hpp>
 
 #include <boost/asio.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
 
 #include <websocketpp/client.hpp>
 #include <websocketpp/config/asio.hpp>
@@ -26,6 +31,7 @@
 
 #include <jmzk/chain/exceptions.hpp>
 #include <jmzk/http_plugin/local_endpoint.hpp>
+#include <jmzk/utilities/metrics.hpp>
 
 namespace jmzk {
 
@@ -71,7 +77,7 @@ struct asio_with_stub_log : public websocketpp::config::asio {
 
     typedef base::rng_type rng_type;
 
-    static bool const enable_multithreading = false;
+    static bool const enable_multithreading = true;
 
     struct transport_config : public base::transport_config {
         typedef type::concurrency_type concurrency_type;
@@ -81,7 +87,7 @@ struct asio_with_stub_log : public websocketpp::config::asio {
         typedef type::response_type    response_type;
         typedef TSOCKET                socket_type;
 
-        static bool const enable_multithreading = false;
+        static bool const enable_multithreading = true;
     };
 
     typedef TENDPOINT<transport_config> transport_type;
@@ -89,6 +95,26 @@ struct asio_with_stub_log : public websocketpp::config::asio {
     static const long timeout_open_handshake = 0;
 };
 
+bool
+accepts_gzip(const std::string& accept_encoding) {
+    // no need to parse the q-values, `gzip;q=0` is never sent by the clients in practice
+    return accept_encoding.find("gzip") != std::string::npos;
+}
+
+std::string
+gzip_compress(const std::string& data) {
+    namespace bio = boost::iostreams;
+
+    auto out  = std::string();
+    auto comp = bio::filtering_ostream();
+    comp.push(bio::gzip_compressor(bio::gzip_params(bio::gzip::best_speed)));
+    comp.push(bio::back_inserter(out));
+    bio::write(comp, data.data(), data.size());
+    bio::close(comp);
+
+    return out;
+}
+
 }  // namespace detail
 
 using http_config  = detail::asio_with_stub_log<websocketpp::transport::asio::endpoint, websocketpp::transport::asio::basic_socket::endpoint>;
@@ -105,11 +131,15 @@ using io_work_t                   = boost::asio::executor_work_guard<boost::asio
 
 static bool verbose_http_errors = false;
 
+static const auto metrics_url = std::string("/v1/metrics");
+
 class http_plugin_impl {
 public:
     http_plugin_impl() {}
 
 public:
+    // handlers are added by other plugins while the http threads are serving
+    mutable std::shared_mutex         handlers_mutex;
     map<string, url_handler>          url_handlers;
     map<string, url_handler>          url_local_handlers;
     map<string, url_deferred_handler> url_deferred_handlers;
@@ -121,6 +151,7 @@ public:
     size_t                            max_body_size;
     size_t                            max_deferred_connection_size;
 
+    std::mutex                        conns_mutex;
     vector<http_connection_ptr_type>  http_conns;
     vector<https_connection_ptr_type> https_conns;
 
@@ -131,11 +162,13 @@ public:
 
     websocket_server_type server;
 
-    optional<std::thread>                    server_thread;
+    uint16_t                                 server_threads_num = 2;
+    vector<std::thread>                      server_threads;
     std::shared_ptr<boost::asio::io_context> server_ioc;
     optional<io_work_t>                      server_ioc_work;
     std::atomic<int64_t>                     bytes_in_flight{0};
     int64_t                                  max_bytes_in_flight = 0;
+    size_t                                   compress_min_size = 0;
 
     optional<tcp::endpoint> https_listen_endpoint;
     string                  https_cert_chain;
@@ -253,6 +286,7 @@ public:
     template <typename T>
     deferred_id
     alloc_deferred_id(typename websocketpp::server<T>::connection_ptr con) {
+        auto lock = std::lock_guard<std::mutex>(conns_mutex);
         if(http_conn_count + https_conn_count >= max_deferred_connection_size) {
             jmzk_THROW2(chain::exceed_deferred_request, "Exceed max allowed deferred connections, max: {}", max_deferred_connection_size);
         }
@@ -287,6 +321,26 @@ public:
             "Alloc deferred id failed, http index: {}, https index: {}", http_conn_index, https_conn_index);
     }
 
+    /**
+     *  Sets the response body, large bodies are compressed by gzip if the client accepts.
+     *  It's always invoked in the http threads, so the compression doesn't block the main thread.
+     */
+    template<typename C>
+    void
+    set_response_body(const C& con, std::string&& body) {
+        if(http_no_response) {
+            return;
+        }
+        if(compress_min_size > 0 && body.size() >= compress_min_size
+            && detail::accepts_gzip(con->get_request().get_header("Accept-Encoding"))) {
+            con->append_header("Content-Encoding", "gzip");
+            con->append_header("Vary", "Accept-Encoding");
+            con->set_body(detail::gzip_compress(body));
+            return;
+        }
+        con->set_body(std::move(body));
+    }
+
     template<class T>
     bool
     allow_host(const typename T::request_type& req, typename websocketpp::server<T>::connection_ptr con) {
@@ -331,6 +385,14 @@ public:
                 return;
             }
 
+            // metrics are served right away instead of being posted to the application queue, so they stay available under load
+            if(con->get_uri()->get_resource() == metrics_url) {
+                con->append_header("Content-Type", "text/plain; version=0.0.4");
+                set_response_body(con, utilities::metrics::registry::instance().exposition());
+                con->set_status(websocketpp::http::status_code::ok);
+                return;
+            }
+
             con->append_header("Content-Type", "application/json");
 
             if(bytes_in_flight > max_bytes_in_flight) {
@@ -344,26 +406,30 @@ public:
             auto body     = con->get_request_body();
             auto resource = con->get_uri()->get_resource();
 
+            auto handlers_lock = std::shared_lock<std::shared_mutex>(handlers_mutex);
             {
                 auto handler_itr = url_handlers.find(resource);
                 if(handler_itr != url_handlers.cend()) {
+                    auto start     = std::chrono::steady_clock::now();
+                    auto histogram = &utilities::metrics::registry::instance().get_histogram(
+                        "jmzk_http_request_us", "Time to serve http requests in microseconds", {{"endpoint", resource}});
+
                     con->defer_http_response();
                     bytes_in_flight += body.size();
                     app().post(appbase::priority::low,
-                        [this, ioc = this->server_ioc, handler_itr, resource{std::move(resource)}, body{std::move(body)}, con] {
+                        [this, ioc = this->server_ioc, handler_itr, resource{std::move(resource)}, body{std::move(body)}, con, start, histogram] {
                             this->bytes_in_flight -= body.size();
                             try {
                                 handler_itr->second(resource, body,
-                                    [this, ioc{std::move(ioc)}, con](auto code, auto response_body) {
+                                    [this, ioc{std::move(ioc)}, con, start, histogram](auto code, auto response_body) {
                                         this->bytes_in_flight += response_body.size();
-                                        boost::asio::post(*ioc, [this, response_body{std::move(response_body)}, con, code]() {
+                                        boost::asio::post(*ioc, [this, response_body{std::move(response_body)}, con, code, start, histogram]() mutable {
                                             size_t body_size = response_body.size();
-                                            if(!this->http_no_response) {
-                                                con->set_body(std::move(response_body));
-                                            }
+                                            this->set_response_body(con, std::move(response_body));
                                             con->set_status(websocketpp::http::status_code::value(code));
                                             con->send_http_response();
                                             this->bytes_in_flight -= body_size;
+                                            histogram->observe_us(std::chrono::steady_clock::now() - start);
                                         });
                                     });
                             }
@@ -413,10 +479,8 @@ public:
                             try {
                                 handler_itr->second(resource, body,
                                     [this, ioc{std::move(ioc)}, con](auto code, auto response_body) {
-                                        boost::asio::post(*ioc, [this, response_body{std::move(response_body)}, con, code]() {
-                                            if(!this->http_no_response) {
-                                                con->set_body(std::move(response_body));
-                                            }
+                                        boost::asio::post(*ioc, [this, response_body{std::move(response_body)}, con, code]() mutable {
+                                            this->set_response_body(con, std::move(response_body));
                                             con->set_status(websocketpp::http::status_code::value(code));
                                             con->send_http_response();
                                         });
@@ -431,6 +495,8 @@ public:
                 }
             }
 
+            handlers_lock.unlock();
+
             dlog("404 - not found: ${ep}", ("ep", resource));
             error_results results{websocketpp::http::status_code::not_found,
                                   "Not Found", error_results::error_info(fc::exception(FC_LOG_MESSAGE(error, "Unknown Endpoint")), verbose_http_errors)};
@@ -442,31 +508,42 @@ public:
         }
     }
 
+    // visitor is invoked without lock, the connection may be released by its close handler meanwhile
+    template<typename CON, typename FUNC>
+    void
+    visit_connection(vector<CON>& conns, size_t& count, size_t index, FUNC&& vistor) {
+        FC_ASSERT(index < max_deferred_connection_size);
+
+        auto con = CON();
+        {
+            auto lock = std::lock_guard<std::mutex>(conns_mutex);
+            con = conns[index];
+        }
+        if(con == nullptr) {
+            // already released
+            return;
+        }
+
+        if(!vistor(con)) {
+            auto lock = std::lock_guard<std::mutex>(conns_mutex);
+            if(conns[index] == con) {
+                conns[index] = nullptr;
+                count--;
+            }
+        }
+    }
+
     template<typename FUNC>
     void
     visit_connection(deferred_id id, FUNC&& vistor) {
         if((id & (1 << 31)) == 0) {
             // http
-            FC_ASSERT(id < max_deferred_connection_size);
-            auto con = http_conns[id];
-            FC_ASSERT(con != nullptr);
-
-            if(!vistor(con)) {
-                http_conns[id] = nullptr;
-                http_conn_count--;
-            }
+            visit_connection(http_conns, http_conn_count, id, std::forward<FUNC>(vistor));
         }
         else {
             // https
             auto index = id & (0xFFFFFFFF >> 1);
-            FC_ASSERT(index < max_deferred_connection_size);
-            auto con = https_conns[index];
-            FC_ASSERT(con != nullptr);
-
-            if(!vistor(con)) {
-                https_conns[index] = nullptr;
-                https_conn_count--;
-            }
+            visit_connection(https_conns, https_conn_count, index, std::forward<FUNC>(vistor));
         }
     }
 
@@ -475,11 +552,9 @@ public:
         try {
             this->bytes_in_flight += body.size();
             boost::asio::post(*server_ioc, [this, id, code, body{std::move(body)}] {
-                visit_connection(id, [this, code, body{std::move(body)}](auto con) {
+                visit_connection(id, [this, code, body{std::move(body)}](auto con) mutable {
                     auto body_size = body.size();
-                    if(!this->http_no_response) {
-                        con->set_body(std::move(body));
-                    }
+                    this->set_response_body(con, std::move(body));
                     con->set_status(websocketpp::http::status_code::value(code));
                     con->send_http_response();
                     this->bytes_in_flight -= body_size;
@@ -496,7 +571,8 @@ public:
     create_server_for_endpoint(const tcp::endpoint& ep, websocketpp::server<T>& ws) {
         try {
             ws.clear_access_channels(websocketpp::log::alevel::all);
-            ws.init_asio(&app().get_io_service());
+            // all the http threads share the same acceptor
+            ws.init_asio(server_ioc.get());
             ws.set_reuse_addr(true);
             ws.set_max_http_body_size(max_body_size);
             ws.set_http_handler([&](connection_hdl hdl) {
@@ -563,6 +639,9 @@ http_plugin::set_program_options(options_description&, options_description& cfg)
         ("http-alias", bpo::value<std::vector<string>>()->composing(),
             "Additionaly acceptable values for the \"Host\" header of incoming HTTP requests, can be specified multiple times.  Includes http/s_server_address by default.")
         ("http-no-response", bpo::bool_switch()->default_value(false), "special for load-testing, response all the requests with empty body")
+        ("http-threads", bpo::value<uint16_t>()->default_value(my->server_threads_num), "Number of worker threads in http thread pool")
+        ("http-compress-min-size", bpo::value<uint32_t>()->default_value(8 * 1024),
+            "Minimum size in bytes of response bodies to be compressed by gzip when the client accepts; set 0 to disable.")
         ;
 }
 
@@ -649,8 +728,12 @@ http_plugin::plugin_initialize(const variables_map& options) {
         my->max_bytes_in_flight          = options.at("http-max-bytes-in-flight-mb").as<uint32_t>() * 1024 * 1024;
         my->max_deferred_connection_size = options.at("max-deferred-connection-size").as<uint32_t>();
         my->http_no_response             = options.at("http-no-response").as<bool>();
+        my->compress_min_size            = options.at("http-compress-min-size").as<uint32_t>();
+        my->server_threads_num           = options.at("http-threads").as<uint16_t>();
         verbose_http_errors              = options.at("verbose-http-errors").as<bool>();
 
+        jmzk_ASSERT2(my->server_threads_num > 0, chain::plugin_config_exception, "http-threads {} must be greater than 0", my->server_threads_num);
+
         FC_ASSERT(my->max_deferred_connection_size < (uint32_t)std::numeric_limits<int32_t>::max());
 
         //watch out for the returns above when adding new code here
@@ -662,9 +745,12 @@ void
 http_plugin::plugin_startup() {
     my->server_ioc = std::make_shared<boost::asio::io_context>();
     my->server_ioc_work.emplace(boost::asio::make_work_guard(*my->server_ioc));
-    my->server_thread.emplace([ioc = my->server_ioc] {
-        ioc->run();
-    });
+    for(auto i = 0u; i < my->server_threads_num; i++) {
+        my->server_threads.emplace_back([ioc = my->server_ioc, i] {
+            fc::set_thread_name("http-" + std::to_string(i));
+            ioc->run();
+        });
+    }
 
     if(my->listen_endpoint.has_value()) {
         try {
@@ -778,10 +864,10 @@ http_plugin::plugin_shutdown() {
     if(my->server_ioc) {
         my->server_ioc->stop();
     }
-    if(my->server_thread.has_value()) {
-        my->server_thread->join();
-        my->server_thread.reset();
+    for(auto& t : my->server_threads) {
+        t.join();
     }
+    my->server_threads.clear();
 }
 
 void
@@ -792,6 +878,7 @@ http_plugin::add_handler(const string& url, const url_handler& handler, bool loc
     else {
         ilog("add local only api url: ${c}", ("c", url));
     }
+    auto lock = std::unique_lock<std::shared_mutex>(my->handlers_mutex);
     if(!local_only) {
         my->url_handlers.insert(std::make_pair(url, handler));
     }
@@ -807,6 +894,7 @@ void
 http_plugin::add_deferred_handler(const string& url, const url_deferred_handler& handler) {
     ilog("add deferred api url: ${c}", ("c", url));
     boost::asio::post(app().get_io_service(), [=]() {
+        auto lock = std::unique_lock<std::shared_mutex>(my->handlers_mutex);
         my->url_deferred_handlers.insert(std::make_pair(url, handler));
     });
 }
@@ -903,6 +991,7 @@ http_plugin::get_supported_apis_result
 http_plugin::get_supported_apis() const {
     get_supported_apis_result result;
 
+    auto lock = std::shared_lock<std::shared_mutex>(my->handlers_mutex);
     for(const auto& handler : my->url_handlers) {
         if(handler.first != "/v1/node/get_supported_apis") {
             result.apis.emplace_back(handler.first);
@@ -914,6 +1003,7 @@ http_plugin::get_supported_apis() const {
     for(const auto& handler : my->url_local_handlers) {
         result.apis.emplace_back(handler.first);
     }
+    result.apis.emplace_back(metrics_url);
 
     std::sort(result.apis.begin(), result.apis.end());
     return result;
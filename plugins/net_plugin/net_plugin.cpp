@@ -27,6 +27,7 @@
 #include <jmzk/chain/plugin_interface.hpp>
 #include <jmzk/chain/multi_index_includes.hpp>
 #include <jmzk/producer_plugin/producer_plugin.hpp>
+#include <jmzk/utilities/metrics.hpp>
 
 using namespace jmzk::chain::plugin_interface::compat;
 
@@ -56,8 +57,9 @@ class dispatch_manager;
 using connection_ptr  = std::shared_ptr<connection>;
 using connection_wptr = std::weak_ptr<connection>;
 
-using socket_ptr = std::shared_ptr<tcp::socket>;
-using io_work_t  = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+using socket_ptr  = std::shared_ptr<tcp::socket>;
+using io_work_t   = boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
+using counter_ptr = std::shared_ptr<utilities::metrics::counter>;
 
 struct node_transaction_state {
     transaction_id_type           id;
@@ -515,6 +517,9 @@ public:
     unique_ptr<boost::asio::steady_timer> response_expected;
     unique_ptr<boost::asio::steady_timer> read_delay_timer;
     go_away_reason                        no_retry = no_reason;
+    string                                metrics_peer;
+    counter_ptr                           messages_counter;
+    counter_ptr                           bytes_counter;
     block_id_type                         fork_head;
     uint32_t                              fork_head_num = 0;
     optional<request_message>             last_req;
@@ -574,6 +579,9 @@ public:
 
     const string peer_name();
 
+    void count_message(uint32_t message_length);
+    void release_metrics();
+
     void blk_send_branch();
     void blk_send(const block_id_type& blkid);
     void stop_send();
@@ -761,7 +769,9 @@ connection::connection(socket_ptr s)
     initialize();
 }
 
-connection::~connection() {}
+connection::~connection() {
+    release_metrics();
+}
 
 void
 connection::initialize() {
@@ -808,6 +818,7 @@ connection::close() {
         my_impl->dispatcher->retry_fetch(shared_from_this());
     }
     reset();
+    release_metrics();
     sent_handshake_count = 0;
     last_handshake_recv  = handshake_message();
     last_handshake_sent  = handshake_message();
@@ -1191,6 +1202,37 @@ connection::peer_name() {
     return "connecting client";
 }
 
+void
+connection::count_message(uint32_t message_length) {
+    // counters are looked up again only when the peer name changes after handshake
+    auto name = peer_name();
+    if(messages_counter == nullptr || name != metrics_peer) {
+        release_metrics();
+
+        auto& registry   = utilities::metrics::registry::instance();
+        messages_counter = registry.share_counter("jmzk_net_messages_received_total", "Messages received from peers", {{"peer", name}});
+        bytes_counter    = registry.share_counter("jmzk_net_bytes_received_total", "Bytes received from peers", {{"peer", name}});
+        metrics_peer     = std::move(name);
+    }
+    messages_counter->inc();
+    bytes_counter->inc(message_length);
+}
+
+void
+connection::release_metrics() {
+    if(messages_counter == nullptr) {
+        return;
+    }
+    // series are dropped with the last connection of the peer, so the registry does not grow with churn
+    messages_counter.reset();
+    bytes_counter.reset();
+
+    auto& registry = utilities::metrics::registry::instance();
+    registry.release("jmzk_net_messages_received_total", {{"peer", metrics_peer}});
+    registry.release("jmzk_net_bytes_received_total", {{"peer", metrics_peer}});
+    metrics_peer.clear();
+}
+
 void
 connection::fetch_timeout(boost::system::error_code ec) {
     if(!ec) {
@@ -2169,6 +2211,8 @@ net_plugin_impl::start_read_message(const connection_ptr& conn) {
 bool
 net_plugin_impl::process_next_message(const connection_ptr& conn, uint32_t message_length) {
     try {
+        conn->count_message(message_length);
+
         // if next message is a block we already have, exit early
         auto peek_ds = conn->pending_message_buffer.create_peek_datastream();
         unsigned_int which{};
@@ -2542,6 +2586,10 @@ net_plugin_impl::handle_message(const connection_ptr& c, const packed_transactio
         fc_dlog(logger, "got a txn during sync - dropping");
         return;
     }
+    if(producer_plug != nullptr && producer_plug->is_incoming_queue_full()) {
+        fc_dlog(logger, "incoming transaction queue is full - dropping");
+        return;
+    }
 
     auto        ptrx = std::make_shared<transaction_metadata>(trx);
     const auto& tid  = ptrx->id;
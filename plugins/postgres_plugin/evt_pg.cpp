@@ -403,6 +403,74 @@ escape_string(const std::string& str) {
     return estr;
 }
 
+// rows per set-based statement when flushing the folded state changes
+constexpr auto kFlushRows = 1000u;
+
+template<typename Map, typename F>
+void
+format_values_to(fmt::memory_buffer& buf, const Map& rows, const char* head, const char* tail, F&& format_row) {
+    auto n = 0u;
+    for(auto& row : rows) {
+        if(n % kFlushRows == 0) {
+            if(n > 0) {
+                fmt::format_to(buf, fmt("{}\n"), tail);
+            }
+            fmt::format_to(buf, fmt("{}"), head);
+        }
+        else {
+            fmt::format_to(buf, fmt(","));
+        }
+        format_row(row);
+        n++;
+    }
+    if(n > 0) {
+        fmt::format_to(buf, fmt("{}\n"), tail);
+    }
+}
+
+void
+format_jsonb_to(fmt::memory_buffer& buf, const std::optional<std::string>& json) {
+    if(json.has_value()) {
+        fmt::format_to(buf, fmt("'{}'::jsonb"), *json);
+    }
+    else {
+        fmt::format_to(buf, fmt("NULL::jsonb"));
+    }
+}
+
+template<typename Key>
+void
+format_key_to(fmt::memory_buffer& buf, const Key& key) {
+    if constexpr(std::is_integral_v<Key>) {
+        fmt::format_to(buf, fmt("{:d}::bigint"), key);
+    }
+    else {
+        fmt::format_to(buf, fmt("'{}'"), key);
+    }
+}
+
+// columns not updated in the batch are kept by `COALESCE`
+template<typename Map>
+void
+format_perm_updates_to(fmt::memory_buffer& buf, const Map& upds, const char* table, const char* key) {
+    auto head = fmt::format(fmt("UPDATE {0} AS t SET issue = COALESCE(v.issue, t.issue), transfer = COALESCE(v.transfer, t.transfer), "
+                                "manage = COALESCE(v.manage, t.manage) FROM (VALUES "), table);
+    auto tail = fmt::format(fmt(") AS v({0}, issue, transfer, manage) WHERE t.{0} = v.{0};"), key);
+
+    format_values_to(buf, upds, head.c_str(), tail.c_str(), [&](auto& row) {
+        auto& [k, u] = row;
+        fmt::format_to(buf, fmt("("));
+        format_key_to(buf, k);
+        fmt::format_to(buf, fmt(","));
+        format_jsonb_to(buf, u.issue);
+        fmt::format_to(buf, fmt(","));
+        format_jsonb_to(buf, u.transfer);
+        fmt::format_to(buf, fmt(","));
+        format_jsonb_to(buf, u.manage);
+        fmt::format_to(buf, fmt(")"));
+    });
+}
+
 }  // namespace internal
 
 int
@@ -720,11 +788,56 @@ pg::new_trx_context() {
 
 void
 pg::commit_trx_context(trx_context& tctx) {
-    if(tctx.trx_buf_.size() == 0) {
+    using namespace internal;
+
+    // inserts and order-dependent statements go first, so that
+    // rows created in this batch are visible to the folded updates
+    auto& buf = tctx.trx_buf_;
+
+    format_perm_updates_to(buf, tctx.domains_upd_, "domains", "name");
+    format_perm_updates_to(buf, tctx.fungibles_upd_, "fungibles", "sym_id");
+
+    format_values_to(buf, tctx.tokens_owner_,
+        "UPDATE tokens AS t SET owner = v.owner FROM (VALUES ",
+        ") AS v(id, owner) WHERE t.id = v.id;",
+        [&](auto& row) {
+            fmt::format_to(buf, fmt("('{}','{}'::character(53)[])"), row.first, row.second);
+        });
+
+    format_values_to(buf, tctx.groups_def_,
+        "UPDATE groups AS t SET def = v.def FROM (VALUES ",
+        ") AS v(name, def) WHERE t.name = v.name;",
+        [&](auto& row) {
+            fmt::format_to(buf, fmt("('{}','{}'::jsonb)"), row.first, row.second);
+        });
+
+    format_values_to(buf, tctx.ft_holders_,
+        "INSERT INTO ft_holders VALUES ",
+        " ON CONFLICT (address) DO UPDATE SET sym_ids = ft_holders.sym_ids || excluded.sym_ids;",
+        [&](auto& row) {
+            auto& [addr, sym_ids] = row;
+            fmt::format_to(buf, fmt("(DEFAULT,'{}','{{"), addr);
+            for(auto i = 0u; i < sym_ids.size(); i++) {
+                if(i > 0) {
+                    fmt::format_to(buf, fmt(","));
+                }
+                fmt::format_to(buf, fmt("{:d}"), sym_ids[i]);
+            }
+            fmt::format_to(buf, fmt("}}',now())"));
+        });
+
+    tctx.domains_upd_.clear();
+    tctx.fungibles_upd_.clear();
+    tctx.tokens_owner_.clear();
+    tctx.groups_def_.clear();
+    tctx.ft_holders_.clear();
+
+    if(buf.size() == 0) {
         return;
     }
 
-    auto stmts = fmt::to_string(tctx.trx_buf_);
+    auto stmts = fmt::to_string(buf);
+    buf.resize(0);
 
     auto r = PQexec(conn_, stmts.c_str());
     auto s = PQresultStatus(r);
@@ -755,7 +868,7 @@ pg::add_trx(add_context& actx, const trx_recept_t& trx, const trx_t& strx, int s
     auto& cctx = actx.cctx;
     fmt::format_to(cctx.trxs_copy_,
         fmt("{}\t{:d}\t{:d}\t{}\t{:d}\t{}\t{}\t{:d}\t{}\t{}\t{}\t"),
-        strx.id().str(),
+        trx.trx.id().str(),
         trx_num,
         seq_num,
         actx.block_num,
@@ -772,7 +885,7 @@ pg::add_trx(add_context& actx, const trx_recept_t& trx, const trx_t& strx, int s
     format_array_to(cctx.trxs_copy_, std::begin(strx.signatures), std::end(strx.signatures));
 
     // keys
-    auto keys = strx.get_signature_keys(actx.chain_id);
+    auto keys = trx.trx.get_signature_keys(actx.chain_id);
     format_array_to(cctx.trxs_copy_, std::begin(keys), std::end(keys));
 
     // traces
@@ -937,32 +1050,23 @@ pg::add_domain(trx_context& tctx, const newdomain& nd) {
     return PG_OK;
 }
 
-PREPARE_SQL_ONCE(udi_plan, "UPDATE domains SET issue    = $1 WHERE name = $2;");
-PREPARE_SQL_ONCE(udt_plan, "UPDATE domains SET transfer = $1 WHERE name = $2;");
-PREPARE_SQL_ONCE(udm_plan, "UPDATE domains SET manage   = $1 WHERE name = $2;");
-
 int
 pg::upd_domain(trx_context& tctx, const updatedomain& ud) {
+    auto& upd = tctx.domains_upd_[(std::string)ud.name];
     if(ud.issue.has_value()) {
         fc::variant u;
         fc::to_variant(*ud.issue, u);
-        auto i = fc::json::to_string(u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE udi_plan('{}','{}');\n"), i, (std::string)ud.name);
+        upd.issue = fc::json::to_string(u);
     }
     if(ud.transfer.has_value()) {
         fc::variant u;
         fc::to_variant(*ud.transfer, u);
-        auto t = fc::json::to_string(u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE udt_plan('{}','{}');\n"), t, (std::string)ud.name);
+        upd.transfer = fc::json::to_string(u);
     }
     if(ud.manage.has_value()) {
         fc::variant u;
         fc::to_variant(*ud.manage, u);
-        auto m = fc::json::to_string(u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE udm_plan('{}','{}');\n"), m, (std::string)ud.name);
+        upd.manage = fc::json::to_string(u);
     }
 
     return PG_OK;
@@ -997,34 +1101,29 @@ pg::add_tokens(trx_context& tctx, const issuetoken& it) {
     return PG_OK;
 }
 
-PREPARE_SQL_ONCE(tf_plan, "UPDATE tokens SET owner = $1 WHERE id = $2;");
-
 int
 pg::upd_token(trx_context& tctx, const transfer& tf) {
-    using namespace internal;
-
     auto owners_buf = fmt::memory_buffer();
-    format_array_to(owners_buf, std::begin(tf.to), std::end(tf.to));
+    fmt::format_to(owners_buf, fmt("{{"));
+    for(auto i = 0u; i < tf.to.size(); i++) {
+        if(i > 0) {
+            fmt::format_to(owners_buf, fmt(","));
+        }
+        fmt::format_to(owners_buf, fmt("\"{}\""), (std::string)tf.to[i]);
+    }
+    fmt::format_to(owners_buf, fmt("}}"));
 
-    fmt::format_to(tctx.trx_buf_,
-        fmt("EXECUTE tf_plan('{2}','{0}:{1}');"),
-        (std::string)tf.domain,
-        (std::string)tf.name,
-        fmt::to_string(owners_buf)
-        );
+    // only the last owner of one token in the batch is written
+    auto id = fmt::format(fmt("{}:{}"), (std::string)tf.domain, (std::string)tf.name);
+    tctx.tokens_owner_[id] = fmt::to_string(owners_buf);
 
     return PG_OK;
 }
 
-PREPARE_SQL_ONCE(dt_plan, "UPDATE tokens SET owner = '{\"jmzk00000000000000000000000000000000000000000000000000\"}' WHERE id = $1;");
-
 int
 pg::del_token(trx_context& tctx, const destroytoken& dt) {
-    fmt::format_to(tctx.trx_buf_,
-        fmt("EXECUTE dt_plan('{0}:{1}');"),
-        (std::string)dt.domain,
-        (std::string)dt.name
-        );
+    auto id = fmt::format(fmt("{}:{}"), (std::string)dt.domain, (std::string)dt.name);
+    tctx.tokens_owner_[id] = "{\"jmzk00000000000000000000000000000000000000000000000000\"}";
 
     return PG_OK;
 }
@@ -1047,18 +1146,12 @@ pg::add_group(trx_context& tctx, const newgroup& ng) {
     return PG_OK;
 }
 
-PREPARE_SQL_ONCE(ug_plan, "UPDATE groups SET def = $1 WHERE name = $2;");
-
 int
 pg::upd_group(trx_context& tctx, const updategroup& ug) {
     fc::variant u;
     fc::to_variant(ug.group, u);
 
-    fmt::format_to(tctx.trx_buf_,
-        fmt("EXECUTE ug_plan('{}','{}');"),
-        fc::json::to_string(u["root"]),
-        (std::string)ug.name
-        );
+    tctx.groups_def_[(std::string)ug.name] = fc::json::to_string(u["root"]);
 
     return PG_OK;
 }
@@ -1102,46 +1195,39 @@ pg::add_fungible(trx_context& tctx, const fungible_def& ft) {
     return PG_OK;
 }
 
-PREPARE_SQL_ONCE(ufi_plan, "UPDATE fungibles SET issue  = $1 WHERE sym_id = $2;");
-PREPARE_SQL_ONCE(uft_plan, "UPDATE fungibles SET transfer  = $1 WHERE sym_id = $2;");
-PREPARE_SQL_ONCE(ufm_plan, "UPDATE fungibles SET manage = $1 WHERE sym_id = $2;");
-
 int
 pg::upd_fungible(trx_context& tctx, const updfungible& uf) {
+    auto& upd = tctx.fungibles_upd_[(int64_t)uf.sym_id];
     if(uf.issue.has_value()) {
         fc::variant u;
         fc::to_variant(*uf.issue, u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE ufi_plan('{}',{});\n"), fc::json::to_string(u), (int64_t)uf.sym_id);
+        upd.issue = fc::json::to_string(u);
     }
     if(uf.manage.has_value()) {
         fc::variant u;
         fc::to_variant(*uf.manage, u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE ufm_plan('{}',{});\n"), fc::json::to_string(u), (int64_t)uf.sym_id);
+        upd.manage = fc::json::to_string(u);
     }
     return PG_OK;
 }
 
 int
 pg::upd_fungible(trx_context& tctx, const updfungible_v2& uf) {
+    auto& upd = tctx.fungibles_upd_[(int64_t)uf.sym_id];
     if(uf.issue.has_value()) {
         fc::variant u;
         fc::to_variant(*uf.issue, u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE ufi_plan('{}',{});\n"), fc::json::to_string(u), (int64_t)uf.sym_id);
+        upd.issue = fc::json::to_string(u);
     }
     if(uf.transfer.has_value()) {
         fc::variant u;
         fc::to_variant(*uf.transfer, u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE uft_plan('{}',{});\n"), fc::json::to_string(u), (int64_t)uf.sym_id);
+        upd.transfer = fc::json::to_string(u);
     }
     if(uf.manage.has_value()) {
         fc::variant u;
         fc::to_variant(*uf.manage, u);
-
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE ufm_plan('{}',{});\n"), fc::json::to_string(u), (int64_t)uf.sym_id);
+        upd.manage = fc::json::to_string(u);
     }
     return PG_OK;
 }
@@ -1214,12 +1300,10 @@ pg::add_meta(trx_context& tctx, const action_t& act) {
     return PG_OK;
 }
 
-PREPARE_SQL_ONCE(afh_plan, "INSERT INTO ft_holders VALUES(DEFAULT, $1, $2, now()) ON CONFLICT (address) DO UPDATE SET sym_ids = array_append(ft_holders.sym_ids, excluded.sym_ids[1]);");
-
 int
 pg::add_ft_holders(trx_context& tctx, const ft_holders_t& holders) {
     for(auto& holder : holders) {
-        fmt::format_to(tctx.trx_buf_, fmt("EXECUTE afh_plan('{}','{{{}}}');"), holder.addr, (int64_t)holder.sym_id);
+        tctx.ft_holders_[holder.addr.to_string()].emplace_back((int64_t)holder.sym_id);
     }
     return PG_OK;
 }
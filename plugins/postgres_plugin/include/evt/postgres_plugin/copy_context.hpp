@@ -21,6 +21,14 @@ public:
         db_.commit_copy_context(*this);
     }
 
+    // appends the rows formatted in another context, used to gather the rows formatted on worker threads
+    void
+    append(const copy_context& cctx) {
+        blocks_copy_.append(cctx.blocks_copy_.data(), cctx.blocks_copy_.data() + cctx.blocks_copy_.size());
+        trxs_copy_.append(cctx.trxs_copy_.data(), cctx.trxs_copy_.data() + cctx.trxs_copy_.size());
+        actions_copy_.append(cctx.actions_copy_.data(), cctx.actions_copy_.data() + cctx.actions_copy_.size());
+    }
+
 private:
     fmt::memory_buffer blocks_copy_;
     fmt::memory_buffer trxs_copy_;
@@ -4,8 +4,12 @@
  */
 #pragma once
 
-#include <string_view>
+#include <map>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <fmt/format.h>
 #include <jmzk/postgres_plugin/jmzk_pg.hpp>
 
@@ -32,6 +36,21 @@ public:
 private:
     fmt::memory_buffer trx_buf_;
 
+private:
+    // state changes are folded by primary key in one context and
+    // flushed as set-based updates after `trx_buf_` when committing
+    struct perm_updates {
+        std::optional<std::string> issue;
+        std::optional<std::string> transfer;
+        std::optional<std::string> manage;
+    };
+
+    std::map<std::string, perm_updates>         domains_upd_;
+    std::map<std::string, std::string>          tokens_owner_;
+    std::map<std::string, std::string>          groups_def_;
+    std::map<int64_t, perm_updates>             fungibles_upd_;
+    std::map<std::string, std::vector<int64_t>> ft_holders_;
+
 private:
     pg&              db_;
     std::string_view trx_id_;
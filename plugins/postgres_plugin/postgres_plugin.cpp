@@ -4,7 +4,9 @@
  */
 #include <jmzk/postgres_plugin/postgres_plugin.hpp>
 
+#include <algorithm>
 #include <functional>
+#include <map>
 #include <queue>
 #include <optional>
 #include <tuple>
@@ -23,7 +25,6 @@ using boost::condition_variable_any;
 #include <fc/variant.hpp>
 #include <fc/time.hpp>
 #include <fmt/format.h>
-#include <llvm/ADT/StringSet.h>
 
 #include <jmzk/chain/config.hpp>
 #include <jmzk/chain/controller.hpp>
@@ -33,6 +34,7 @@ using boost::condition_variable_any;
 #include <jmzk/chain/genesis_state.hpp>
 #include <jmzk/chain/plugin_interface.hpp>
 #include <jmzk/chain/snapshot.hpp>
+#include <jmzk/chain/thread_utils.hpp>
 #include <jmzk/chain/transaction.hpp>
 #include <jmzk/chain/types.hpp>
 #include <jmzk/chain/token_database.hpp>
@@ -56,9 +58,29 @@ using jmzk::utilities::spinlock_guard;
 
 static appbase::abstract_plugin& _postgres_plugin = app().register_plugin<postgres_plugin>();
 
+/**
+ *  Indexer record of one transaction, it's built on the main thread when the transaction is applied
+ *  and carries the token states the indexer needs, so the consume thread never reads token database
+ *  which is being written by the main thread at the same time.
+ */
+struct trx_record {
+    transaction_trace_ptr      trace;
+    std::vector<fungible_def>  fungibles;   // created by `newfungible` actions
+    std::vector<validator_def> validators;  // changed by staking actions
+
+    // assigned in order on the consume thread
+    const transaction_receipt* receipt = nullptr;
+    int                        seq_num = 0;
+    int64_t                    trx_num = 0;
+
+    // COPY rows formatted by the workers
+    std::unique_ptr<copy_context> rows;
+};
+
 class postgres_plugin_impl {
 private:
-    using inblock_ptr = std::tuple<block_state_ptr, bool>; // true for irreversible block
+    // true for irreversible block, last is the start block num of current staking period
+    using inblock_ptr = std::tuple<block_state_ptr, bool, uint32_t>;
 
 public:
     postgres_plugin_impl(const controller& control)
@@ -73,11 +95,14 @@ public:
     void applied_irreversible_block(const block_state_ptr&);
     void applied_transaction(const transaction_trace_ptr&);
 
-    void process_block(const block_state_ptr, std::deque<transaction_trace_ptr>& traces, copy_context& cctx, trx_context& tctx);
-    void _process_block(const block_state_ptr, std::deque<transaction_trace_ptr>& traces, copy_context& cctx, trx_context& tctx);
-    void process_irreversible_block(const block_state_ptr, std::deque<transaction_trace_ptr>& traces, copy_context& cctx, trx_context& tctx);
-    
-    void process_action(const action&, trx_context& tctx);
+    void process_block(const inblock_ptr&, std::deque<trx_record>& records, copy_context& cctx, trx_context& tctx);
+    void _process_block(const inblock_ptr&, std::deque<trx_record>& records, copy_context& cctx, trx_context& tctx);
+    void process_irreversible_block(const inblock_ptr&, std::deque<trx_record>& records, copy_context& cctx, trx_context& tctx);
+
+    void capture_states(trx_record& rec);
+    void format_records(const add_context& actx, std::vector<trx_record>& records);
+
+    void process_action(const action&, const trx_record& rec, trx_context& tctx);
     void update_validators(trx_context&);
 
     void verify_last_block(const std::string& prev_block_id);
@@ -100,8 +125,8 @@ public:
     size_t processed_  = 0;
     size_t queue_size_ = 0;
 
-    std::deque<inblock_ptr>           block_state_queue_;
-    std::deque<transaction_trace_ptr> transaction_trace_queue_;
+    std::deque<inblock_ptr> block_state_queue_;
+    std::deque<trx_record>  trx_record_queue_;
 
     spinlock               lock_;
     condition_variable_any cond_;
@@ -112,7 +137,11 @@ public:
     std::thread      consume_thread_;
     std::atomic_bool done_ = false;
 
-    llvm::StringSet<llvm::MallocAllocator> changed_validators_;
+    // formats COPY rows of transactions and actions
+    std::optional<boost::asio::thread_pool> thread_pool_;
+    size_t                                  threads_ = 0;
+
+    std::map<std::string, validator_def> changed_validators_;
 
     std::optional<boost::signals2::scoped_connection> accepted_block_connection_;
     std::optional<boost::signals2::scoped_connection> irreversible_block_connection_;
@@ -155,12 +184,14 @@ queuet(Q& tqueue, V&& v, spinlock& lock, condition_variable_any& cv) {
 
 void
 postgres_plugin_impl::applied_irreversible_block(const block_state_ptr& bsp) {
-    jmzk::internal::queueb(block_state_queue_, std::make_tuple(bsp, true), lock_, cond_, queue_size_);
+    auto& sctx = control_.get_global_properties().staking_ctx;
+    jmzk::internal::queueb(block_state_queue_, std::make_tuple(bsp, true, sctx.period_start_num), lock_, cond_, queue_size_);
 }
 
 void
 postgres_plugin_impl::applied_block(const block_state_ptr& bsp) {
-    jmzk::internal::queueb(block_state_queue_, std::make_tuple(bsp, false), lock_, cond_, queue_size_);
+    auto& sctx = control_.get_global_properties().staking_ctx;
+    jmzk::internal::queueb(block_state_queue_, std::make_tuple(bsp, false, sctx.period_start_num), lock_, cond_, queue_size_);
 }
 
 void
@@ -169,7 +200,16 @@ postgres_plugin_impl::applied_transaction(const transaction_trace_ptr& ttp) {
         ttp->receipt->status != transaction_receipt_header::soft_fail)) {
         return;
     }
-    jmzk::internal::queuet(transaction_trace_queue_, ttp, lock_, cond_);
+
+    auto rec  = trx_record();
+    rec.trace = ttp;
+    try {
+        capture_states(rec);
+    }
+    catch(fc::exception& e) {
+        elog("Exception while capturing states of transaction ${id}: ${e}", ("id", ttp->id)("e", e.to_string()));
+    }
+    jmzk::internal::queuet(trx_record_queue_, std::move(rec), lock_, cond_);
 }
 
 void
@@ -185,8 +225,8 @@ postgres_plugin_impl::consume_queues() {
                 cond_.wait(lock_);
             }
 
-            auto bqueue = std::move(block_state_queue_);
-            auto traces = std::move(transaction_trace_queue_);
+            auto bqueue  = std::move(block_state_queue_);
+            auto records = std::move(trx_record_queue_);
 
             consuming_ = true;
             lock_.unlock();
@@ -220,10 +260,10 @@ postgres_plugin_impl::consume_queues() {
 
                 auto& b = bqueue.front();
                 if(std::get<IsIrreversible>(b)) {
-                    process_irreversible_block(std::get<BlockPtr>(b), traces, cctx, tctx);
+                    process_irreversible_block(b, records, cctx, tctx);
                 }
                 else {
-                    process_block(std::get<BlockPtr>(b), traces, cctx, tctx);
+                    process_block(b, records, cctx, tctx);
                 }
 
                 bqueue.pop_front();
@@ -234,9 +274,10 @@ postgres_plugin_impl::consume_queues() {
             cctx.commit();
             tctx.commit();
 
-            if(!traces.empty()) {
+            if(!records.empty()) {
                 spinlock_guard lock(lock_);
-                transaction_trace_queue_.insert(transaction_trace_queue_.begin(), traces.begin(), traces.end());
+                trx_record_queue_.insert(trx_record_queue_.begin(),
+                    std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
             }
         }
         ilog("postgres_plugin consume thread shutdown gracefully");
@@ -271,12 +312,13 @@ postgres_plugin_impl::verify_no_blocks() {
 }
 
 void
-postgres_plugin_impl::process_irreversible_block(const block_state_ptr block, std::deque<transaction_trace_ptr>& traces, copy_context& cctx, trx_context& tctx) {
+postgres_plugin_impl::process_irreversible_block(const inblock_ptr& b, std::deque<trx_record>& records, copy_context& cctx, trx_context& tctx) {
     try {
+        auto& block = std::get<0>(b);
         if(block->block_num == 1) {
             // genesis block will not trigger on_block event
             // add it manually
-            _process_block(block, traces, cctx, tctx);
+            _process_block(b, records, cctx, tctx);
         }
         db_.upd_stat(tctx, "last_irreversible_block_id", block->id.str());
     }
@@ -292,9 +334,9 @@ postgres_plugin_impl::process_irreversible_block(const block_state_ptr block, st
 }
 
 void
-postgres_plugin_impl::process_block(const block_state_ptr block, std::deque<transaction_trace_ptr>& traces, copy_context& cctx, trx_context& tctx) {
+postgres_plugin_impl::process_block(const inblock_ptr& b, std::deque<trx_record>& records, copy_context& cctx, trx_context& tctx) {
     try {
-        _process_block(block, traces, cctx, tctx);
+        _process_block(b, records, cctx, tctx);
     }
     catch(postgres_sync_exception&) {
         throw;
@@ -326,7 +368,60 @@ postgres_plugin_impl::process_block(const block_state_ptr block, std::deque<tran
     }
 
 void
-postgres_plugin_impl::process_action(const action& act, trx_context& tctx) {
+postgres_plugin_impl::capture_states(trx_record& rec) {
+    auto& cache = control_.token_db_cache();
+
+    auto capture_validator = [&](const account_name& name) {
+        auto vldt = make_empty_cache_ptr<validator_def>();
+        READ_DB_TOKEN(token_type::validator, std::nullopt, name, vldt, unknown_validator_exception,
+            "Cannot find validator with name: {}", (std::string)name);
+
+        rec.validators.emplace_back(*vldt);
+    };
+
+    for(auto& act_trace : rec.trace->action_traces) {
+        auto& act = act_trace.act;
+        switch((uint64_t)act.name) {
+        case N(newfungible): {
+            exec_ctx_.invoke_action<newfungible>(act, [&](const auto& nf) {
+                auto ft = make_empty_cache_ptr<fungible_def>();
+                READ_DB_TOKEN(token_type::fungible, std::nullopt, nf.sym.id(), ft, unknown_fungible_exception,
+                    "Cannot find FT with sym id: {}", nf.sym.id());
+
+                rec.fungibles.emplace_back(*ft);
+            });
+            break;
+        }
+        case N(recvstkbonus): {
+            exec_ctx_.invoke_action<recvstkbonus>(act, [&](const auto& rb) {
+                capture_validator(rb.validator);
+            });
+            break;
+        }
+        case N(staketkns): {
+            exec_ctx_.invoke_action<staketkns>(act, [&](const auto& st) {
+                capture_validator(st.validator);
+            });
+            break;
+        }
+        case N(unstaketkns): {
+            exec_ctx_.invoke_action<unstaketkns>(act, [&](const auto& ust) {
+                capture_validator(ust.validator);
+            });
+            break;
+        }
+        case N(toactivetkns): {
+            exec_ctx_.invoke_action<toactivetkns>(act, [&](const auto& tat) {
+                capture_validator(tat.validator);
+            });
+            break;
+        }
+        }; // switch
+    }
+}
+
+void
+postgres_plugin_impl::process_action(const action& act, const trx_record& rec, trx_context& tctx) {
     switch((uint64_t)act.name) {
     case_act(newdomain,    add_domain);
     case_act(updatedomain, upd_domain);
@@ -338,12 +433,13 @@ postgres_plugin_impl::process_action(const action& act, trx_context& tctx) {
     case_act(newvalidator, add_validator);
     case N(newfungible): {
         exec_ctx_.invoke_action<newfungible>(act, [&](const auto& nf) {
-            auto& cache = control_.token_db_cache();
-            auto  ft    = make_empty_cache_ptr<fungible_def>();
-            READ_DB_TOKEN(token_type::fungible, std::nullopt, nf.sym.id(), ft, unknown_fungible_exception,
+            auto it = std::find_if(rec.fungibles.cbegin(), rec.fungibles.cend(), [&](auto& ft) {
+                return ft.sym.id() == nf.sym.id();
+            });
+            jmzk_ASSERT2(it != rec.fungibles.cend(), unknown_fungible_exception,
                 "Cannot find FT with sym id: {}", nf.sym.id());
 
-            db_.add_fungible(tctx, *ft);
+            db_.add_fungible(tctx, *it);
         });
         break;
     }
@@ -378,51 +474,70 @@ postgres_plugin_impl::process_action(const action& act, trx_context& tctx) {
         });
         break;
     }
-    case N(recvstkbonus): {
-        exec_ctx_.invoke_action<recvstkbonus>(act, [&](const auto& rb) {
-            changed_validators_.insert(rb.validator.to_string());
-        });
-        break;
-    }
-    case N(staketkns): {
-        exec_ctx_.invoke_action<staketkns>(act, [&](const auto& st) {
-            changed_validators_.insert(st.validator.to_string());
-        });
-        break;
-    }
-    case N(unstaketkns): {
-        exec_ctx_.invoke_action<unstaketkns>(act, [&](const auto& ust) {
-            changed_validators_.insert(ust.validator.to_string());
-        });
-        break;
-    }
-    case N(toactivetkns): {
-        exec_ctx_.invoke_action<toactivetkns>(act, [&](const auto& tat) {
-            changed_validators_.insert(tat.validator.to_string());
-        });
-        break;
-    }
     }; // switch
 }
 
 void
 postgres_plugin_impl::update_validators(trx_context& tctx) {
-    for(auto& v : changed_validators_) {
-        auto& cache = control_.token_db_cache();
-        auto  vldt  = make_empty_cache_ptr<validator_def>();
-        auto  name  = v.first().str();
-        READ_DB_TOKEN(token_type::validator, std::nullopt, name, vldt, unknown_validator_exception,
-            "Cannot find validator with name: {}", name);
-
-        db_.upd_validator(tctx, *vldt);
+    for(auto& it : changed_validators_) {
+        db_.upd_validator(tctx, it.second);
     }
     changed_validators_.clear();
 }
 
 void
-postgres_plugin_impl::_process_block(const block_state_ptr block, std::deque<transaction_trace_ptr>& traces, copy_context& cctx, trx_context& tctx) {
+postgres_plugin_impl::format_records(const add_context& actx, std::vector<trx_record>& records) {
+    auto format = [&](auto begin, auto end) {
+        for(auto it = begin; it != end; it++) {
+            auto& rec = *it;
+            auto& trx = *rec.receipt;
+
+            rec.rows = std::make_unique<copy_context>(db_);
+
+            auto ractx      = add_context(*rec.rows, actx.chain_id, actx.abi, actx.exec_ctx);
+            ractx.block_id  = actx.block_id;
+            ractx.block_num = actx.block_num;
+            ractx.ts        = actx.ts;
+
+            db_.add_trx(ractx, trx, trx.trx.get_signed_transaction(), rec.seq_num, rec.trx_num,
+                (int)rec.trace->elapsed.count(), (int)rec.trace->charge);
+
+            auto act_num = 0;
+            for(auto& act_trace : rec.trace->action_traces) {
+                db_.add_action(ractx, act_trace, act_num, rec.trx_num);
+                act_num++;
+            }
+        }
+    };
+
+    // recovering keys and decoding actions dominate, small blocks are not worth the dispatching
+    if(!thread_pool_.has_value() || records.size() < threads_ * 2) {
+        format(records.begin(), records.end());
+        return;
+    }
+
+    auto chunk   = (records.size() + threads_ - 1) / threads_;
+    auto futures = std::vector<std::future<void>>();
+    for(auto i = 0u; i < records.size(); i += chunk) {
+        auto begin = records.begin() + i;
+        auto end   = records.begin() + std::min(i + chunk, records.size());
+        futures.emplace_back(async_thread_pool(*thread_pool_, [&format, begin, end] { format(begin, end); }));
+    }
+    // wait all the workers before rethrowing, they reference the records
+    for(auto& f : futures) {
+        f.wait();
+    }
+    for(auto& f : futures) {
+        f.get();
+    }
+}
+
+void
+postgres_plugin_impl::_process_block(const inblock_ptr& b, std::deque<trx_record>& records, copy_context& cctx, trx_context& tctx) {
     using namespace jmzk::internal;
 
+    auto& block = std::get<0>(b);
+
     auto id = block->id.str();
     if(block->block_num <= last_sync_block_num_) {
         jmzk_ASSERT(db_.exists_block(id), postgres_sync_exception,
@@ -441,8 +556,7 @@ postgres_plugin_impl::_process_block(const block_state_ptr block, std::deque<tra
         }
     }
 
-    auto& sctx     = control_.get_global_properties().staking_ctx;
-    auto  actx     = add_context(cctx, control_.get_chain_id(), control_.get_abi_serializer(), control_.get_execution_context());
+    auto actx      = add_context(cctx, control_.get_chain_id(), control_.get_abi_serializer(), control_.get_execution_context());
     actx.block_id  = id;
     actx.block_num = (int)block->block_num;
     actx.ts        = (std::string)block->header.timestamp.to_time_point();
@@ -450,50 +564,52 @@ postgres_plugin_impl::_process_block(const block_state_ptr block, std::deque<tra
     db_.add_block(actx, block);
     tctx.set_timestamp(actx.ts);
 
-    // transactions
-    auto trx_seq_num = 0;
+    // match records with the transactions and number them in order
+    auto block_records = std::vector<trx_record>();
+    auto trx_seq_num   = 0;
+    auto trx_num       = tctx.trx_num();
     for(const auto& trx : block->block->transactions) {
-        auto& strx    = trx.trx.get_signed_transaction();
-        auto  trx_id  = strx.id();
-        auto  elapsed = 0;
-        auto  charge  = 0;
-
-        if(trx.status == transaction_receipt_header::executed && !strx.actions.empty()) {
-            auto it = traces.begin();
-            while(it != traces.end()) {
-                auto trace = *it;
-                traces.pop_front();
-
-                if(trace->id == trx_id) {
-                    elapsed = (int)trace->elapsed.count();
-                    charge  = (int)trace->charge;
-
-                    tctx.set_trx_num(tctx.trx_num() + 1);
-                    db_.add_trx(actx, trx, strx, trx_seq_num, tctx.trx_num(), elapsed, charge);
-                    ++trx_seq_num;
-
-                    if(trace->action_traces.empty()) {
-                        break;
-                    }
-
-                    auto act_num = 0;
-                    for(auto& act_trace : trace->action_traces) {
-                        db_.add_action(actx, act_trace, act_num, tctx.trx_num());
-                        process_action(act_trace.act, tctx);
-                        if(!act_trace.new_ft_holders.empty()) {
-                            db_.add_ft_holders(tctx, act_trace.new_ft_holders);
-                        }
-                        act_num++;
-                    }
-                    break;
-                }
-                it++;
+        auto& trx_id = trx.trx.id();
+        if(trx.status != transaction_receipt_header::executed || trx.trx.get_signed_transaction().actions.empty()) {
+            continue;
+        }
+
+        while(!records.empty()) {
+            auto rec = std::move(records.front());
+            records.pop_front();
+
+            if(rec.trace->id == trx_id) {
+                rec.receipt = &trx;
+                rec.seq_num = trx_seq_num++;
+                rec.trx_num = ++trx_num;
+
+                block_records.emplace_back(std::move(rec));
+                break;
             }
         }
     }
 
+    // format rows on the workers
+    format_records(actx, block_records);
+
+    // statements of tokens and other states are executed in order
+    for(auto& rec : block_records) {
+        cctx.append(*rec.rows);
+        tctx.set_trx_num(rec.trx_num);
+
+        for(auto& act_trace : rec.trace->action_traces) {
+            process_action(act_trace.act, rec, tctx);
+            if(!act_trace.new_ft_holders.empty()) {
+                db_.add_ft_holders(tctx, act_trace.new_ft_holders);
+            }
+        }
+        for(auto& vldt : rec.validators) {
+            changed_validators_.insert_or_assign((std::string)vldt.name, vldt);
+        }
+    }
+
     // update all the validators
-    if(actx.block_num == sctx.period_start_num) {
+    if(actx.block_num == std::get<2>(b)) {
         update_validators(tctx);
     }
 
@@ -575,6 +691,9 @@ postgres_plugin_impl::~postgres_plugin_impl() {
         cond_.notify_one();
 
         consume_thread_.join();
+        if(thread_pool_.has_value()) {
+            thread_pool_->join();
+        }
         db_.close();
     }
     catch(std::exception& e) {
@@ -621,6 +740,7 @@ postgres_plugin::set_program_options(options_description& cli, options_descripti
         ("clear-postgres", bpo::bool_switch()->default_value(false), "clear postgres database, use --delete-all-blocks option will force set this option")
         ("postgres-partition-limit", bpo::value<uint>()->default_value(30000000), "The partition limit")
         ("postgres-partition-num", bpo::value<uint>()->default_value(10), "The number of partitions")
+        ("postgres-threads", bpo::value<uint>()->default_value(2), "Number of worker threads formatting the rows of transactions and actions, 0 to format on the consume thread")
         ;
 }
 
@@ -657,6 +777,13 @@ postgres_plugin::plugin_initialize(const variables_map& options) {
             my_->part_num_ = options.at("postgres-partition-num").as<uint>();
         }
 
+        if(options.count("postgres-threads")) {
+            my_->threads_ = options.at("postgres-threads").as<uint>();
+            if(my_->threads_ > 0) {
+                my_->thread_pool_.emplace(my_->threads_);
+            }
+        }
+
         if(options.count("postgres-queue-size")) {
             my_->queue_size_ = options.at("postgres-queue-size").as<uint>();
         }
@@ -82,6 +82,8 @@ producer_api_plugin::plugin_startup() {
              INVOKE_R_V(producer, get_runtime_options), 201),
         CALL(producer, producer, update_runtime_options,
              INVOKE_V_R(producer, update_runtime_options, producer_plugin::runtime_options), 201),
+        CALL(producer, producer, get_incoming_queue_stats,
+             INVOKE_R_V(producer, get_incoming_queue_stats), 201),
         CALL(producer, producer, get_integrity_hash,
              INVOKE_R_V(producer, get_integrity_hash), 201),
         CALL(producer, producer, create_snapshot,
@@ -0,0 +1,236 @@
+/**
+ *  @file
+ *  @copyright defined in jmzk/LICENSE.txt
+ */
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fc/io/raw.hpp>
+#include <jmzk/chain/plugin_interface.hpp>
+#include <jmzk/chain/transaction_metadata.hpp>
+#include <jmzk/utilities/metrics.hpp>
+
+namespace jmzk {
+
+/**
+ *  Queue of the incoming transactions, all of them are applied to the pending block in the order of
+ *  the queue, either right away while a block is pending or when next block is started.
+ *
+ *  Transactions are grouped by payer and each payer's transactions are ordered by the max charge per
+ *  byte they are willing to pay, then by arrival. Payers are served in turns by deficit round robin
+ *  over the bytes of their transactions, every turn a payer can take `quantum * weight` bytes.
+ *  So one payer flooding the node cannot push the others out of the blocks.
+ */
+class incoming_transaction_queue {
+public:
+    using next_type = chain::plugin_interface::next_function<chain::transaction_trace_ptr>;
+
+    struct entry {
+        chain::transaction_metadata_ptr trx;
+        bool                            persist_until_expired = false;
+        next_type                       next;
+
+        uint64_t priority = 0;  // max charge per KB
+        uint64_t seq      = 0;
+        uint32_t size     = 0;
+    };
+
+    struct config {
+        uint64_t max_bytes           = 64 * 1024 * 1024;
+        uint32_t max_trxs_per_payer  = 10'000;
+        uint32_t quantum             = 4 * 1024;
+        std::unordered_map<std::string, uint32_t> payer_weights;  // packed payer address to weight
+    };
+
+    struct stats {
+        size_t   size;
+        size_t   bytes;
+        size_t   payers;
+        uint64_t enqueued;
+        uint64_t dequeued;
+        uint64_t rejected;
+        uint64_t duplicated;
+        uint64_t max_bytes;
+    };
+
+    enum class push_result {
+        queued,
+        duplicated,
+        full
+    };
+
+private:
+    struct entry_less {
+        bool
+        operator()(const entry& lhs, const entry& rhs) const {
+            if(lhs.priority != rhs.priority) {
+                return lhs.priority > rhs.priority;
+            }
+            return lhs.seq < rhs.seq;
+        }
+    };
+
+    struct payer_queue {
+        std::set<entry, entry_less> entries;
+        int64_t                     deficit = 0;
+        uint32_t                    weight  = 1;
+        bool                        in_turn = false;
+    };
+
+public:
+    static std::string
+    payer_key(const chain::address& payer) {
+        auto key = std::string(fc::raw::pack_size(payer), '\0');
+        auto ds  = fc::datastream<char*>(key.data(), key.size());
+        fc::raw::pack(ds, payer);
+        return key;
+    }
+
+    void set_config(config&& conf) { conf_ = std::move(conf); }
+    const config& get_config() const { return conf_; }
+
+    bool
+    is_full() const {
+        return bytes_ >= conf_.max_bytes;
+    }
+
+    /**
+     *  Admission control, rejects the transaction when the queue is over budget or the payer has
+     *  too many pending transactions. Set `requeue` for the transactions which were already
+     *  admitted and failed subjectively, they are never rejected for the budget.
+     */
+    push_result
+    push(const chain::transaction_metadata_ptr& trx, bool persist_until_expired, next_type next, bool requeue = false) {
+        if(ids_.find(trx->signed_id) != ids_.end()) {
+            duplicated_++;
+            return push_result::duplicated;
+        }
+
+        auto  size = trx->packed_trx->get_unprunable_size() + trx->packed_trx->get_prunable_size();
+        auto  key  = payer_key(trx->packed_trx->get_transaction().payer);
+        auto& pq   = payers_[key];
+
+        if(!requeue && (bytes_ + size > conf_.max_bytes || pq.entries.size() >= conf_.max_trxs_per_payer)) {
+            if(pq.entries.empty()) {
+                payers_.erase(key);
+            }
+            rejected_++;
+            return push_result::full;
+        }
+
+        if(pq.entries.empty()) {
+            auto it   = conf_.payer_weights.find(key);
+            pq.weight = (it != conf_.payer_weights.end()) ? it->second : 1;
+            active_.emplace_back(key);
+        }
+
+        auto e = entry();
+        e.trx                   = trx;
+        e.persist_until_expired = persist_until_expired;
+        e.next                  = std::move(next);
+        e.priority              = (uint64_t)trx->packed_trx->get_transaction().max_charge * 1024 / std::max(size, 1u);
+        // requeued transactions keep their place in front of the newer ones of the same priority
+        e.seq                   = requeue ? requeue_seq_-- : seq_++;
+        e.size                  = size;
+
+        pq.entries.emplace(std::move(e));
+        ids_.emplace(trx->signed_id);
+        bytes_ += size;
+        enqueued_++;
+        update_gauges();
+
+        return push_result::queued;
+    }
+
+    std::optional<entry>
+    pop() {
+        while(!active_.empty()) {
+            auto  it = payers_.find(active_.front());
+            auto& pq = it->second;
+
+            if(!pq.in_turn) {
+                pq.deficit += (int64_t)conf_.quantum * pq.weight;
+                pq.in_turn  = true;
+            }
+
+            auto head = pq.entries.begin();
+            if(head->size <= pq.deficit) {
+                pq.deficit -= head->size;
+
+                auto e = std::move(pq.entries.extract(head).value());
+                ids_.erase(e.trx->signed_id);
+                bytes_ -= e.size;
+                dequeued_++;
+                update_gauges();
+
+                if(pq.entries.empty()) {
+                    payers_.erase(it);
+                    active_.pop_front();
+                }
+                return e;
+            }
+
+            // turn is over, the unused deficit is left for the next turn
+            pq.in_turn = false;
+            active_.emplace_back(std::move(active_.front()));
+            active_.pop_front();
+        }
+        return std::nullopt;
+    }
+
+    size_t size() const { return ids_.size(); }
+    bool   empty() const { return ids_.empty(); }
+
+    stats
+    get_stats() const {
+        return stats {
+            .size       = ids_.size(),
+            .bytes      = bytes_,
+            .payers     = payers_.size(),
+            .enqueued   = enqueued_,
+            .dequeued   = dequeued_,
+            .rejected   = rejected_,
+            .duplicated = duplicated_,
+            .max_bytes  = conf_.max_bytes
+        };
+    }
+
+private:
+    void
+    update_gauges() {
+        size_gauge_.set(ids_.size());
+        bytes_gauge_.set(bytes_);
+    }
+
+private:
+    config conf_;
+
+    std::unordered_map<std::string, payer_queue>      payers_;
+    std::deque<std::string>                           active_;  // payers in round robin order
+    std::unordered_set<chain::transaction_id_type>    ids_;
+
+    uint64_t bytes_       = 0;
+    uint64_t seq_         = std::numeric_limits<uint64_t>::max() / 2;
+    uint64_t requeue_seq_ = std::numeric_limits<uint64_t>::max() / 2 - 1;
+    uint64_t enqueued_    = 0;
+    uint64_t dequeued_    = 0;
+    uint64_t rejected_    = 0;
+    uint64_t duplicated_  = 0;
+
+    utilities::metrics::gauge& size_gauge_ = utilities::metrics::registry::instance().get_gauge(
+        "jmzk_incoming_trx_queue_size", "Number of transactions in the incoming transaction queue");
+    utilities::metrics::gauge& bytes_gauge_ = utilities::metrics::registry::instance().get_gauge(
+        "jmzk_incoming_trx_queue_bytes", "Bytes of transactions in the incoming transaction queue");
+};
+
+}  // namespace jmzk
+
+FC_REFLECT(jmzk::incoming_transaction_queue::stats, (size)(bytes)(payers)(enqueued)(dequeued)(rejected)(duplicated)(max_bytes));
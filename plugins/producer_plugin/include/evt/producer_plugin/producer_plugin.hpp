@@ -7,6 +7,7 @@
 
 #include <jmzk/chain_plugin/chain_plugin.hpp>
 #include <jmzk/http_client_plugin/http_client_plugin.hpp>
+#include <jmzk/producer_plugin/incoming_transaction_queue.hpp>
 #include <appbase/application.hpp>
 
 namespace jmzk {
@@ -64,6 +65,9 @@ public:
     void update_runtime_options(const runtime_options& options);
     runtime_options get_runtime_options() const;
 
+    incoming_transaction_queue::stats get_incoming_queue_stats() const;
+    bool                              is_incoming_queue_full() const;
+
     integrity_hash_information get_integrity_hash() const;
     snapshot_information create_snapshot(const create_snapshot_options& options) const;
 
@@ -24,6 +24,7 @@
 #include <jmzk/chain/global_property_object.hpp>
 #include <jmzk/chain/plugin_interface.hpp>
 #include <jmzk/chain/snapshot.hpp>
+#include <jmzk/producer_plugin/incoming_transaction_queue.hpp>
 
 #ifdef POSTGRES_SUPPORT
 #include <jmzk/postgres_plugin/postgres_plugin.hpp>
@@ -353,23 +354,101 @@ public:
         }
     }
     
-    std::deque<std::tuple<transaction_metadata_ptr, bool, next_function<transaction_trace_ptr>>> _pending_incoming_transactions;
+    incoming_transaction_queue _pending_incoming_transactions;
+    bool                       _incoming_drain_scheduled = false;
+    bool                       _incoming_block_full      = false;  // a transaction didn't fit the pending block, retried in next block
+
+    // transactions executed in one turn of the main thread, so other handlers are not starved
+    static constexpr size_t kIncomingDrainBatch = 64;
+
+    bool
+    queue_incoming_transaction(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next, bool requeue) {
+        auto r = _pending_incoming_transactions.push(trx, persist_until_expired, next, requeue);
+        if(requeue) {
+            _incoming_block_full = true;
+        }
+        switch(r) {
+        case incoming_transaction_queue::push_result::queued: {
+            return true;
+        }
+        case incoming_transaction_queue::push_result::duplicated: {
+            next(std::static_pointer_cast<fc::exception>(std::make_shared<tx_duplicate>(FC_LOG_MESSAGE(error, "duplicate transaction ${id}", ("id", trx->id)))));
+            break;
+        }
+        case incoming_transaction_queue::push_result::full: {
+            fc_dlog(_trx_trace_log, "[TRX_TRACE] Incoming transaction queue is full, REJECTING tx: ${txid}", ("txid", trx->id));
+            next(std::static_pointer_cast<fc::exception>(std::make_shared<too_many_tx_at_once>(FC_LOG_MESSAGE(error, "incoming transaction queue is full, rejecting ${id}", ("id", trx->id)))));
+            break;
+        }
+        }  // switch
+        return false;
+    }
+
+    void
+    schedule_incoming_drain() {
+        if(_incoming_drain_scheduled) {
+            return;
+        }
+        _incoming_drain_scheduled = true;
+        app().get_io_service().post([self = this]() {
+            self->drain_incoming_transactions();
+        });
+    }
+
+    // applies the queued transactions to the pending block in the fair order of the queue
+    void
+    drain_incoming_transactions() {
+        _incoming_drain_scheduled = false;
+
+        chain::controller& chain = chain_plug->chain();
+        if(!chain.pending_block_state() || _incoming_block_full) {
+            // picked up by next `start_block`
+            return;
+        }
+
+        auto n = std::min(_pending_incoming_transactions.size(), kIncomingDrainBatch);
+        while(n-- > 0 && chain.pending_block_state() && !_incoming_block_full) {
+            auto e = _pending_incoming_transactions.pop();
+            if(!e.has_value()) {
+                break;
+            }
+            process_incoming_transaction_async(e->trx, e->persist_until_expired, e->next);
+        }
+
+        if(!_pending_incoming_transactions.empty()) {
+            schedule_incoming_drain();
+        }
+    }
 
     void
     on_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
         chain::controller& chain = chain_plug->chain();
         const auto&        cfg   = chain.get_global_properties().configuration;
 
-        app().get_io_service().post([self = this, trx, persist_until_expired, next]() {
-            self->process_incoming_transaction_async(trx, persist_until_expired, next);
-        });
+        // de-dupe and admission control before the transaction goes into any queue
+        if(chain.is_known_unexpired_transaction(trx->id)) {
+            next(std::static_pointer_cast<fc::exception>(std::make_shared<tx_duplicate>(FC_LOG_MESSAGE(error, "duplicate transaction ${id}", ("id", trx->id)))));
+            return;
+        }
+        // every transaction goes through the queue, so the pending block takes them in fair order as well
+        // and the admission control only rejects when the queue is over its budget for this payer
+        if(!queue_incoming_transaction(trx, persist_until_expired, next, false /* requeue */)) {
+            return;
+        }
+
+        // restore keys of embedded jmzk-links on worker threads while the transaction is waiting in the queue
+        transaction_metadata::start_restore_link_keys(trx, chain.get_thread_pool());
+        // warms token database for the keys of the transaction while it's waiting in the queue
+        chain.prefetch_transaction(trx);
+
+        schedule_incoming_drain();
     }
 
     void
     process_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
         chain::controller& chain = chain_plug->chain();
         if(!chain.pending_block_state()) {
-            _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+            queue_incoming_transaction(trx, persist_until_expired, next, false /* requeue */);
             return;
         }
 
@@ -425,7 +504,7 @@ public:
             auto trace = chain.push_transaction(trx, deadline);
             if(trace->except) {
                 if(failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                    _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+                    queue_incoming_transaction(trx, persist_until_expired, next, true /* requeue */);
                     if(_pending_block_mode == pending_block_mode::producing) {
                         fc_dlog(_trx_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} COULD NOT FIT, tx: ${txid} RETRYING ",
                                 ("block_num", chain.head_block_num() + 1)("prod", chain.pending_block_state()->header.producer)("txid", trx->id));
@@ -550,6 +629,14 @@ producer_plugin::set_program_options(
             "offset of last block producing time in microseconds. Negative number results in blocks to go out sooner, and positive number results in blocks to go out later")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
             "the location of the snapshots directory (absolute path or relative to application data dir)")
+         ("incoming-transaction-queue-size-mb", bpo::value<uint32_t>()->default_value(64),
+            "Maximum size (in MiB) of the incoming transaction queue, transactions are rejected when it's exceeded")
+         ("incoming-transaction-queue-max-per-payer", bpo::value<uint32_t>()->default_value(10'000),
+            "Maximum number of queued incoming transactions of one payer")
+         ("incoming-transaction-queue-quantum", bpo::value<uint32_t>()->default_value(4 * 1024),
+            "Bytes of transactions which a payer can take in each turn of the incoming transaction queue")
+         ("incoming-transaction-queue-payer-weight", bpo::value<vector<string>>()->composing()->multitoken(),
+            "Pairs of <payer-address>=<weight>, a payer with weight N takes N times quantum bytes in each turn (default weight is 1)")
          ;
     config_file_options.add(producer_options); 
 }
@@ -679,6 +766,26 @@ producer_plugin::plugin_initialize(const boost::program_options::variables_map&
 
         my->_max_irreversible_block_age_us = fc::seconds(options.at("max-irreversible-block-age").as<int32_t>());
 
+        auto qconf = incoming_transaction_queue::config();
+        qconf.max_bytes          = (uint64_t)options.at("incoming-transaction-queue-size-mb").as<uint32_t>() * 1024 * 1024;
+        qconf.max_trxs_per_payer = options.at("incoming-transaction-queue-max-per-payer").as<uint32_t>();
+        qconf.quantum            = options.at("incoming-transaction-queue-quantum").as<uint32_t>();
+        jmzk_ASSERT(qconf.quantum > 0, plugin_config_exception, "incoming-transaction-queue-quantum must be greater than 0");
+
+        if(options.count("incoming-transaction-queue-payer-weight")) {
+            for(auto& pw : options.at("incoming-transaction-queue-payer-weight").as<vector<string>>()) {
+                auto delim = pw.find("=");
+                jmzk_ASSERT(delim != std::string::npos, plugin_config_exception, "Missing \"=\" in the payer weight pair: ${pw}", ("pw", pw));
+
+                auto payer  = address(pw.substr(0, delim));
+                auto weight = (uint32_t)std::stoul(pw.substr(delim + 1));
+                jmzk_ASSERT(weight > 0, plugin_config_exception, "Weight of payer must be greater than 0: ${pw}", ("pw", pw));
+
+                qconf.payer_weights[incoming_transaction_queue::payer_key(payer)] = weight;
+            }
+        }
+        my->_pending_incoming_transactions.set_config(std::move(qconf));
+
         if(options.count("snapshots-dir")) {
             auto sd = options.at("snapshots-dir").as<bfs::path>();
             if(sd.is_relative()) {
@@ -848,6 +955,16 @@ producer_plugin::get_runtime_options() const {
     };
 }
 
+incoming_transaction_queue::stats
+producer_plugin::get_incoming_queue_stats() const {
+    return my->_pending_incoming_transactions.get_stats();
+}
+
+bool
+producer_plugin::is_incoming_queue_full() const {
+    return my->_pending_incoming_transactions.is_full();
+}
+
 producer_plugin::integrity_hash_information
 producer_plugin::get_integrity_hash() const {
     chain::controller& chain = my->chain_plug->chain();
@@ -1096,6 +1213,7 @@ producer_plugin_impl::start_block() {
 
         chain.abort_block();
         chain.start_block(block_time, blocks_to_confirm);
+        _incoming_block_full = false;
     }
     FC_LOG_AND_DROP();
 
@@ -1272,12 +1390,14 @@ producer_plugin_impl::start_block() {
                     fc_dlog(_log, "Processing ${n} pending transactions", ("n", _pending_incoming_transactions.size()));
                     while(orig_pending_txn_size && _pending_incoming_transactions.size()) {
                         if (preprocess_deadline <= fc::time_point::now()) return start_block_result::exhausted;
-                        auto e = _pending_incoming_transactions.front();
-                        _pending_incoming_transactions.pop_front();
+                        auto e = _pending_incoming_transactions.pop();
                         --orig_pending_txn_size;
-                        process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+                        process_incoming_transaction_async(e->trx, e->persist_until_expired, e->next);
                     }
                 }
+                if(!_pending_incoming_transactions.empty()) {
+                    schedule_incoming_drain();
+                }
                 return start_block_result::succeeded;
             }
         }
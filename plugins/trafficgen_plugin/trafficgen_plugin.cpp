@@ -5,7 +5,19 @@
 #include <jmzk/trafficgen_plugin/trafficgen_plugin.hpp>
 
 #include <signal.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+
 #include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <fmt/format.h>
 
 #include <jmzk/chain/exceptions.hpp>
 #include <jmzk/chain/transaction.hpp>
@@ -13,6 +25,7 @@
 
 #include <fc/io/json.hpp>
 #include <fc/variant.hpp>
+#include <fc/variant_object.hpp>
 
 #include <jmzk/chain_plugin/chain_plugin.hpp>
 #include <jmzk/chain/plugin_interface.hpp>
@@ -29,39 +42,154 @@ using jmzk::chain::block_id_type;
 using jmzk::chain::block_state_ptr;
 using jmzk::chain::packed_transaction_ptr;
 using jmzk::chain::private_key_type;
+using jmzk::chain::transaction_id_type;
 using jmzk::chain::transaction_metadata;
 
+using std::chrono::steady_clock;
+
+namespace internal {
+
+// setup transactions are split to keep them under the limit of net usage
+constexpr auto kMaxActionsPerSetupTrx = 100u;
+constexpr auto kMaxNamesPerSetupTrx   = 5'000u;
+
+constexpr auto kInjectInterval = std::chrono::milliseconds(10);
+
+// transactions are signed ahead of the send cursor by up to two of these, bounded by the lifetime
+constexpr auto kSignAheadSecs = 60u;
+constexpr auto kMinSignWindow = 1'000ul;
+
+int64_t
+percentile(const std::vector<int64_t>& sorted, double p) {
+    if(sorted.empty()) {
+        return 0;
+    }
+    auto i = (size_t)std::ceil(p * sorted.size()) - 1;
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+fc::mutable_variant_object
+latency_report(std::vector<int64_t>& samples) {
+    std::sort(samples.begin(), samples.end());
+
+    auto sum = int64_t(0);
+    for(auto s : samples) {
+        sum += s;
+    }
+    return fc::mutable_variant_object()
+        ("count", samples.size())
+        ("mean_ms", samples.empty() ? 0.0 : (double)sum / samples.size() / 1000)
+        ("p50_ms", percentile(samples, 0.5) / 1000.0)
+        ("p90_ms", percentile(samples, 0.9) / 1000.0)
+        ("p99_ms", percentile(samples, 0.99) / 1000.0)
+        ("p999_ms", percentile(samples, 0.999) / 1000.0)
+        ("max_ms", samples.empty() ? 0.0 : samples.back() / 1000.0);
+}
+
+}  // namespace internal
+
+/**
+ *  Generates traffic over a set of accounts derived from the seed, so the transactions don't all contend
+ *  on one balance. It goes through these stages:
+ *   - setup:   funds the accounts from `traffic-from`, creates the domains and issues the tokens
+ *   - presign: signs the first window of transactions on worker threads, overlapped with setup
+ *   - inject:  pushes the transactions at a fixed open-loop rate, optionally ramped up, or all at once.
+ *              The later windows are signed just ahead of the send cursor, so the expirations set at
+ *              signing time hold however long the run is.
+ *  The latencies from push to inclusion and to irreversibility are reported at the end.
+ */
 class trafficgen_plugin_impl : public std::enable_shared_from_this<trafficgen_plugin_impl> {
+public:
+    enum class stage { idle = 0, setup, inject, done };
+
+    struct pending_trx {
+        steady_clock::time_point pushed;
+        steady_clock::time_point included;
+    };
+
 public:
     trafficgen_plugin_impl(controller& db)
-        : db_(db) {}
+        : db_(db)
+        , timer_(app().get_io_service()) {}
 
 public:
     void init();
+    void shutdown();
 
 private:
-    int  pre_nft_setup(const block_id_type& id);
-    void pre_ft_generate(const block_id_type& id);
-    void pre_nft_generate(const block_id_type& id);
-    void applied_block(const block_state_ptr& bs);
-    void push_once(int index);
-    void push_trx(const action& act, const block_id_type& id);
+    void generate_accounts();
+    void setup(const block_id_type& id);
+    void setup_fungible(const block_id_type& id);
+    void setup_domains(const block_id_type& id);
+    void presign();
+    void sign_window(size_t end);
+    void presign_range(const block_id_type& id, fc::time_point_sec expiration, size_t begin, size_t end);
+    action make_traffic_action(size_t index) const;
+
+    void accepted_block(const block_state_ptr& bs);
+    void irreversible_block(const block_state_ptr& bs);
+
+    void start_inject();
+    void inject();
+    size_t target_pushed(double elapsed_secs) const;
+    void push_once(size_t index);
+    void push_setup_trx(std::vector<action>&& acts, const block_id_type& id);
+
+    void try_finish();
+    void report();
 
 public:
     controller& db_;
 
-    uint32_t start_num_  = 0;
-    size_t   total_num_  = 0;
-    bool     pushed_     = false;
+    uint32_t start_num_     = 0;
+    size_t   total_num_     = 0;
+    uint32_t accounts_num_  = 0;
+    uint32_t domains_num_   = 0;
+    uint32_t threads_num_   = 0;
+    double   rate_          = 0;  // transactions per second, zero means all at once
+    double   ramp_secs_     = 0;
+    std::string report_file_;
+    std::string seed_;
+    std::string type_;
 
     address          from_addr_;
     private_key_type from_priv_;
 
-    std::string type_;
+    std::vector<private_key_type> account_keys_;
+    std::vector<address>          account_addrs_;
+    std::vector<chain::name128>   domains_;
+
+    stage stage_ = stage::idle;
+
+    std::unordered_set<transaction_id_type> setup_trxs_;
+    size_t                                  setup_failed_ = 0;
 
     std::vector<packed_transaction_ptr> packed_trxs_;
+    std::optional<boost::asio::thread_pool> sign_pool_;
+    std::atomic<size_t>                 presign_remaining_{0};
+    bool                                presigned_ = false;
+    steady_clock::time_point            presign_start_;
+    int64_t                             presign_us_ = 0;
+    uint32_t                            sign_ahead_secs_ = 0;
+    size_t                              signed_end_ = 0;      // [0, signed_end_) are signed
+    bool                                signing_ = false;     // a window is being signed
+    fc::time_point_sec                  first_expiration_;
+    size_t                              sign_stalls_ = 0;     // inject ticks held back by signing
+
+    boost::asio::steady_timer timer_;
+    steady_clock::time_point  inject_start_;
+    steady_clock::time_point  inject_end_;
+    size_t                    pushed_ = 0;
+    size_t                    failed_ = 0;
+
+    std::unordered_map<transaction_id_type, pending_trx>    pending_;   // pushed, not included yet
+    std::map<uint32_t, std::vector<pending_trx>>            included_;  // block num to included ones
+    std::vector<int64_t>                                    inclusion_latencies_;
+    std::vector<int64_t>                                    irreversible_latencies_;
+    steady_clock::time_point                                last_included_;
 
     std::optional<boost::signals2::scoped_connection> accepted_block_connection_;
+    std::optional<boost::signals2::scoped_connection> irreversible_block_connection_;
 };
 
 void
@@ -69,210 +197,442 @@ trafficgen_plugin_impl::init() {
     auto& chain_plug = app().get_plugin<chain_plugin>();
     auto& chain      = chain_plug.chain();
 
+    generate_accounts();
+
     accepted_block_connection_.emplace(chain.accepted_block.connect([&](const chain::block_state_ptr& bs) {
-        applied_block(bs);
+        accepted_block(bs);
     }));
+    irreversible_block_connection_.emplace(chain.irreversible_block.connect([&](const chain::block_state_ptr& bs) {
+        irreversible_block(bs);
+    }));
+}
+
+void
+trafficgen_plugin_impl::shutdown() {
+    timer_.cancel();
+    accepted_block_connection_.reset();
+    irreversible_block_connection_.reset();
+    if(sign_pool_.has_value()) {
+        sign_pool_->stop();
+        sign_pool_->join();
+    }
+    if(stage_ == stage::inject) {
+        report();
+    }
 }
 
 void
-trafficgen_plugin_impl::push_trx(const action& act, const block_id_type& id) {
+trafficgen_plugin_impl::generate_accounts() {
+    // keys are derived from the seed, so the same accounts can be reused in the next runs
+    account_keys_.reserve(accounts_num_);
+    account_addrs_.reserve(accounts_num_);
+    for(auto i = 0u; i < accounts_num_; i++) {
+        auto key = private_key_type::regenerate<fc::ecc::private_key_shim>(fc::sha256::hash(seed_ + std::to_string(i)));
+        account_addrs_.emplace_back(key.get_public_key());
+        account_keys_.emplace_back(std::move(key));
+    }
+}
+
+void
+trafficgen_plugin_impl::push_setup_trx(std::vector<action>&& acts, const block_id_type& id) {
     using namespace jmzk::chain;
-    using namespace jmzk::chain::contracts;
 
     auto now = fc::time_point::now();
     auto trx = signed_transaction();
     trx.set_reference_block(id);
-    trx.actions.emplace_back(act);
+    trx.actions    = std::move(acts);
     trx.expiration = now + fc::minutes(10);
-    trx.payer = from_addr_;
-    trx.max_charge = 10000;
+    trx.payer      = from_addr_;
+    trx.max_charge = 1'000'000;
 
     trx.sign(from_priv_, db_.get_chain_id());
 
-    auto ptrx = std::make_shared<packed_transaction>(trx);
-    app().get_method<chain::plugin_interface::incoming::methods::transaction_async>()(std::make_shared<transaction_metadata>(ptrx), true, [](const auto& result) -> void {
-        if(result.template contains<fc::exception_ptr>()) {
-            wlog("Push init trx failed e: ${e}", ("e",*result.template get<fc::exception_ptr>()));
-        }
-    });
+    auto ptrx = std::make_shared<packed_transaction>(std::move(trx));
+    setup_trxs_.emplace(ptrx->id());
+
+    app().get_method<chain::plugin_interface::incoming::methods::transaction_async>()(std::make_shared<transaction_metadata>(ptrx), true,
+        [self = shared_from_this(), id = ptrx->id()](const auto& result) -> void {
+            auto e = fc::exception_ptr();
+            if(result.template contains<fc::exception_ptr>()) {
+                e = result.template get<fc::exception_ptr>();
+            }
+            else if(result.template get<chain::transaction_trace_ptr>()->except.has_value()) {
+                e = result.template get<chain::transaction_trace_ptr>()->except->dynamic_copy_exception();
+            }
+            if(e) {
+                wlog("Push setup trx failed e: ${e}", ("e",e->to_detail_string()));
+                self->setup_trxs_.erase(id);
+                self->setup_failed_++;
+            }
+        });
 }
 
-int
-trafficgen_plugin_impl::pre_nft_setup(const block_id_type& id) {
+void
+trafficgen_plugin_impl::setup_fungible(const block_id_type& id) {
     using namespace jmzk::chain;
     using namespace jmzk::chain::contracts;
 
-    auto& tdb = db_.token_db();
-    if(tdb.exists_token(token_type::domain, std::nullopt, "tttesttt")) {
-        auto d = domain_def();
-        auto s = std::string();
-        tdb.read_token(token_type::domain, std::nullopt, "tttesttt", s);
-
-        auto ds = fc::datastream<const char*>(s.data(), s.size());
-        fc::raw::unpack(ds, d);
-
-        if(d.creator != from_addr_) {
-            ilog("Test domain created by another address: ${a} but provided is: ${p}", ("a",d.creator)("b",from_addr_));
-            return 0;
+    // every account pays the charges of its own transactions
+    auto acts = std::vector<action>();
+    for(auto i = 0u; i < accounts_num_; i++) {
+        auto tf   = transferft();
+        tf.from   = from_addr_;
+        tf.to     = account_addrs_[i];
+        tf.number = asset(10'000'00000, jmzk_sym());
+        tf.memo   = "trafficgen";
+
+        acts.emplace_back(action(N128(.fungible), N128(1), tf));
+        if(acts.size() >= internal::kMaxActionsPerSetupTrx) {
+            push_setup_trx(std::move(acts), id);
+            acts.clear();
         }
-        return 1;
     }
+    if(!acts.empty()) {
+        push_setup_trx(std::move(acts), id);
+    }
+}
 
-    ilog("Generating pre nft trx...");
-
-    auto nd    = newdomain();
-    nd.name    = "tttesttt";
-    nd.creator = from_addr_.get_public_key();
+void
+trafficgen_plugin_impl::setup_domains(const block_id_type& id) {
+    using namespace jmzk::chain;
+    using namespace jmzk::chain::contracts;
 
-    auto issue = permission_def();
-    issue.name = N(issue);
+    auto issue      = permission_def();
+    issue.name      = N(issue);
     issue.threshold = 1;
     issue.authorizers.emplace_back(authorizer_weight(authorizer_ref(from_addr_.get_public_key()), 1));
 
-    auto manage = permission_def();
-    manage.name = N(manage);
+    auto manage      = permission_def();
+    manage.name      = N(manage);
     manage.threshold = 0;
 
-    auto transfer = permission_def();
-    transfer.name = N(transfer);
+    // tokens are transferred by their owners
+    auto transfer      = permission_def();
+    transfer.name      = N(transfer);
     transfer.threshold = 1;
-    transfer.authorizers.emplace_back(authorizer_weight(authorizer_ref(from_addr_.get_public_key()), 1));
-
-    nd.issue    = issue;
-    nd.transfer = transfer;
-    nd.manage   = manage;
-
-    auto ndact = action(N128(tttesttt), N128(.create), nd);
-    push_trx(ndact, id);
+    transfer.authorizers.emplace_back(authorizer_weight(authorizer_ref(), 1));
+
+    // domains are fresh for every run, the tokens of the previous runs have been transferred
+    auto acts = std::vector<action>();
+    for(auto i = 0u; i < domains_num_; i++) {
+        auto nd     = newdomain();
+        nd.name     = name128(fmt::format("tg{}x{}", db_.head_block_num(), i));
+        nd.creator  = from_addr_.get_public_key();
+        nd.issue    = issue;
+        nd.transfer = transfer;
+        nd.manage   = manage;
+
+        domains_.emplace_back(nd.name);
+        acts.emplace_back(action(nd.name, N128(.create), nd));
+    }
+    push_setup_trx(std::move(acts), id);
+    acts.clear();
+
+    // see `make_traffic_action` for the mapping from index to token
+    auto names = 0u;
+    for(auto d = 0u; d < domains_num_; d++) {
+        for(auto a = 0u; a < accounts_num_; a++) {
+            auto it   = issuetoken();
+            it.domain = domains_[d];
+            it.owner.emplace_back(account_addrs_[a]);
+            for(auto i = (size_t)d * accounts_num_ + a; i < total_num_; i += (size_t)domains_num_ * accounts_num_) {
+                it.names.emplace_back(name128::from_number(i));
+            }
+            if(it.names.empty()) {
+                continue;
+            }
 
-    for(auto i = 0; i < 20; i++) {
-        auto it   = issuetoken();
-        it.domain = "tttesttt";
-        it.owner.emplace_back(from_addr_);
-        for(auto j = i * 10'000; j < 10'000 * (i + 1); j++) {
-            it.names.emplace_back(name128::from_number(j));
+            names += it.names.size();
+            acts.emplace_back(action(it.domain, N128(.issue), it));
+            if(acts.size() >= internal::kMaxActionsPerSetupTrx || names >= internal::kMaxNamesPerSetupTrx) {
+                push_setup_trx(std::move(acts), id);
+                acts.clear();
+                names = 0;
+            }
         }
+    }
+    if(!acts.empty()) {
+        push_setup_trx(std::move(acts), id);
+    }
+}
 
-        auto itact = action(N128(tttesttt), N128(.issue), it);
-        push_trx(itact, id);
+void
+trafficgen_plugin_impl::setup(const block_id_type& id) {
+    ilog("Setting up trafficgen with ${n} accounts...", ("n",accounts_num_));
+
+    setup_fungible(id);
+    if(type_ == "nft") {
+        setup_domains(id);
     }
+    stage_ = stage::setup;
 
-    ilog("Generating pre nft trx... Done");
-    return 1;
+    ilog("Setting up trafficgen with ${n} accounts... ${t} trxs pushed", ("n",accounts_num_)("t",setup_trxs_.size()));
 }
 
-void
-trafficgen_plugin_impl::pre_ft_generate(const block_id_type& id) {
+action
+trafficgen_plugin_impl::make_traffic_action(size_t index) const {
     using namespace jmzk::chain;
     using namespace jmzk::chain::contracts;
 
-    ilog("Generating ft ptrxs...");
-
-    packed_trxs_.reserve(total_num_);
+    auto from = index % accounts_num_;
+    auto to   = (from + 1 + index / accounts_num_ % (accounts_num_ - 1)) % accounts_num_;
 
-    auto tt   = transferft();
-    tt.from   = from_addr_;
-    tt.number = asset(10, jmzk_sym());
-    tt.memo   = "FROM THE NEW WORLD";
+    if(type_ == "ft") {
+        auto tf   = transferft();
+        tf.from   = account_addrs_[from];
+        tf.to     = account_addrs_[to];
+        tf.number = asset(1, jmzk_sym());
+        tf.memo   = std::to_string(index);  // makes the transactions unique
 
-    auto ttact = action(N128(.fungible), N128(1), tt);
+        return action(N128(.fungible), N128(1), tf);
+    }
+    else {
+        // token `index` is issued to account `index % accounts` in domain `index / accounts % domains`
+        auto tt   = transfer();
+        tt.domain = domains_[index / accounts_num_ % domains_num_];
+        tt.name   = name128::from_number(index);
+        tt.to.emplace_back(account_addrs_[to]);
+        tt.memo   = "trafficgen";
+
+        return action(tt.domain, tt.name, tt);
+    }
+}
 
-    auto now = fc::time_point::now();
-    for(auto i = 0u; i < total_num_; i++) {
-        auto priv = private_key_type::generate();
-        auto pub  = priv.get_public_key();
+void
+trafficgen_plugin_impl::presign_range(const block_id_type& id, fc::time_point_sec expiration, size_t begin, size_t end) {
+    using namespace jmzk::chain;
 
-        tt.to = pub;
-        ttact.set_data(tt);
+    auto& chain_id = db_.get_chain_id();
+    for(auto i = begin; i < end; i++) {
+        auto from = i % accounts_num_;
 
         auto trx = signed_transaction();
         trx.set_reference_block(id);
-        trx.actions.emplace_back(ttact);
-        trx.expiration = now + fc::minutes(10);
-        trx.payer = from_addr_;
+        trx.actions.emplace_back(make_traffic_action(i));
+        trx.expiration = expiration;
+        trx.payer      = account_addrs_[from];
         trx.max_charge = 10000;
-        trx.sign(from_priv_, db_.get_chain_id());
+        trx.sign(account_keys_[from], chain_id);
 
-        packed_trxs_.emplace_back(std::make_shared<packed_transaction>(trx));
+        packed_trxs_[i] = std::make_shared<packed_transaction>(std::move(trx));
     }
-
-    ilog("Generating ft ptrxs... Done");
 }
 
 void
-trafficgen_plugin_impl::pre_nft_generate(const block_id_type& id) {
-    using namespace jmzk::chain;
-    using namespace jmzk::chain::contracts;
+trafficgen_plugin_impl::presign() {
+    // workers write into the separated slots, the vector itself is never resized during signing
+    packed_trxs_.resize(total_num_);
+    sign_pool_.emplace(threads_num_);
 
-    ilog("Generating nft ptrxs...");
+    // one transaction signed right before a window may be pushed two windows later
+    auto lifetime    = db_.get_global_properties().configuration.max_transaction_lifetime - 60;
+    sign_ahead_secs_ = std::max(1u, std::min(internal::kSignAheadSecs, lifetime / 3));
 
-    packed_trxs_.reserve(total_num_);
-
-    auto tt   = transfer();
-    tt.domain = "tttesttt";
-    tt.memo   = "FROM THE NEW WORLD";
-
-    auto ttact = action(N128(tttesttt), N128(0), tt);
-
-    auto now = fc::time_point::now();
-    for(auto i = 0u; i < total_num_; i++) {
-        auto priv = private_key_type::generate();
-        auto pub  = priv.get_public_key();
+    sign_window(target_pushed(2 * sign_ahead_secs_));
+}
 
-        tt.name = name128::from_number(i);
-        tt.to.emplace_back(pub);
-        ttact.set_data(tt);
-        ttact.key = name128::from_number(i);
+void
+trafficgen_plugin_impl::sign_window(size_t end) {
+    assert(!signing_);
 
-        auto trx = signed_transaction();
-        trx.set_reference_block(id);
-        trx.actions.emplace_back(ttact);
-        trx.expiration = now + fc::minutes(10);
-        trx.payer = from_addr_;
-        trx.max_charge = 10000;
-        trx.sign(from_priv_, db_.get_chain_id());
+    auto begin = signed_end_;
+    end        = std::min(total_num_, std::max(end, begin + internal::kMinSignWindow));
+    if(begin >= end) {
+        return;
+    }
+    ilog("Presigning trxs [${b}, ${e}) on ${t} threads...", ("b",begin)("e",end)("t",threads_num_));
 
-        packed_trxs_.emplace_back(std::make_shared<packed_transaction>(trx));
+    // expiration is fixed when signing, later windows refer to the latest head
+    auto id         = db_.head_block_id();
+    auto expiration = fc::time_point_sec(fc::time_point::now() + fc::seconds(db_.get_global_properties().configuration.max_transaction_lifetime - 60));
+    if(begin == 0) {
+        first_expiration_ = expiration;
     }
 
-    ilog("Generating nft ptrxs... Done");
+    auto chunk = std::max<size_t>(1'000, (end - begin) / threads_num_ / 16);
+    auto tasks = (end - begin + chunk - 1) / chunk;
+
+    signing_           = true;
+    presign_start_     = steady_clock::now();
+    presign_remaining_ = tasks;
+    for(auto b = begin; b < end; b += chunk) {
+        boost::asio::post(*sign_pool_, [self = shared_from_this(), id, expiration, b, e = std::min(b + chunk, end), end] {
+            self->presign_range(id, expiration, b, e);
+            if(--self->presign_remaining_ == 0) {
+                app().post(appbase::priority::low, [self, end] {
+                    auto us = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - self->presign_start_).count();
+                    self->signing_    = false;
+                    self->signed_end_ = end;
+                    if(!self->presigned_) {
+                        self->presigned_  = true;
+                        self->presign_us_ = us;
+                    }
+                    ilog("Presigning trxs until ${e}... Done in ${s} ms", ("e",end)("s",us / 1000));
+                });
+            }
+        });
+    }
 }
 
 void
-trafficgen_plugin_impl::applied_block(const block_state_ptr& bs) {
-    if(bs->block_num >= start_num_) {
-        if(packed_trxs_.empty()) {
-            if(type_ == "ft") {
-                pre_ft_generate(bs->id);
+trafficgen_plugin_impl::accepted_block(const block_state_ptr& bs) {
+    auto now = steady_clock::now();
+
+    switch(stage_) {
+    case stage::idle: {
+        if(bs->block_num >= start_num_) {
+            setup(bs->id);
+            presign();
+        }
+        break;
+    }
+    case stage::setup: {
+        for(auto& trx : bs->trxs) {
+            setup_trxs_.erase(trx->id);
+        }
+        // waits for the node to be synced
+        if(presigned_ && setup_trxs_.empty() && std::abs((db_.head_block_time() - fc::time_point::now()).to_seconds()) < 1) {
+            if(setup_failed_ > 0) {
+                wlog("${n} setup trxs are failed, the traffic may fail too", ("n",setup_failed_));
             }
-            else if(type_ == "nft") {
-                if(pre_nft_setup(bs->id)) {
-                    pre_nft_generate(bs->id);
-                }
+            // setup took so long that the first window may expire before being pushed, sign it again
+            if(first_expiration_ < fc::time_point::now() + fc::seconds(2 * sign_ahead_secs_)) {
+                wlog("Presigned trxs are close to expiration after setup, signing them again");
+                presigned_  = false;
+                signed_end_ = 0;
+                sign_window(target_pushed(2 * sign_ahead_secs_));
+                break;
             }
+            start_inject();
         }
-        else {
-            auto now = fc::time_point::now();
-            if(!pushed_ && std::abs((db_.head_block_time() - now).to_seconds()) < 1) {
-                const auto& exec = app().get_io_service().get_executor();
-                for(auto i = 0u; i < total_num_; i++) {
-                    boost::asio::post(exec, std::bind(&trafficgen_plugin_impl::push_once, this, (int)i));
-                }
-                pushed_ = true;
+        break;
+    }
+    case stage::inject: {
+        auto& included = included_[bs->block_num];
+        for(auto& trx : bs->trxs) {
+            auto it = pending_.find(trx->id);
+            if(it == pending_.end()) {
+                continue;
             }
+            it->second.included = now;
+            inclusion_latencies_.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(now - it->second.pushed).count());
+            included.emplace_back(it->second);
+            pending_.erase(it);
+            last_included_ = now;
+        }
+        if(included.empty()) {
+            included_.erase(bs->block_num);
         }
+        break;
+    }
+    default: {
+        break;
     }
+    }  // switch
 }
 
 void
-trafficgen_plugin_impl::push_once(int index) {
-    try {
-        auto ptrx = packed_trxs_[index];
-        app().get_method<chain::plugin_interface::incoming::methods::transaction_async>()(std::make_shared<transaction_metadata>(ptrx), true, [index](const auto& result) -> void {
-            if(result.template contains<fc::exception_ptr>()) {
-                wlog("Push failed at index: ${i}, e: ${e}", ("i",index)("e",*result.template get<fc::exception_ptr>()));
+trafficgen_plugin_impl::irreversible_block(const block_state_ptr& bs) {
+    if(stage_ != stage::inject) {
+        return;
+    }
+
+    auto now = steady_clock::now();
+    while(!included_.empty() && included_.begin()->first <= bs->block_num) {
+        for(auto& p : included_.begin()->second) {
+            irreversible_latencies_.emplace_back(std::chrono::duration_cast<std::chrono::microseconds>(now - p.pushed).count());
+        }
+        included_.erase(included_.begin());
+    }
+    try_finish();
+}
+
+size_t
+trafficgen_plugin_impl::target_pushed(double elapsed) const {
+    if(rate_ <= 0) {
+        return total_num_;
+    }
+
+    // rate grows linearly from zero to `rate_` in the ramp
+    auto target = 0.0;
+    if(elapsed < ramp_secs_) {
+        target = rate_ * elapsed * elapsed / (2 * ramp_secs_);
+    }
+    else {
+        target = rate_ * ramp_secs_ / 2 + rate_ * (elapsed - ramp_secs_);
+    }
+    return std::min(total_num_, (size_t)target);
+}
+
+void
+trafficgen_plugin_impl::start_inject() {
+    ilog("Injecting ${n} trxs at rate: ${r} tps, ramp: ${p} secs", ("n",total_num_)("r",rate_)("p",ramp_secs_));
+
+    stage_        = stage::inject;
+    inject_start_ = steady_clock::now();
+    pending_.reserve(total_num_);
+    inclusion_latencies_.reserve(total_num_);
+    irreversible_latencies_.reserve(total_num_);
+
+    inject();
+}
+
+void
+trafficgen_plugin_impl::inject() {
+    // open loop: the transactions are pushed on schedule regardless of how fast they are processed
+    auto elapsed = std::chrono::duration<double>(steady_clock::now() - inject_start_).count();
+    auto target  = target_pushed(elapsed);
+    if(target > signed_end_) {
+        // signing falls behind the rate, the report shows it instead of pushing expired trxs
+        target = signed_end_;
+        sign_stalls_++;
+    }
+    while(pushed_ < target) {
+        push_once(pushed_++);
+    }
+
+    // keeps at least one window signed ahead of the cursor
+    if(!signing_ && signed_end_ < total_num_ && signed_end_ < target_pushed(elapsed + sign_ahead_secs_)) {
+        sign_window(target_pushed(elapsed + 2 * sign_ahead_secs_));
+    }
+
+    if(pushed_ < total_num_) {
+        timer_.expires_after(internal::kInjectInterval);
+        timer_.async_wait([self = shared_from_this()](auto& ec) {
+            if(!ec) {
+                self->inject();
             }
         });
+        return;
+    }
+
+    inject_end_ = steady_clock::now();
+    ilog("Injecting ${n} trxs... Done in ${s} ms", ("n",total_num_)
+        ("s",std::chrono::duration_cast<std::chrono::milliseconds>(inject_end_ - inject_start_).count()));
+}
+
+void
+trafficgen_plugin_impl::push_once(size_t index) {
+    try {
+        auto ptrx = std::move(packed_trxs_[index]);
+        pending_.emplace(ptrx->id(), pending_trx { .pushed = steady_clock::now() });
+
+        app().get_method<chain::plugin_interface::incoming::methods::transaction_async>()(std::make_shared<transaction_metadata>(ptrx), true,
+            [self = shared_from_this(), index, id = ptrx->id()](const auto& result) -> void {
+                auto e = fc::exception_ptr();
+                if(result.template contains<fc::exception_ptr>()) {
+                    e = result.template get<fc::exception_ptr>();
+                }
+                else if(result.template get<chain::transaction_trace_ptr>()->except.has_value()) {
+                    e = result.template get<chain::transaction_trace_ptr>()->except->dynamic_copy_exception();
+                }
+                if(e) {
+                    wlog("Push failed at index: ${i}, e: ${e}", ("i",index)("e",e->to_string()));
+                    self->pending_.erase(id);
+                    self->failed_++;
+                    self->try_finish();
+                }
+            });
     }
     catch(boost::interprocess::bad_alloc&) {
         raise(SIGUSR1);
@@ -282,6 +642,47 @@ trafficgen_plugin_impl::push_once(int index) {
     }
     catch(...) {
         wlog("Push failed at index: ${i}", ("i",index));
+        failed_++;
+    }
+}
+
+void
+trafficgen_plugin_impl::try_finish() {
+    if(stage_ == stage::inject && pushed_ == total_num_ && pending_.empty() && included_.empty()) {
+        report();
+        stage_ = stage::done;
+    }
+}
+
+void
+trafficgen_plugin_impl::report() {
+    auto included = inclusion_latencies_.size();
+    auto secs     = std::chrono::duration<double>(last_included_ - inject_start_).count();
+
+    auto r = fc::mutable_variant_object()
+        ("type", type_)
+        ("accounts", accounts_num_)
+        ("domains", type_ == "nft" ? domains_num_ : 0)
+        ("total", total_num_)
+        ("rate", rate_)
+        ("ramp_secs", ramp_secs_)
+        ("presign_ms", presign_us_ / 1000)
+        ("sign_stalls", sign_stalls_)
+        ("pushed", pushed_)
+        ("failed", failed_)
+        ("pending", pending_.size())
+        ("included", included)
+        ("irreversible", irreversible_latencies_.size())
+        ("achieved_tps", secs > 0 ? included / secs : 0.0)
+        ("inclusion_latency", internal::latency_report(inclusion_latencies_))
+        ("irreversible_latency", internal::latency_report(irreversible_latencies_));
+
+    auto json = fc::json::to_pretty_string(fc::variant(r));
+    ilog("Trafficgen report: ${r}", ("r",json));
+
+    if(!report_file_.empty()) {
+        auto ofs = std::ofstream(report_file_, std::ios::out | std::ios::trunc);
+        ofs << json << std::endl;
     }
 }
 
@@ -293,28 +694,48 @@ trafficgen_plugin::set_program_options(options_description&, options_description
         ("traffic-from", bpo::value<std::string>(), "Address of sender when generating")
         ("traffic-from-priv", bpo::value<std::string>(), "Private key of sender when generating")
         ("traffic-type", bpo::value<std::string>()->default_value("ft"), "Type of transactions, can be 'nft' or 'ft'")
+        ("traffic-accounts", bpo::value<uint32_t>()->default_value(1000), "Number of accounts to send and receive the transactions, funded by 'traffic-from'")
+        ("traffic-domains", bpo::value<uint32_t>()->default_value(10), "Number of domains the tokens are issued in for 'nft' type")
+        ("traffic-seed", bpo::value<std::string>()->default_value("trafficgen"), "Seed to derive the keys of accounts")
+        ("traffic-threads", bpo::value<uint32_t>()->default_value(4), "Number of threads to presign the transactions")
+        ("traffic-rate", bpo::value<double>()->default_value(0), "Transactions per second to be pushed, 0 to push all at once")
+        ("traffic-ramp", bpo::value<uint32_t>()->default_value(0), "Seconds to ramp the rate up linearly from zero to 'traffic-rate'")
+        ("traffic-report", bpo::value<std::string>(), "File to write the report in JSON, only logged if not provided")
     ;
 }
 
 void
 trafficgen_plugin::plugin_initialize(const variables_map& options) {
     my_ = std::make_shared<trafficgen_plugin_impl>(app().get_plugin<chain_plugin>().chain());
-    my_->start_num_ = options.at("traffic-start-num").as<uint32_t>();
-    my_->total_num_ = options.at("traffic-total").as<size_t>();
-
-    jmzk_ASSERT(my_->total_num_ <= 200'000, chain::plugin_config_exception, "Total number of generating transactions cannot be large than 200'000");
-
-    if(options.count("traffic-from") && options.count("traffic-from-priv")) {
-        my_->from_addr_ = address(options.at("traffic-from").as<std::string>());
-        my_->from_priv_ = private_key_type(options.at("traffic-from-priv").as<std::string>());
-        my_->init(); 
+    my_->start_num_    = options.at("traffic-start-num").as<uint32_t>();
+    my_->total_num_    = options.at("traffic-total").as<size_t>();
+    my_->accounts_num_ = options.at("traffic-accounts").as<uint32_t>();
+    my_->domains_num_  = options.at("traffic-domains").as<uint32_t>();
+    my_->seed_         = options.at("traffic-seed").as<std::string>();
+    my_->threads_num_  = options.at("traffic-threads").as<uint32_t>();
+    my_->rate_         = options.at("traffic-rate").as<double>();
+    my_->ramp_secs_    = options.at("traffic-ramp").as<uint32_t>();
+    if(options.count("traffic-report")) {
+        my_->report_file_ = options.at("traffic-report").as<std::string>();
     }
 
+    jmzk_ASSERT(my_->total_num_ <= 5'000'000, chain::plugin_config_exception, "Total number of generating transactions cannot be large than 5'000'000");
+    jmzk_ASSERT(my_->accounts_num_ >= 2, chain::plugin_config_exception, "Number of accounts should be at least 2");
+    jmzk_ASSERT(my_->domains_num_ >= 1, chain::plugin_config_exception, "Number of domains should be at least 1");
+    jmzk_ASSERT(my_->threads_num_ >= 1, chain::plugin_config_exception, "Number of threads should be at least 1");
+    jmzk_ASSERT(my_->rate_ >= 0, chain::plugin_config_exception, "Rate cannot be negative");
+
     if(options.count("traffic-type")) {
         auto type = options.at("traffic-type").as<std::string>();
         jmzk_ASSERT(type == "ft" || type == "nft", chain::plugin_config_exception, "Not valid value for --traffic-type option");
         my_->type_ = type;
     }
+
+    if(options.count("traffic-from") && options.count("traffic-from-priv") && my_->total_num_ > 0) {
+        my_->from_addr_ = address(options.at("traffic-from").as<std::string>());
+        my_->from_priv_ = private_key_type(options.at("traffic-from-priv").as<std::string>());
+        my_->init();
+    }
 }
 
 void
@@ -324,7 +745,7 @@ trafficgen_plugin::plugin_startup() {
 
 void
 trafficgen_plugin::plugin_shutdown() {
-    my_->accepted_block_connection_.reset();
+    my_->shutdown();
     my_.reset();
 }
 
@@ -101,6 +101,11 @@ public:
     /** Returns a signature given the digest and public_key, if this wallet can sign via that public key
        */
     virtual std::optional<signature_type> try_sign_digest(const digest_type digest, const public_key_type public_key) = 0;
+
+    /** Returns true if \c try_sign_digest can be called from several threads at once,
+       * wallets backed by devices sign one digest at a time
+       */
+    virtual bool can_sign_concurrently() const { return false; }
 };
 
 }}  // namespace jmzk::wallet
\ No newline at end of file
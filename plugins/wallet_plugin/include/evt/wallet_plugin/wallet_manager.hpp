@@ -4,9 +4,11 @@
  */
 #pragma once
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/thread_pool.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 #include <chrono>
+#include <optional>
 #include <jmzk/chain/transaction.hpp>
 #include <jmzk/wallet_plugin/wallet_api.hpp>
 
@@ -17,6 +19,25 @@ class variant;
 namespace jmzk {
 namespace wallet {
 
+/// One transaction to sign in a batch and the public keys to sign it with.
+struct sign_trx_request {
+    chain::signed_transaction trx;
+    flat_set<public_key_type> keys;
+};
+
+/// Error of one item in a batch, same fields as the error info of http responses.
+struct sign_trx_error {
+    int64_t     code;
+    std::string name;
+    std::string what;
+};
+
+/// Result of one item in a batch, either the signed transaction or the error.
+struct sign_trx_result {
+    std::optional<chain::signed_transaction> trx;
+    std::optional<sign_trx_error>            error;
+};
+
 /// Provides associate of wallet name to wallet and manages the interaction with each wallet.
 ///
 /// The name of the wallet is also used as part of the file name by soft_wallet. See wallet_manager::create.
@@ -59,6 +80,17 @@ public:
     chain::signed_transaction sign_transaction(const chain::signed_transaction& txn, const flat_set<public_key_type>& keys,
                                                const chain::chain_id_type& id);
 
+    /// Sign a batch of transactions, each with its own public keys.
+    /// Keys are resolved to the unlocked wallets once for the whole batch and
+    /// transactions are signed on the signing threads when their wallets allow it.
+    /// @param reqs the transactions and the public keys to sign each of them with.
+    /// @param id the chain_id to sign transactions with.
+    /// @return one result per request in the same order, failed items carry their error instead of throwing
+    std::vector<sign_trx_result> sign_transactions(const std::vector<sign_trx_request>& reqs, const chain::chain_id_type& id);
+
+    /// Set the number of threads used by sign_transactions, 0 signs on the calling thread.
+    void set_signing_threads(uint32_t threads);
+
     /// Sign digest with the private keys specified via their public keys.
     /// @param digest the digest to sign.
     /// @param key the public key of the corresponding private key to sign the digest with
@@ -154,6 +186,12 @@ private:
 
     void start_lock_watch(std::shared_ptr<boost::asio::deadline_timer> t);
     void initialize_lock();
+
+    std::optional<boost::asio::thread_pool> signing_pool;  ///< threads of sign_transactions
 };
 
 }}  // namespace jmzk::wallet
+
+FC_REFLECT(jmzk::wallet::sign_trx_request, (trx)(keys));
+FC_REFLECT(jmzk::wallet::sign_trx_error, (code)(name)(what));
+FC_REFLECT(jmzk::wallet::sign_trx_result, (trx)(error));
@@ -12,6 +12,7 @@
 #include <list>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
 #include <fc/container/deque.hpp>
 #include <fc/crypto/aes.hpp>
@@ -72,7 +73,7 @@ public:
     encrypt_keys() {
         if(!is_locked()) {
             plain_keys data;
-            data.keys           = _keys;
+            data.keys           = map<public_key_type, private_key_type>(_keys.begin(), _keys.end());
             data.checksum       = _checksum;
             auto plain_txt      = fc::raw::pack(data);
             _wallet.cipher_keys = fc::aes_encrypt(data.checksum, plain_txt);
@@ -245,8 +246,9 @@ public:
     string      _wallet_filename;
     wallet_data _wallet;
 
-    map<public_key_type, private_key_type> _keys;
-    fc::sha512                             _checksum;
+    // unlocked keys, hashed as they're looked up for every signature
+    std::unordered_map<public_key_type, private_key_type> _keys;
+    fc::sha512                                            _checksum;
 
 #ifdef __unix__
     mode_t _old_umask;
@@ -353,7 +355,7 @@ soft_wallet::unlock(string password) {
         auto pk        = fc::raw::unpack<plain_keys>(decrypted);
 
         FC_ASSERT(pk.checksum == pw);
-        my->_keys     = std::move(pk.keys);
+        my->_keys     = std::unordered_map<public_key_type, private_key_type>(pk.keys.begin(), pk.keys.end());
         my->_checksum = pk.checksum;
     }
     jmzk_RETHROW_EXCEPTIONS(chain::wallet_invalid_password_exception,
@@ -384,7 +386,7 @@ soft_wallet::set_password(string password) {
 map<public_key_type, private_key_type>
 soft_wallet::list_keys() {
     jmzk_ASSERT(!is_locked(), wallet_locked_exception, "Unable to list public keys of a locked wallet");
-    return my->_keys;
+    return map<public_key_type, private_key_type>(my->_keys.begin(), my->_keys.end());
 }
 
 flat_set<public_key_type>
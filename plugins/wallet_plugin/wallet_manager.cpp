@@ -2,10 +2,12 @@
  *  @file
  *  @copyright defined in jmzk/LICENSE.txt
  */
+#include <unordered_map>
 #include <fc/crypto/sha256.hpp>
 #include <boost/algorithm/string.hpp>
 #include <appbase/application.hpp>
 #include <jmzk/chain/exceptions.hpp>
+#include <jmzk/chain/thread_utils.hpp>
 #include <jmzk/wallet_plugin/wallet_manager.hpp>
 #include <jmzk/wallet_plugin/wallet.hpp>
 #include <jmzk/wallet_plugin/se_wallet.hpp>
@@ -292,6 +294,122 @@ wallet_manager::sign_transaction(const chain::signed_transaction& txn, const fla
     return stxn;
 }
 
+namespace internal {
+
+// items are handed to the signing threads in chunks of this size
+constexpr auto kSignChunkSize = 32u;
+
+sign_trx_error
+make_sign_error() {
+    try {
+        throw;
+    }
+    catch(const fc::exception& e) {
+        return sign_trx_error { e.code(), e.name(), e.top_message() };
+    }
+    catch(const std::exception& e) {
+        return sign_trx_error { fc::std_exception_code, "exception", e.what() };
+    }
+    catch(...) {
+        return sign_trx_error { fc::unhandled_exception_code, "exception", "unknown exception" };
+    }
+}
+
+}  // namespace internal
+
+std::vector<sign_trx_result>
+wallet_manager::sign_transactions(const std::vector<sign_trx_request>& reqs, const chain::chain_id_type& id) {
+    using namespace internal;
+
+    check_timeout();
+
+    // first unlocked wallet having the key, same as the order `sign_transaction` tries them
+    auto key_wallets = std::unordered_map<public_key_type, wallet_api*>();
+    for(const auto& i : wallets) {
+        if(i.second->is_locked()) {
+            continue;
+        }
+        for(auto& pk : i.second->list_public_keys()) {
+            key_wallets.emplace(pk, i.second.get());
+        }
+    }
+
+    auto results = std::vector<sign_trx_result>(reqs.size());
+
+    auto sign = [&](size_t i) {
+        auto& req = reqs[i];
+        try {
+            auto stxn   = chain::signed_transaction(req.trx);
+            auto digest = stxn.sig_digest(id);
+            for(const auto& pk : req.keys) {
+                auto it  = key_wallets.find(pk);
+                auto sig = std::optional<signature_type>();
+                if(it != key_wallets.end()) {
+                    sig = it->second->try_sign_digest(digest, pk);
+                }
+                if(!sig.has_value()) {
+                    jmzk_THROW(chain::wallet_missing_pub_key_exception, "Public key not found in unlocked wallets ${k}", ("k", pk));
+                }
+                stxn.signatures.push_back(*sig);
+            }
+            results[i].trx = std::move(stxn);
+        }
+        catch(...) {
+            results[i].error = make_sign_error();
+        }
+    };
+
+    // items using wallets which cannot sign concurrently stay on this thread
+    auto parallel = std::vector<size_t>();
+    for(auto i = 0u; i < reqs.size(); i++) {
+        auto ok = true;
+        for(const auto& pk : reqs[i].keys) {
+            auto it = key_wallets.find(pk);
+            if(it != key_wallets.end() && !it->second->can_sign_concurrently()) {
+                ok = false;
+                break;
+            }
+        }
+        if(ok) {
+            parallel.emplace_back(i);
+        }
+        else {
+            sign(i);
+        }
+    }
+
+    if(!signing_pool.has_value() || parallel.size() <= kSignChunkSize) {
+        for(auto i : parallel) {
+            sign(i);
+        }
+        return results;
+    }
+
+    auto futures = std::vector<std::future<void>>();
+    futures.reserve(parallel.size() / kSignChunkSize + 1);
+    for(auto begin = 0u; begin < parallel.size(); begin += kSignChunkSize) {
+        auto end = std::min((size_t)begin + kSignChunkSize, parallel.size());
+        futures.emplace_back(chain::async_thread_pool(*signing_pool, [&sign, &parallel, begin, end] {
+            for(auto i = begin; i < end; i++) {
+                sign(parallel[i]);
+            }
+        }));
+    }
+    for(auto& f : futures) {
+        f.get();
+    }
+
+    return results;
+}
+
+void
+wallet_manager::set_signing_threads(uint32_t threads) {
+    signing_pool.reset();
+    if(threads > 0) {
+        signing_pool.emplace(threads);
+    }
+}
+
 chain::signature_type
 wallet_manager::sign_digest(const chain::digest_type& digest, const public_key_type& key) {
     check_timeout();
@@ -38,6 +38,7 @@ wallet_plugin::set_program_options(options_description& cli, options_description
             "Activity is defined as any wallet command e.g. list-wallets.")
         ("yubihsm-url", bpo::value<string>()->value_name("URL"), "Override default URL of http://localhost:12345 for connecting to yubihsm-connector")
         ("yubihsm-authkey", bpo::value<uint16_t>()->value_name("key_num"), "Enables YubiHSM support using given Authkey")
+        ("signing-threads", bpo::value<uint32_t>()->default_value(2), "Number of threads used to sign batches of transactions, 0 signs them on the main thread")
         ;
 }
 
@@ -65,6 +66,9 @@ wallet_plugin::plugin_initialize(const variables_map& options) {
             std::chrono::seconds t(timeout);
             wallet_manager_ptr->set_timeout(t);
         }
+        if(options.count("signing-threads")) {
+            wallet_manager_ptr->set_signing_threads(options.at("signing-threads").as<uint32_t>());
+        }
         if(options.count("yubihsm-authkey")) {
             uint16_t key                = options.at("yubihsm-authkey").as<uint16_t>();
             string   connector_endpoint = "http://localhost:12345";
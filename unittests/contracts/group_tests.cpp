@@ -1,5 +1,25 @@
 #include "contracts_tests.hpp"
 
+#include <random>
+#include <jmzk/chain/authority_checker.hpp>
+
+namespace jmzk { namespace chain {
+
+// reaches the compiled and the node by node checks of groups
+struct authority_checker_test {
+    static bool
+    satisfied_compiled(authority_checker& checker, const group& group) {
+        return checker.satisfied_compiled(*group.compiled());
+    }
+
+    static bool
+    satisfied_node(authority_checker& checker, const group& group) {
+        return checker.satisfied_node(group, group.root(), 0);
+    }
+};
+
+}}  // namespace jmzk::chain
+
 auto CHECK_EQUAL = [](auto& lhs, auto& rhs) {
     auto b1 = fc::raw::pack(lhs);
     auto b2 = fc::raw::pack(rhs);
@@ -291,3 +311,145 @@ TEST_CASE_METHOD(contracts_test, "group_auth_test", "[contracts]") {
 
     my_tester->produce_blocks();
 }
+
+TEST_CASE("compiled_group_test", "[contracts]") {
+    const char* test_data = R"=====(
+    {
+      "name": "5jxXg",
+      "key": "jmzk6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV",
+      "root": {
+        "threshold": 6,
+        "nodes": [{
+            "threshold": 2,
+            "weight": 6,
+            "nodes": [{
+                "key": "jmzk6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV",
+                "weight": 1
+              },{
+                "key": "jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX",
+                "weight": 1
+              }
+            ]
+          },{
+            "key": "jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX",
+            "weight": 3
+          }
+        ]
+      }
+    }
+    )=====";
+
+    auto gp = fc::json::from_string(test_data).as<group_def>();
+    auto cg = gp.compiled();
+    REQUIRE(cg != nullptr);
+
+    // pre-order with the end of each subtree
+    REQUIRE(cg->entries.size() == 5);
+    CHECK(cg->entries[0].threshold == 6);
+    CHECK(cg->entries[0].end == 5);
+    CHECK(cg->entries[1].threshold == 2);
+    CHECK(cg->entries[1].depth == 1);
+    CHECK(cg->entries[1].end == 4);
+    CHECK(cg->entries[2].end == 3);
+    CHECK(cg->entries[4].weight == 3);
+
+    // keys are deduplicated
+    CHECK(cg->keys.size() == 2);
+    CHECK(cg->entries[3].key == cg->entries[4].key);
+    CHECK(cg->entries[2].key != cg->entries[3].key);
+
+    CHECK(gp.compiled() == cg);
+
+    // assigned group compiles again
+    auto gp2 = gp;
+    gp2.nodes_[2].weight = 4;
+    gp = gp2;
+    auto cg2 = gp.compiled();
+    REQUIRE(cg2 != nullptr);
+    CHECK(cg2 != cg);
+    CHECK(cg2->entries[4].weight == 4);
+
+    // malformed groups are not compiled
+    auto gp3 = gp;
+    gp3.nodes_[0].size = 10;
+    CHECK(gp3.compiled() == nullptr);
+}
+
+TEST_CASE_METHOD(contracts_test, "compiled_group_random_test", "[contracts]") {
+    auto& exec_ctx = static_cast<const jmzk_execution_context&>(my_tester->control->get_execution_context());
+
+    auto rng  = std::mt19937(20190731);
+    auto rnd = [&](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(rng); };
+
+    auto keys = std::vector<public_key_type>();
+    for(auto n : { N(gkeya), N(gkeyb), N(gkeyc), N(gkeyd), N(gkeye), N(gkeyf) }) {
+        keys.emplace_back(tester::get_public_key(n));
+    }
+
+    // random tree of up to 4 levels, keys are shared among the leaves
+    std::function<fc::mutable_variant_object(int)> make_node = [&](int depth) {
+        auto node = fc::mutable_variant_object();
+        node["weight"] = rnd(1, 3);
+        if(depth > 0 && (depth == 3 || rnd(0, 2) == 0)) {
+            node["key"] = keys[rnd(0, keys.size() - 1)];
+            return node;
+        }
+
+        auto nodes = fc::variants();
+        auto total = 0;
+        for(auto i = rnd(1, 4); i > 0; i--) {
+            auto n = make_node(depth + 1);
+            total += n["weight"].as_int64();
+            nodes.emplace_back(std::move(n));
+        }
+        node["threshold"] = rnd(1, total + 1);  // unreachable threshold sometimes
+        node["nodes"]     = std::move(nodes);
+        return node;
+    };
+
+    auto satisfied = 0;
+    for(auto round = 0; round < 500; round++) {
+        auto gv = fc::mutable_variant_object();
+        gv["name"] = "random";
+        gv["key"]  = keys[0];
+        auto root  = make_node(0);
+        root["weight"] = 0;
+        gv["root"] = std::move(root);
+
+        auto gp = fc::variant(gv).as<group_def>();
+        REQUIRE(gp.compiled() != nullptr);
+
+        auto signing_keys = public_keys_set();
+        for(auto& k : keys) {
+            if(rnd(0, 1)) {
+                signing_keys.insert(k);
+            }
+        }
+        // depth limit cuts the deeper groups sometimes
+        auto max_depth = (uint32_t)rnd(1, 4);
+
+        auto c1 = authority_checker(*my_tester->control, exec_ctx, signing_keys, max_depth);
+        auto c2 = authority_checker(*my_tester->control, exec_ctx, signing_keys, max_depth);
+
+        auto r1 = std::optional<bool>();
+        auto r2 = std::optional<bool>();
+        try {
+            r1 = authority_checker_test::satisfied_compiled(c1, gp);
+        }
+        catch(const fc::assert_exception&) {}
+        try {
+            r2 = authority_checker_test::satisfied_node(c2, gp);
+        }
+        catch(const fc::assert_exception&) {}
+
+        INFO("round: " << round);
+        REQUIRE(r1 == r2);
+        if(r1.has_value()) {
+            CHECK(c1.used_keys() == c2.used_keys());
+            satisfied += *r1;
+        }
+    }
+    // both outcomes are covered
+    CHECK(satisfied > 0);
+    CHECK(satisfied < 500);
+}
@@ -1,6 +1,9 @@
+#include <random>
 #include <catch/catch.hpp>
 
+#include <fc/crypto/base58.hpp>
 #include <fc/crypto/public_key.hpp>
+#include <fc/crypto/sha256.hpp>
 #include <fc/crypto/private_key.hpp>
 
 using namespace fc::crypto;
@@ -17,3 +20,113 @@ TEST_CASE("test_ecdh", "[ecdh]") {
 
     CHECK(shared1 == shared2);
 }
+
+TEST_CASE("test_sha256_hash_many", "[sha256]") {
+    using impl_type = fc::sha256::batch_impl;
+
+    // fixed seed so a failure can be reproduced
+    auto dre = std::mt19937(20190801);
+
+    // covers the lengths around the block boundaries and counts around the lanes of a batch
+    for(auto n : { 0, 1, 7, 8, 9, 17, 64, 100 }) {
+        auto msgs = std::vector<std::string>(n);
+        auto ptrs = std::vector<const char*>(n);
+        auto lens = std::vector<uint32_t>(n);
+        for(auto i = 0; i < n; i++) {
+            auto len = std::uniform_int_distribution<int>(0, 200)(dre);
+            if(i % 3 == 0) {
+                len = std::vector<int>{ 0, 55, 56, 63, 64, 119, 120, 128 }[i % 8];
+            }
+            msgs[i].resize(len);
+            for(auto& c : msgs[i]) {
+                c = (char)std::uniform_int_distribution<int>(0, 255)(dre);
+            }
+            ptrs[i] = msgs[i].data();
+            lens[i] = len;
+        }
+
+        auto expected = std::vector<fc::sha256>(n);
+        for(auto i = 0; i < n; i++) {
+            expected[i] = fc::sha256::hash(ptrs[i], lens[i]);
+        }
+
+        // every implementation the cpu supports is checked against the scalar one, not only the dispatched one
+        for(auto impl : { impl_type::scalar, impl_type::shani, impl_type::avx2 }) {
+            if(!fc::sha256::batch_impl_supported(impl)) {
+                WARN("SHA-256 batch implementation " << (int)impl << " is not supported, skipped");
+                continue;
+            }
+            INFO("implementation: " << (int)impl << ", messages: " << n);
+
+            auto out = std::vector<fc::sha256>(n);
+            fc::sha256::hash_many(impl, ptrs.data(), lens.data(), n, out.data());
+            for(auto i = 0; i < n; i++) {
+                CHECK(out[i] == expected[i]);
+            }
+        }
+
+        auto out = std::vector<fc::sha256>(n);
+        fc::sha256::hash_many(ptrs.data(), lens.data(), n, out.data());
+        CHECK(out == expected);
+
+        auto buf = std::string(n * 64, '\0');
+        for(auto& c : buf) {
+            c = (char)std::uniform_int_distribution<int>(0, 255)(dre);
+        }
+        fc::sha256::hash_many(buf.data(), 64, n, out.data());
+        for(auto i = 0; i < n; i++) {
+            CHECK(out[i] == fc::sha256::hash(buf.data() + i * 64, 64));
+        }
+    }
+}
+
+TEST_CASE("test_base58", "[base58]") {
+    auto enc = [](const std::string& s) { return fc::to_base58(s.data(), s.size()); };
+
+    CHECK(enc("hello world") == "StV1DL6CwTryKyV");
+    CHECK(enc(std::string("\0\0\x01\x02", 4)) == "115T");
+    CHECK(enc(std::string(3, '\0')) == "111");
+
+    auto bytes = std::string();
+    for(auto i = 0; i < 37; i++) {
+        bytes.push_back((char)i);
+    }
+    CHECK(enc(bytes) == "1SkB92YpWm4Q2ijQHH34cqbKkCZWszsiQgHVjtNeFF2Dnmkp3");
+
+    auto dec = fc::from_base58("1SkB92YpWm4Q2ijQHH34cqbKkCZWszsiQgHVjtNeFF2Dnmkp3");
+    CHECK(std::string(dec.data(), dec.size()) == bytes);
+    CHECK(fc::from_base58(" StV1DL6CwTryKyV ").size() == 11);
+    CHECK(fc::from_base58("111").size() == 3);
+    CHECK_THROWS_AS(fc::from_base58("StV1DL0CwTryKyV"), fc::parse_error_exception);
+
+    // fixed seed so a failure can be reproduced
+    auto dre = std::mt19937(20190802);
+    for(auto i = 0; i < 1000; i++) {
+        auto s = std::string(std::uniform_int_distribution<int>(0, 80)(dre), '\0');
+        auto z = std::uniform_int_distribution<int>(0, 3)(dre);
+        for(auto j = z; j < (int)s.size(); j++) {
+            s[j] = (char)std::uniform_int_distribution<int>(0, 255)(dre);
+        }
+        auto r = fc::from_base58(enc(s));
+        CHECK(std::string(r.data(), r.size()) == s);
+    }
+}
+
+TEST_CASE("test_public_key_string_cache", "[base58]") {
+    auto keys = std::vector<public_key>();
+    auto strs = std::vector<std::string>();
+    for(auto i = 0; i < 20; i++) {
+        keys.emplace_back(private_key::generate().get_public_key());
+        strs.emplace_back((std::string)keys.back());
+    }
+
+    // cache holds less keys than rendered, strings should be same with and without it
+    public_key::set_string_cache_capacity(16);
+    for(auto round = 0; round < 3; round++) {
+        for(auto i = 0u; i < keys.size(); i++) {
+            CHECK((std::string)keys[i] == strs[i]);
+            CHECK(public_key(strs[i]) == keys[i]);
+        }
+    }
+    public_key::set_string_cache_capacity(0);
+}
@@ -0,0 +1,162 @@
+#include <fstream>
+
+#include <catch/catch.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/io/raw.hpp>
+
+#include <jmzk/chain/config.hpp>
+#include <jmzk/chain/exceptions.hpp>
+#include <jmzk/chain/fork_database.hpp>
+
+using namespace jmzk;
+using namespace chain;
+
+extern std::string jmzk_unittests_dir;
+
+namespace {
+
+auto forkdb_key = private_key_type::regenerate<fc::ecc::private_key_shim>(fc::sha256::hash(std::string("forkdb")));
+
+fc::path
+fresh_forkdb_dir(const std::string& name) {
+    auto dir = fc::path(jmzk_unittests_dir) / "forkdb_tests" / name;
+    if(fc::exists(dir)) {
+        fc::remove_all(dir);
+    }
+    fc::create_directories(dir);
+    return dir;
+}
+
+block_state_ptr
+make_genesis() {
+    auto schedule = producer_schedule_type{0, {{config::system_account_name, forkdb_key.get_public_key()}}};
+
+    auto genheader                  = block_header_state();
+    genheader.active_schedule       = schedule;
+    genheader.pending_schedule      = schedule;
+    genheader.pending_schedule_hash = fc::sha256::hash(schedule);
+    genheader.header.timestamp      = fc::time_point::now();
+    genheader.id                    = genheader.header.id();
+    genheader.block_num             = genheader.header.block_num();
+    genheader.block_signing_key     = forkdb_key.get_public_key();
+
+    auto s   = std::make_shared<block_state>(genheader);
+    s->block = std::make_shared<signed_block>(genheader.header);
+    return s;
+}
+
+block_state_ptr
+make_next(const block_state_ptr& prev) {
+    auto s = std::make_shared<block_state>(*prev, block_timestamp_type());
+    s->compute_digests();
+    s->sign([](auto& d) { return forkdb_key.sign(d); });
+    s->block->set_header(s->header);
+    return s;
+}
+
+// builds a chain of `n` blocks after genesis and leaves the files as a crash would
+block_id_type
+build_and_crash(const fc::path& dir, const fc::path& crash_dir, int n) {
+    auto forkdb = fork_database(dir);
+
+    auto s = make_genesis();
+    forkdb.set(s);
+    forkdb.set_validity(s, true);
+    forkdb.mark_in_current_chain(s, true);
+
+    for(auto i = 0; i < n; i++) {
+        s = make_next(s);
+        forkdb.add(s, false);
+        forkdb.mark_in_current_chain(s, true);
+        forkdb.set_validity(s, true);
+    }
+
+    fc::create_directories(crash_dir);
+    for(auto f : { config::forkdb_filename, config::forkdb_log_filename }) {
+        if(fc::exists(dir / f)) {
+            fc::copy(dir / f, crash_dir / f);
+        }
+    }
+    return s->id;
+}
+
+}  // namespace
+
+TEST_CASE("forkdb_replay_test", "[forkdb]") {
+    auto dir   = fresh_forkdb_dir("replay");
+    auto crash = dir / "crash";
+    auto head  = build_and_crash(dir / "db", crash, 10);
+
+    auto forkdb = fork_database(crash);
+    REQUIRE(forkdb.head() != nullptr);
+    CHECK(forkdb.head()->id == head);
+    CHECK(forkdb.head()->block_num == block_header::num_from_id(head));
+    CHECK(forkdb.head()->validated);
+    CHECK(forkdb.head()->in_current_chain);
+
+    // keeps going after replay
+    auto next = make_next(forkdb.head());
+    forkdb.add(next, false);
+    CHECK(forkdb.head()->id == next->id);
+}
+
+TEST_CASE("forkdb_torn_tail_test", "[forkdb]") {
+    auto dir   = fresh_forkdb_dir("torn");
+    auto crash = dir / "crash";
+    auto head  = build_and_crash(dir / "db", crash, 5);
+
+    auto log  = crash / config::forkdb_log_filename;
+    auto size = fc::file_size(log);
+    {
+        // record header claims more bytes than written
+        auto fs = std::ofstream(log.generic_string(), std::ios::out | std::ios::binary | std::ios::app);
+        fs << std::string("\x00\x01\x00\x00" "checksum" "torn", 16);
+    }
+    CHECK(fc::file_size(log) == size + 16);
+
+    auto forkdb = fork_database(crash);
+    REQUIRE(forkdb.head() != nullptr);
+    CHECK(forkdb.head()->id == head);
+    CHECK(fc::file_size(log) == size);
+}
+
+TEST_CASE("forkdb_legacy_test", "[forkdb]") {
+    auto dir = fresh_forkdb_dir("legacy");
+
+    auto g  = make_genesis();
+    auto b1 = make_next(g);
+    auto b2 = make_next(b1);
+    {
+        // layout written by the versions without log: count, block states, head id
+        auto fs = std::ofstream((dir / config::forkdb_filename).generic_string(), std::ios::out | std::ios::binary);
+        fc::raw::pack(fs, unsigned_int(3));
+        fc::raw::pack(fs, *g);
+        fc::raw::pack(fs, *b1);
+        fc::raw::pack(fs, *b2);
+        fc::raw::pack(fs, b2->id);
+    }
+    {
+        auto forkdb = fork_database(dir);
+        REQUIRE(forkdb.head() != nullptr);
+        CHECK(forkdb.head()->id == b2->id);
+        CHECK(forkdb.get_block(b1->id) != nullptr);
+    }
+
+    // rewritten in the new layout on close
+    auto forkdb = fork_database(dir);
+    REQUIRE(forkdb.head() != nullptr);
+    CHECK(forkdb.head()->id == b2->id);
+}
+
+TEST_CASE("forkdb_empty_close_test", "[forkdb]") {
+    auto dir = fresh_forkdb_dir("empty");
+    {
+        auto forkdb = fork_database(dir);
+        CHECK(fc::exists(dir / config::forkdb_log_filename));
+    }
+    CHECK(!fc::exists(dir / config::forkdb_filename));
+    CHECK(!fc::exists(dir / config::forkdb_log_filename));
+
+    auto forkdb = fork_database(dir);
+    CHECK(!forkdb.head());
+}
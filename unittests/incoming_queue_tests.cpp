@@ -0,0 +1,150 @@
+#include <catch/catch.hpp>
+
+#include <jmzk/producer_plugin/incoming_transaction_queue.hpp>
+
+using namespace jmzk;
+using namespace chain;
+
+namespace {
+
+auto payer_a = address(public_key_type(std::string("jmzk6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV")));
+auto payer_b = address(public_key_type(std::string("jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX")));
+
+auto trx_nonce = uint16_t(0);
+
+transaction_metadata_ptr
+make_trx(const address& payer, uint32_t max_charge) {
+    auto trx = signed_transaction();
+    trx.expiration    = fc::time_point_sec(fc::time_point::now()) + 60;
+    trx.ref_block_num = trx_nonce++;  // makes the ids unique
+    trx.max_charge    = max_charge;
+    trx.payer         = payer;
+    return std::make_shared<transaction_metadata>(trx);
+}
+
+uint32_t
+trx_size(const transaction_metadata_ptr& trx) {
+    return trx->packed_trx->get_unprunable_size() + trx->packed_trx->get_prunable_size();
+}
+
+auto no_next = [](const auto&) {};
+
+}  // namespace
+
+TEST_CASE("incoming_queue_order_test", "[incoming_queue]") {
+    auto queue = incoming_transaction_queue();
+
+    auto t1 = make_trx(payer_a, 100);
+    auto t2 = make_trx(payer_a, 300);
+    auto t3 = make_trx(payer_a, 200);
+    auto t4 = make_trx(payer_a, 200);
+    for(auto& t : { t1, t2, t3, t4 }) {
+        CHECK(queue.push(t, false, no_next) == incoming_transaction_queue::push_result::queued);
+    }
+    CHECK(queue.size() == 4);
+
+    // higher charge first, then arrival
+    CHECK(queue.pop()->trx == t2);
+    CHECK(queue.pop()->trx == t3);
+
+    // requeued transaction goes in front of the newer ones of the same charge
+    CHECK(queue.push(t3, false, no_next, true /* requeue */) == incoming_transaction_queue::push_result::queued);
+    CHECK(queue.pop()->trx == t3);
+    CHECK(queue.pop()->trx == t4);
+    CHECK(queue.pop()->trx == t1);
+
+    CHECK(queue.empty());
+    CHECK(!queue.pop().has_value());
+}
+
+TEST_CASE("incoming_queue_fairness_test", "[incoming_queue]") {
+    auto size = trx_size(make_trx(payer_a, 100));
+
+    // one transaction per turn
+    auto conf    = incoming_transaction_queue::config();
+    conf.quantum = size;
+
+    auto queue = incoming_transaction_queue();
+    queue.set_config(std::move(conf));
+
+    // payer a floods the queue before payer b and pays more
+    for(auto i = 0; i < 10; i++) {
+        queue.push(make_trx(payer_a, 1000), false, no_next);
+    }
+    auto b1 = make_trx(payer_b, 100);
+    auto b2 = make_trx(payer_b, 100);
+    queue.push(b1, false, no_next);
+    queue.push(b2, false, no_next);
+    CHECK(queue.get_stats().payers == 2);
+
+    auto order = std::vector<address>();
+    while(auto e = queue.pop()) {
+        order.emplace_back(e->trx->packed_trx->get_transaction().payer);
+    }
+    REQUIRE(order.size() == 12);
+    CHECK(order[0] == payer_a);
+    CHECK(order[1] == payer_b);
+    CHECK(order[2] == payer_a);
+    CHECK(order[3] == payer_b);
+    CHECK(std::all_of(order.begin() + 4, order.end(), [](auto& p) { return p == payer_a; }));
+
+    // payer with weight 2 takes two transactions per turn
+    conf                = incoming_transaction_queue::config();
+    conf.quantum        = size;
+    conf.payer_weights  = { { incoming_transaction_queue::payer_key(payer_a), 2 } };
+    queue.set_config(std::move(conf));
+
+    for(auto i = 0; i < 4; i++) {
+        queue.push(make_trx(payer_a, 100), false, no_next);
+        queue.push(make_trx(payer_b, 100), false, no_next);
+    }
+    order.clear();
+    while(auto e = queue.pop()) {
+        order.emplace_back(e->trx->packed_trx->get_transaction().payer);
+    }
+    REQUIRE(order.size() == 8);
+    CHECK(order[0] == payer_a);
+    CHECK(order[1] == payer_a);
+    CHECK(order[2] == payer_b);
+    CHECK(order[3] == payer_a);
+    CHECK(order[4] == payer_a);
+    CHECK(order[5] == payer_b);
+}
+
+TEST_CASE("incoming_queue_capacity_test", "[incoming_queue]") {
+    auto size = trx_size(make_trx(payer_a, 100));
+
+    auto conf               = incoming_transaction_queue::config();
+    conf.max_bytes          = size * 3;
+    conf.max_trxs_per_payer = 2;
+
+    auto queue = incoming_transaction_queue();
+    queue.set_config(std::move(conf));
+
+    auto a1 = make_trx(payer_a, 100);
+    CHECK(queue.push(a1, false, no_next) == incoming_transaction_queue::push_result::queued);
+    CHECK(queue.push(a1, false, no_next) == incoming_transaction_queue::push_result::duplicated);
+    CHECK(queue.push(make_trx(payer_a, 100), false, no_next) == incoming_transaction_queue::push_result::queued);
+
+    // payer a is over its limit while the queue still has room
+    CHECK(queue.push(make_trx(payer_a, 100), false, no_next) == incoming_transaction_queue::push_result::full);
+    CHECK(!queue.is_full());
+    CHECK(queue.push(make_trx(payer_b, 100), false, no_next) == incoming_transaction_queue::push_result::queued);
+
+    // over the byte budget
+    CHECK(queue.is_full());
+    CHECK(queue.push(make_trx(payer_b, 100), false, no_next) == incoming_transaction_queue::push_result::full);
+
+    // requeued transactions were admitted already
+    auto e = queue.pop();
+    REQUIRE(e.has_value());
+    CHECK(!queue.is_full());
+    CHECK(queue.push(make_trx(payer_b, 100), false, no_next) == incoming_transaction_queue::push_result::queued);
+    CHECK(queue.push(e->trx, false, no_next, true /* requeue */) == incoming_transaction_queue::push_result::queued);
+    CHECK(queue.size() == 4);
+
+    auto stats = queue.get_stats();
+    CHECK(stats.bytes == size * 4);
+    CHECK(stats.rejected == 2);
+    CHECK(stats.duplicated == 1);
+}
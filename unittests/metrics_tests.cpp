@@ -0,0 +1,74 @@
+#include <catch/catch.hpp>
+
+#include <thread>
+#include <vector>
+#include <jmzk/utilities/metrics.hpp>
+
+using namespace jmzk::utilities::metrics;
+
+TEST_CASE("test_counter", "[metrics]") {
+    auto& c = registry::instance().get_counter("test_counter_total", "Test counter", {{"case", "threads"}});
+
+    auto threads = std::vector<std::thread>();
+    for(auto i = 0; i < 8; i++) {
+        threads.emplace_back([&c] {
+            for(auto j = 0; j < 1000; j++) {
+                c.inc();
+            }
+        });
+    }
+    for(auto& t : threads) {
+        t.join();
+    }
+    CHECK(c.value() == 8000);
+
+    auto& c2 = registry::instance().get_counter("test_counter_total", "Test counter", {{"case", "threads"}});
+    CHECK(&c == &c2);
+
+    CHECK_THROWS(registry::instance().get_gauge("test_counter_total", "Test counter"));
+}
+
+TEST_CASE("test_histogram", "[metrics]") {
+    auto& h = registry::instance().get_histogram("test_histogram_us", "Test histogram", {}, {10, 100});
+    h.observe(5);
+    h.observe(10);
+    h.observe(50);
+    h.observe(500);
+
+    auto s = h.get_snapshot();
+    REQUIRE(s.buckets.size() == 3);
+    CHECK(s.buckets[0] == 2);
+    CHECK(s.buckets[1] == 3);
+    CHECK(s.buckets[2] == 4);
+    CHECK(s.count == 4);
+    CHECK(s.sum == 565);
+
+    auto text = registry::instance().exposition();
+    CHECK(text.find("# TYPE test_histogram_us histogram") != std::string::npos);
+    CHECK(text.find("test_histogram_us_bucket{le=\"10\"} 2") != std::string::npos);
+    CHECK(text.find("test_histogram_us_bucket{le=\"+Inf\"} 4") != std::string::npos);
+    CHECK(text.find("test_histogram_us_count 4") != std::string::npos);
+}
+
+TEST_CASE("test_release", "[metrics]") {
+    auto& r      = registry::instance();
+    auto  labels = labels_type {{"peer", "a"}};
+
+    auto c1 = r.share_counter("test_release_total", "Test release", labels);
+    auto c2 = r.share_counter("test_release_total", "Test release", labels);
+    CHECK(c1 == c2);
+    c1->inc();
+
+    // still held by c2
+    c1.reset();
+    CHECK(!r.release("test_release_total", labels));
+    CHECK(r.exposition().find("test_release_total{peer=\"a\"} 1") != std::string::npos);
+
+    c2.reset();
+    CHECK(r.release("test_release_total", labels));
+    CHECK(r.exposition().find("test_release_total{peer=\"a\"}") == std::string::npos);
+    CHECK(!r.release("test_release_total", labels));
+
+    // created again from zero
+    CHECK(r.share_counter("test_release_total", "Test release", labels)->value() == 0);
+}
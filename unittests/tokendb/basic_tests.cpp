@@ -1,5 +1,7 @@
 #include "tokendb_tests.hpp"
 
+#include <rocksdb/db.h>
+
 const char* domain_data = R"=====(
     {
       "name" : "domain",
@@ -235,3 +237,182 @@ TEST_CASE_METHOD(tokendb_test, "put_tokens_test", "[tokendb]") {
     CHECK(EXISTS_TOKEN2(token, "dm-tkdb-test", "basic-1"));
     CHECK(EXISTS_TOKEN2(token, "dm-tkdb-test", "basic-2"));
 }
+
+TEST_CASE("column_families_test", "[tokendb]") {
+    auto cfg = standalone_tokendb_config("tokendb_cf");
+
+    // covers every compression, compaction and a family without block cache or bloom filter
+    cfg.meta_column    = { 10, 0,  db_compression::zstd, db_compaction::level     };
+    cfg.tokens_column  = { 50, 10, db_compression::none, db_compaction::universal };
+    cfg.history_column = { 0,  10, db_compression::lz4,  db_compaction::level     };
+
+    auto addr = public_key_type(std::string("jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX"));
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+
+        tokendb.put_token(token_type::domain, action_op::add, std::nullopt, "dm-cf", "domain");
+        tokendb.put_token(token_type::token, action_op::add, name128("dm-cf"), "t1", "token");
+        tokendb.put_token(token_type::jmzklink, action_op::add, std::nullopt, name128::from_number(1), "link");
+        tokendb.put_asset(addr, 3, "asset");
+    }
+
+    auto tokendb = token_database(cfg);
+    tokendb.open();
+
+    auto str = std::string();
+    CHECK(tokendb.read_token(token_type::domain, std::nullopt, "dm-cf", str));
+    CHECK(str == "domain");
+    CHECK(tokendb.read_token(token_type::token, name128("dm-cf"), "t1", str));
+    CHECK(str == "token");
+    CHECK(tokendb.read_token(token_type::jmzklink, std::nullopt, name128::from_number(1), str));
+    CHECK(str == "link");
+    CHECK(tokendb.read_asset(addr, 3, str));
+    CHECK(str == "asset");
+
+    auto count = tokendb.read_tokens_range(token_type::token, name128("dm-cf"), 0, [](auto&, auto&&) { return true; });
+    CHECK(count == 1);
+}
+
+TEST_CASE("legacy_columns_test", "[tokendb]") {
+    using namespace rocksdb;
+
+    auto cfg  = standalone_tokendb_config("tokendb_legacy");
+    auto addr = public_key_type(std::string("jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX"));
+
+    auto token_key = [](const name128& prefix, const name128& key) {
+        auto k = std::string(sizeof(name128) * 2, '\0');
+        memcpy(k.data(), &prefix, sizeof(name128));
+        memcpy(k.data() + sizeof(name128), &key, sizeof(name128));
+        return k;
+    };
+    auto domain_key = token_key(N128(.domain), "dm-legacy");
+    auto tk_key     = token_key("dm-legacy", "t1");
+    auto link_key   = token_key(N128(.jmzklink), name128::from_number(1));
+
+    // symbol id followed by the address
+    auto sym_id    = symbol_id_type(3);
+    auto asset_key = std::string(sizeof(sym_id) + sizeof(fc::ecc::public_key_shim), '\0');
+    memcpy(asset_key.data(), &sym_id, sizeof(sym_id));
+    address(addr).to_bytes(asset_key.data() + sizeof(sym_id), sizeof(fc::ecc::public_key_shim));
+
+    auto open_db = [&](auto& names, auto& handles, bool read_only) {
+        auto options = Options();
+        options.create_if_missing              = true;
+        options.create_missing_column_families = true;
+
+        auto columns = std::vector<ColumnFamilyDescriptor>();
+        for(auto& n : names) {
+            columns.emplace_back(n, ColumnFamilyOptions());
+        }
+        auto db     = (DB*)nullptr;
+        auto status = read_only ? DB::OpenForReadOnly(options, cfg.db_path.to_native_ansi_path(), columns, &handles, &db)
+                                : DB::Open(options, cfg.db_path.to_native_ansi_path(), columns, &handles, &db);
+        REQUIRE(status.ok());
+        return db;
+    };
+    auto close_db = [](auto db, auto& handles) {
+        for(auto h : handles) {
+            db->DestroyColumnFamilyHandle(h);
+        }
+        delete db;
+    };
+
+    // layout before the split: all but the assets are in the default column family
+    {
+        auto names   = std::vector<std::string>{ kDefaultColumnFamilyName, "Assets" };
+        auto handles = std::vector<ColumnFamilyHandle*>();
+        auto db      = open_db(names, handles, false);
+
+        CHECK(db->Put(WriteOptions(), handles[0], domain_key, "domain").ok());
+        CHECK(db->Put(WriteOptions(), handles[0], tk_key, "token").ok());
+        CHECK(db->Put(WriteOptions(), handles[0], link_key, "link").ok());
+        CHECK(db->Put(WriteOptions(), handles[1], asset_key, "asset").ok());
+        close_db(db, handles);
+    }
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+
+        auto str = std::string();
+        CHECK(tokendb.read_token(token_type::domain, std::nullopt, "dm-legacy", str));
+        CHECK(str == "domain");
+        CHECK(tokendb.read_token(token_type::token, name128("dm-legacy"), "t1", str));
+        CHECK(str == "token");
+        CHECK(tokendb.read_token(token_type::jmzklink, std::nullopt, name128::from_number(1), str));
+        CHECK(str == "link");
+        CHECK(tokendb.read_asset(addr, sym_id, str));
+        CHECK(str == "asset");
+
+        auto count = tokendb.read_tokens_range(token_type::token, name128("dm-legacy"), 0, [](auto&, auto&&) { return true; });
+        CHECK(count == 1);
+    }
+
+    // keys are moved out of the default column family, metadata stays
+    auto names   = std::vector<std::string>{ kDefaultColumnFamilyName, "Tokens", "History", "Assets" };
+    auto handles = std::vector<ColumnFamilyHandle*>();
+    auto db      = open_db(names, handles, true);
+
+    auto get = [&](int cf, const auto& key) {
+        auto value = std::string();
+        auto s     = db->Get(ReadOptions(), handles[cf], key, &value);
+        return s.ok() ? value : std::string("<none>");
+    };
+    CHECK(get(0, domain_key) == "domain");
+    CHECK(get(0, tk_key) == "<none>");
+    CHECK(get(0, link_key) == "<none>");
+    CHECK(get(0, token_key(N128(.tokendb), N128(.migrating))) == "<none>");
+    CHECK(get(1, tk_key) == "token");
+    CHECK(get(1, domain_key) == "<none>");
+    CHECK(get(2, link_key) == "link");
+    CHECK(get(3, asset_key) == "asset");
+
+    close_db(db, handles);
+}
+
+TEST_CASE_METHOD(tokendb_test, "read_view_test", "[tokendb]") {
+    auto& tokendb = my_tester->control->token_db();
+
+    auto addr = tester::get_public_key(N(viewkey));
+    auto dom  = domain_def();
+    dom.name    = "dm-view";
+    dom.creator = addr;
+
+    auto dv = make_db_value(dom);
+    tokendb.put_token(token_type::domain, action_op::add, std::nullopt, dom.name, dv.as_string_view());
+    tokendb.put_asset(addr, 3, "asset-db");
+
+    auto view = std::string();
+    auto read = [&](auto& v) { view = std::string(v); };
+
+    CHECK(tokendb.read_token_view(token_type::domain, std::nullopt, dom.name, read));
+    CHECK(view == dv.as_string_view());
+
+    // decodes from the view in place
+    auto dom2 = domain_def();
+    tokendb.read_token_view(token_type::domain, std::nullopt, dom.name, [&](auto& v) { extract_db_value(v, dom2); });
+    CHECK(dom2.name == dom.name);
+    CHECK(dom2.creator == dom.creator);
+
+    view.clear();
+    CHECK(!tokendb.read_token_view(token_type::domain, std::nullopt, "dm-none", read, true /* no throw */));
+    CHECK(view.empty());
+    CHECK_THROWS_AS(tokendb.read_token_view(token_type::domain, std::nullopt, "dm-none", read), unknown_token_database_key);
+
+    CHECK(tokendb.read_asset_view(addr, 3, read));
+    CHECK(view == "asset-db");
+
+    // values in the write cache of assets are read in the same way
+    ADD_SAVEPOINT();
+    tokendb.put_asset(addr, 3, "asset-cache");
+    CHECK(tokendb.read_asset_view(addr, 3, read));
+    CHECK(view == "asset-cache");
+
+    view.clear();
+    CHECK(!tokendb.read_asset_view(addr, 4, read, true /* no throw */));
+    CHECK(view.empty());
+
+    ROLLBACK();
+    CHECK(tokendb.read_asset_view(addr, 3, read));
+    CHECK(view == "asset-db");
+}
@@ -1,4 +1,5 @@
 #include "tokendb_tests.hpp"
+#include <thread>
 #include <jmzk/chain/token_database_cache.hpp>
 
 TEST_CASE_METHOD(tokendb_test, "cache_test", "[tokendb]") {
@@ -87,4 +88,83 @@ TEST_CASE_METHOD(tokendb_test, "cache_test", "[tokendb]") {
         CHECK(cache.lookup_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-cache-2") == nullptr);
         CHECK_THROWS_AS(cache.read_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-cache-2") == nullptr, unknown_token_database_key);
     }
+
+    SECTION("batch_read_test") {
+        auto s = tokendb.new_savepoint_session();
+
+        auto tk  = token_def();
+        tk.domain = "dm-tkdb-test";
+        tk.name   = "batch-1";
+        cache.put_token(token_type::token, action_op::put, tk.domain, tk.name, tk);
+        tk.name   = "batch-2";
+        tokendb.put_token(token_type::token, action_op::put, tk.domain, tk.name, make_db_value(tk).as_string_view());
+
+        auto keys = small_vector<name128, 4>();
+        keys.push_back("batch-1");  // in cache
+        keys.push_back("batch-2");  // only in db
+        keys.push_back("batch-3");  // not exists
+        keys.push_back("batch-2");  // duplicate
+
+        auto found = small_vector<size_t, 4>();
+        CHECK(tokendb.read_tokens(token_type::token, tk.domain, keys, [&](auto i, auto& v) { found.push_back(i); }) == 3);
+        CHECK(found.size() == 3);
+        CHECK(found[0] == 0);
+        CHECK(found[1] == 1);
+        CHECK(found[2] == 3);
+
+        auto ptrs = cache.read_tokens<token_def>(token_type::token, tk.domain, keys, true /* no throw */);
+        CHECK(ptrs.size() == 4);
+        CHECK(ptrs[0]->name == "batch-1");
+        CHECK(ptrs[1]->name == "batch-2");
+        CHECK(ptrs[2] == nullptr);
+        // duplicate keys share the same cached instance
+        CHECK(ptrs[3].get() == ptrs[1].get());
+
+        // the instance read in batch can be updated via cache
+        ptrs[1]->owner = { address() };
+        cache.put_token(token_type::token, action_op::update, tk.domain, "batch-2", *ptrs[1]);
+        CHECK(cache.lookup_token<token_def>(token_type::token, tk.domain, "batch-2") != nullptr);
+
+        CHECK_THROWS_AS(cache.read_tokens<token_def>(token_type::token, tk.domain, keys), unknown_token_database_key);
+
+        s.undo();
+    }
+
+    SECTION("prefetch_test") {
+        auto s = tokendb.new_savepoint_session();
+
+        auto var = fc::json::from_string(domain_data);
+        auto dom = var.as<domain_def>();
+        dom.name = "dm-tkdb-prefetch";
+
+        auto dv = make_db_value(dom);
+        tokendb.put_token(token_type::domain, action_op::add, std::nullopt, dom.name, dv.as_string_view());
+
+        // prefetched on other thread and merged into cache on next miss
+        std::thread([&] {
+            cache.prefetch_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch");
+            cache.prefetch_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch-none");
+        }).join();
+        CHECK(cache.lookup_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch") != nullptr);
+        CHECK(cache.lookup_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch-none") == nullptr);
+
+        {
+            auto s2 = tokendb.new_savepoint_session();
+
+            auto dom2 = cache.lookup_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch");
+            dom2->creator = public_key_type();
+            cache.put_token(token_type::domain, action_op::update, std::nullopt, "dm-tkdb-prefetch", *dom2);
+            dom2.reset();
+
+            // prefetched value is updated before merged, it's dropped
+            std::thread([&] {
+                cache.prefetch_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch");
+            }).join();
+            s2.undo();
+        }
+        CHECK(cache.lookup_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch") == nullptr);
+        CHECK(cache.read_token<domain_def>(token_type::domain, std::nullopt, "dm-tkdb-prefetch")->creator == dom.creator);
+
+        s.undo();
+    }
 }
@@ -1,5 +1,7 @@
 #include "tokendb_tests.hpp"
 
+#include <fstream>
+
 /*
  * Persist Tests: add token
  */
@@ -296,3 +298,274 @@ TEST_CASE_METHOD(tokendb_test, "squash_prst_rlbk", "[tokendb]") {
     CHECK(!EXISTS_TOKEN(domain, "domain-prst-sq"));
 }
 
+
+/*
+ * Persist Tests: savepoints journal
+ */
+TEST_CASE("journal_prst_test", "[tokendb]") {
+    auto cfg           = standalone_tokendb_config("tokendb_journal");
+    cfg.enable_journal = true;
+
+    auto addr = public_key_type(std::string("jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX"));
+    auto dm   = std::optional<name128>("dm-jnl");
+    auto nd   = std::optional<name128>();
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+
+        tokendb.put_token(token_type::domain, action_op::add, nd, "dm-jnl", "d0");
+
+        tokendb.add_savepoint(1);
+        tokendb.put_token(token_type::domain, action_op::update, nd, "dm-jnl", "d1");
+        tokendb.put_asset(addr, 3, "c1");
+
+        tokendb.add_savepoint(2);
+        tokendb.put_token(token_type::token, action_op::add, dm, "t1", "t1-2");
+        tokendb.put_asset(addr, 1, "a2");
+        tokendb.put_asset(addr, 2, "b2");
+
+        tokendb.add_savepoint(3);
+        tokendb.put_token(token_type::domain, action_op::update, nd, "dm-jnl", "d3");
+        tokendb.put_asset(addr, 1, "a3");
+        tokendb.squash();
+
+        tokendb.add_savepoint(4);
+        tokendb.put_asset(addr, 2, "b4");
+        tokendb.pop_back_savepoint();
+
+        tokendb.add_savepoint(5);
+        tokendb.put_token(token_type::token, action_op::put, dm, "t2", "t2-5");
+        tokendb.put_asset(addr, 1, "a5");
+
+        tokendb.add_savepoint(6);
+        tokendb.put_asset(addr, 1, "a6");
+        tokendb.rollback_to_latest_savepoint();
+
+        tokendb.pop_savepoints(2);
+        CHECK(tokendb.savepoints_size() == 2);
+
+        // crashes without persisting and leaves a torn record behind
+        tokendb.close(false);
+
+        auto fs = std::ofstream((cfg.db_path / config::token_database_journal_filename).to_native_ansi_path(),
+            std::ios::out | std::ios::binary | std::ios::app);
+        fs << std::string("\x20\x00\x00\x00torn", 8);
+    }
+    CHECK(!fc::exists(cfg.db_path / config::token_database_persisit_filename));
+
+    auto tokendb = token_database(cfg);
+    tokendb.open();
+
+    auto read = [&](auto type, auto& domain, auto key) {
+        auto str = std::string();
+        tokendb.read_token(type, domain, key, str, true /* no throw */);
+        return str;
+    };
+    auto read_asset = [&](auto sym_id) {
+        auto str = std::string();
+        tokendb.read_asset(addr, sym_id, str, true /* no throw */);
+        return str;
+    };
+
+    CHECK(tokendb.savepoints_size() == 2);
+    CHECK(tokendb.latest_savepoint_seq() == 5);
+    CHECK(read(token_type::domain, nd, "dm-jnl") == "d3");
+    CHECK(read(token_type::token, dm, "t1") == "t1-2");
+    CHECK(read(token_type::token, dm, "t2") == "t2-5");
+    CHECK(read_asset(1) == "a5");
+    CHECK(read_asset(2) == "b4");
+    CHECK(read_asset(3) == "c1");
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read(token_type::token, dm, "t2").empty());
+    CHECK(read_asset(1) == "a3");
+
+    // journal keeps going after replay
+    tokendb.add_savepoint(7);
+    tokendb.put_asset(addr, 1, "a7");
+    tokendb.close();
+
+    tokendb.open();
+    CHECK(tokendb.savepoints_size() == 2);
+    CHECK(read_asset(1) == "a7");
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read_asset(1) == "a3");
+
+    // values of savepoint 2 and 3 are rolled back together, asset of savepoint 1 is persisted already
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(tokendb.savepoints_size() == 0);
+    CHECK(read(token_type::domain, nd, "dm-jnl") == "d1");
+    CHECK(read(token_type::token, dm, "t1").empty());
+    CHECK(read_asset(1).empty());
+    CHECK(read_asset(3) == "c1");
+}
+
+TEST_CASE("journal_checkpoint_prst_test", "[tokendb]") {
+    auto cfg                 = standalone_tokendb_config("tokendb_journal_cp");
+    cfg.enable_journal       = true;
+    cfg.journal_compact_size = 1;  // checkpoints on every pop of savepoints
+
+    auto addr    = public_key_type(std::string("jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX"));
+    auto dm      = std::optional<name128>("dm-jnl-cp");
+    auto nd      = std::optional<name128>();
+    auto journal = cfg.db_path / config::token_database_journal_filename;
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+
+        tokendb.put_token(token_type::domain, action_op::add, nd, "dm-jnl-cp", "d0");
+
+        // records of savepoint 1 make up most of the journal before checkpoint
+        tokendb.add_savepoint(1);
+        for(auto i = 0; i < 64; i++) {
+            tokendb.put_token(token_type::token, action_op::add, dm, name128::from_number(i), "t-1");
+        }
+        tokendb.put_asset(addr, 1, "a1");
+
+        tokendb.add_savepoint(2);
+        tokendb.put_token(token_type::domain, action_op::update, nd, "dm-jnl-cp", "d2");
+        tokendb.put_asset(addr, 1, "a2");
+        tokendb.put_asset(addr, 2, "b2");
+
+        tokendb.add_savepoint(3);
+        tokendb.put_token(token_type::token, action_op::put, dm, name128::from_number(0), "t-3");
+        tokendb.put_asset(addr, 2, "b3");
+
+        tokendb.sync_savepoints();
+        auto size = fc::file_size(journal);
+
+        // checkpoints with live savepoints and ops in the write cache of assets
+        tokendb.pop_savepoints(2);
+        CHECK(tokendb.savepoints_size() == 2);
+        CHECK(fc::file_size(journal) < size);
+
+        tokendb.add_savepoint(4);
+        tokendb.put_asset(addr, 1, "a4");
+
+        tokendb.close(false);
+    }
+
+    auto tokendb = token_database(cfg);
+    tokendb.open();
+
+    auto read = [&](auto type, auto& domain, auto key) {
+        auto str = std::string();
+        tokendb.read_token(type, domain, key, str, true /* no throw */);
+        return str;
+    };
+    auto read_asset = [&](auto sym_id) {
+        auto str = std::string();
+        tokendb.read_asset(addr, sym_id, str, true /* no throw */);
+        return str;
+    };
+
+    CHECK(tokendb.savepoints_size() == 3);
+    CHECK(tokendb.latest_savepoint_seq() == 4);
+    CHECK(read(token_type::token, dm, name128::from_number(0)) == "t-3");
+    CHECK(read_asset(1) == "a4");
+    CHECK(read_asset(2) == "b3");
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read_asset(1) == "a2");
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read(token_type::token, dm, name128::from_number(0)) == "t-1");
+    CHECK(read_asset(2) == "b2");
+
+    // values of savepoint 1 are persisted by the pop
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(tokendb.savepoints_size() == 0);
+    CHECK(read(token_type::domain, nd, "dm-jnl-cp") == "d0");
+    CHECK(read(token_type::token, dm, name128::from_number(63)) == "t-1");
+    CHECK(read_asset(1) == "a1");
+    CHECK(read_asset(2).empty());
+}
+
+TEST_CASE("journal_switch_prst_test", "[tokendb]") {
+    auto cfg = standalone_tokendb_config("tokendb_journal_sw");
+
+    auto addr    = public_key_type(std::string("jmzk8MGU4aKiVzqMtWi9zLpu8KuTHZWjQQrX475ycSxEkLd6aBpraX"));
+    auto dm      = std::optional<name128>("dm-jnl-sw");
+    auto journal = cfg.db_path / config::token_database_journal_filename;
+    auto legacy  = cfg.db_path / config::token_database_persisit_filename;
+
+    auto read = [&](auto& tokendb, auto key) {
+        auto str = std::string();
+        tokendb.read_token(token_type::token, dm, key, str, true /* no throw */);
+        return str;
+    };
+    auto read_asset = [&](auto& tokendb, auto sym_id) {
+        auto str = std::string();
+        tokendb.read_asset(addr, sym_id, str, true /* no throw */);
+        return str;
+    };
+
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+        tokendb.put_token(token_type::token, action_op::add, dm, "t1", "t1-0");
+
+        tokendb.add_savepoint(1);
+        tokendb.put_token(token_type::token, action_op::update, dm, "t1", "t1-1");
+        tokendb.put_asset(addr, 1, "a1");
+
+        tokendb.add_savepoint(2);
+        tokendb.put_token(token_type::token, action_op::add, dm, "t2", "t2-2");
+        tokendb.put_asset(addr, 1, "a2");
+        tokendb.close();
+    }
+    CHECK(fc::exists(legacy));
+    CHECK(!fc::exists(journal));
+
+    // converts the legacy log into journal, savepoints loaded from the log are checkpointed
+    cfg.enable_journal = true;
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+        CHECK(!fc::exists(legacy));
+        CHECK(fc::exists(journal));
+        CHECK(tokendb.savepoints_size() == 2);
+
+        tokendb.add_savepoint(3);
+        tokendb.put_asset(addr, 1, "a3");
+        tokendb.close(false);
+    }
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+        CHECK(tokendb.savepoints_size() == 3);
+        CHECK(read_asset(tokendb, 1) == "a3");
+
+        tokendb.rollback_to_latest_savepoint();
+        CHECK(read_asset(tokendb, 1) == "a2");
+        CHECK(read(tokendb, "t2") == "t2-2");
+        tokendb.close();
+    }
+
+    // disables journal, the replayed savepoints are written into the log
+    cfg.enable_journal = false;
+    {
+        auto tokendb = token_database(cfg);
+        tokendb.open();
+        CHECK(fc::exists(legacy));
+        CHECK(!fc::exists(journal));
+        CHECK(tokendb.savepoints_size() == 2);
+        tokendb.close(false);
+    }
+
+    // savepoints are loaded from the log even without a clean close
+    auto tokendb = token_database(cfg);
+    tokendb.open();
+    CHECK(tokendb.savepoints_size() == 2);
+    CHECK(read(tokendb, "t2") == "t2-2");
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read(tokendb, "t2").empty());
+    CHECK(read_asset(tokendb, 1) == "a1");
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(tokendb.savepoints_size() == 0);
+    CHECK(read(tokendb, "t1") == "t1-0");
+    CHECK(read_asset(tokendb, 1).empty());
+}
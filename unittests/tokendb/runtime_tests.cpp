@@ -236,3 +236,165 @@ TEST_CASE_METHOD(tokendb_test, "squansh_test", "[tokendb]") {
 
     my_tester->produce_block();
 }
+
+TEST_CASE("undo_log_svpt_test", "[tokendb]") {
+    auto cfg            = standalone_tokendb_config("tokendb_undo");
+    cfg.enable_undo_log = true;
+
+    auto tokendb = token_database(cfg);
+    tokendb.open();
+
+    auto read = [&](auto type, auto& domain, auto key) {
+        auto str = std::string();
+        tokendb.read_token(type, domain, key, str, true /* no throw */);
+        return str;
+    };
+    auto dm = std::optional<name128>("dm-undo");
+    auto nd = std::optional<name128>();
+
+    tokendb.put_token(token_type::domain, action_op::add, nd, "dm-undo", "d0");
+    tokendb.put_token(token_type::token, action_op::put, dm, "t1", "t1-0");
+
+    tokendb.add_savepoint(1);
+    tokendb.put_token(token_type::domain, action_op::update, nd, "dm-undo", "d1");
+    tokendb.put_token(token_type::token, action_op::put, dm, "t1", "t1-1");
+    tokendb.put_token(token_type::token, action_op::put, dm, "t2", "t2-1");
+
+    tokendb.add_savepoint(2);
+    tokendb.put_token(token_type::domain, action_op::update, nd, "dm-undo", "d2");
+    tokendb.put_token(token_type::token, action_op::add, dm, "t3", "t3-2");
+    tokendb.put_token(token_type::token, action_op::put, dm, "t3", "t3-2b");
+
+    tokendb.add_savepoint(3);
+    tokendb.put_token(token_type::token, action_op::put, dm, "t1", "t1-3");
+
+    // t1 is first written in savepoint 3, its old value is merged into 2
+    tokendb.squash();
+    CHECK(tokendb.savepoints_size() == 2);
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read(token_type::domain, nd, "dm-undo") == "d1");
+    CHECK(read(token_type::token, dm, "t1") == "t1-1");
+    CHECK(read(token_type::token, dm, "t3").empty());
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read(token_type::domain, nd, "dm-undo") == "d0");
+    CHECK(read(token_type::token, dm, "t1") == "t1-0");
+    CHECK(read(token_type::token, dm, "t2").empty());
+}
+
+TEST_CASE("asset_write_cache_svpt_test", "[tokendb]") {
+    // pops all the savepoints, so it cannot share the ones of the controller
+    auto tokendb = token_database(standalone_tokendb_config("tokendb_wcache"));
+    tokendb.open();
+
+    // enough addresses to grow the table of write cache several times
+    auto addrs = std::vector<address>();
+    for(auto i = 0u; i < 5000; i++) {
+        addrs.emplace_back(address(N(.wc), N128(.cache), i));
+    }
+    auto read = [&](auto& addr, auto sym_id) {
+        auto str = std::string();
+        tokendb.read_asset(addr, sym_id, str, true /* no throw */);
+        return str;
+    };
+    auto value = [](auto seq, auto i) {
+        return fmt::format("{}-{}", seq, i);
+    };
+
+    tokendb.add_savepoint(1);
+    for(auto i = 0u; i < addrs.size(); i++) {
+        tokendb.put_asset(addrs[i], 1, value(1, i));
+    }
+
+    tokendb.add_savepoint(2);
+    for(auto i = 0u; i < addrs.size(); i += 2) {
+        tokendb.put_asset(addrs[i], 1, value(2, i));
+        tokendb.put_asset(addrs[i], 2, value(2, i));
+    }
+
+    tokendb.add_savepoint(3);
+    for(auto i = 0u; i < addrs.size(); i += 3) {
+        tokendb.put_asset(addrs[i], 1, value(3, i));
+        tokendb.put_asset(addrs[i], 1, std::string(10'000, 'x'));  // larger than one arena block
+    }
+
+    // writes of 3 are moved into 2
+    tokendb.squash();
+
+    tokendb.add_savepoint(4);
+    for(auto i = 0u; i < addrs.size(); i++) {
+        tokendb.put_asset(addrs[i], 1, value(4, i));
+    }
+    CHECK(read(addrs[5], 1) == value(4, 5));
+
+    tokendb.rollback_to_latest_savepoint();
+    for(auto i = 0u; i < addrs.size(); i++) {
+        if(i % 3 == 0) {
+            CHECK(read(addrs[i], 1) == std::string(10'000, 'x'));
+        }
+        else if(i % 2 == 0) {
+            CHECK(read(addrs[i], 1) == value(2, i));
+        }
+        else {
+            CHECK(read(addrs[i], 1) == value(1, i));
+        }
+    }
+
+    // persists savepoint 1 into db, values overwritten in 2 are still cached
+    tokendb.pop_savepoints(2);
+    CHECK(read(addrs[1], 1) == value(1, 1));
+    CHECK(read(addrs[2], 1) == value(2, 2));
+    CHECK(read(addrs[2], 2) == value(2, 2));
+
+    // persists the rest, all the values are read from db now
+    tokendb.pop_savepoints(3);
+    CHECK(tokendb.savepoints_size() == 0);
+    for(auto i = 0u; i < addrs.size(); i++) {
+        if(i % 3 == 0) {
+            CHECK(read(addrs[i], 1) == std::string(10'000, 'x'));
+        }
+        else if(i % 2 == 0) {
+            CHECK(read(addrs[i], 1) == value(2, i));
+        }
+        else {
+            CHECK(read(addrs[i], 1) == value(1, i));
+        }
+        CHECK(tokendb.exists_asset(addrs[i], 2) == (i % 2 == 0));
+    }
+
+    // previous values referenced by later savepoints outlive the popped one
+    tokendb.add_savepoint(5);
+    tokendb.put_asset(addrs[0], 3, value(5, 0));
+    tokendb.add_savepoint(6);
+    tokendb.put_asset(addrs[0], 3, value(6, 0));
+    tokendb.pop_savepoints(6);
+
+    tokendb.add_savepoint(7);
+    tokendb.put_asset(addrs[0], 3, value(7, 0));
+    tokendb.pop_back_savepoint();
+
+    // reuses the blocks released by popped savepoints
+    tokendb.add_savepoint(8);
+    for(auto i = 1u; i < addrs.size(); i++) {
+        tokendb.put_asset(addrs[i], 3, value(8, i));
+    }
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read(addrs[0], 3) == value(7, 0));
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(tokendb.savepoints_size() == 0);
+    CHECK(read(addrs[0], 3) == value(5, 0));
+
+    // the restored value must not live in the blocks freed by the rollback, reuse them and check again
+    tokendb.add_savepoint(9);
+    for(auto i = 1u; i < addrs.size(); i++) {
+        tokendb.put_asset(addrs[i], 3, value(9, i));
+    }
+    CHECK(read(addrs[0], 3) == value(5, 0));
+    tokendb.put_asset(addrs[0], 3, value(9, 0));
+    CHECK(read(addrs[0], 3) == value(9, 0));
+
+    tokendb.rollback_to_latest_savepoint();
+    CHECK(read(addrs[0], 3) == value(5, 0));
+}
@@ -59,6 +59,18 @@ protected:
     std::unique_ptr<tester>   my_tester;
 };
 
+// config of a standalone token database in an empty directory, for tests which need
+// their own config or savepoints rather than the ones of the controller in `tokendb_test`
+inline token_database::config
+standalone_tokendb_config(const std::string& name) {
+    auto cfg    = token_database::config();
+    cfg.db_path = jmzk_unittests_dir + "/tokendb_tests/" + name;
+    if(fc::exists(cfg.db_path)) {
+        fc::remove_all(cfg.db_path);
+    }
+    return cfg;
+}
+
 #define EXISTS_TOKEN(TYPE, NAME) \
     tokendb.exists_token(jmzk::chain::token_type::TYPE, std::nullopt, NAME)
 
@@ -1,6 +1,7 @@
 #include <catch/catch.hpp>
 
 #include <jmzk/chain/address.hpp>
+#include <jmzk/chain/block.hpp>
 #include <jmzk/chain/types.hpp>
 #include <jmzk/chain/token_database.hpp>
 #include <jmzk/chain/contracts/authorizer_ref.hpp>
@@ -416,8 +417,15 @@ TEST_CASE("test_percent_slim", "[types]") {
 TEST_CASE("test_make_db_value", "[types]") {
     auto CHECK_MAKE = [](auto sz) {
         auto str = std::string();
-        str.resize(sz);
+        str.resize(sz, 'a' + sz % 26);
         CHECK_NOTHROW(make_db_value(str));
+
+        auto b  = fc::raw::pack(str);
+        auto v  = make_db_value(str);
+        auto v2 = v;
+        auto v3 = std::move(v2);
+        CHECK(v.as_string_view() == std::string_view(b.data(), b.size()));
+        CHECK(v3.as_string_view() == v.as_string_view());
     };
 
     for(auto i = 1; i < 16; i++) {
@@ -427,6 +435,39 @@ TEST_CASE("test_make_db_value", "[types]") {
     }
 }
 
+TEST_CASE("test_trivially_packed", "[types]") {
+    static_assert(fc::raw::is_trivially_packed_v<group::node>);
+    static_assert(fc::raw::is_trivially_packed_v<fc::sha256>);
+    static_assert(!fc::raw::is_trivially_packed_v<name128>);
+    static_assert(!fc::raw::is_trivially_packed_v<public_key_type>);
+
+    auto nodes = small_vector<group::node, 4>();
+    for(auto i = 0; i < 10; i++) {
+        nodes.emplace_back(group::node { (weight_type)i, (weight_type)(i * 2), (uint16_t)(i + 1), (uint16_t)(i * 3) });
+    }
+    CHECK(fc::raw::pack_size(nodes[0]) == 8);
+
+    // bulk packed bytes are the same as packing the nodes one by one
+    auto b  = fc::raw::pack(nodes);
+    auto ds = fc::growable_datastream<16>();
+    fc::raw::pack(ds, fc::unsigned_int(nodes.size()));
+    for(auto& n : nodes) {
+        fc::raw::pack(ds, n.weight, n.threshold, n.index, n.size);
+    }
+    REQUIRE(ds.tellp() == b.size());
+    CHECK(memcmp(ds.data(), b.data(), b.size()) == 0);
+    CHECK(fc::raw::pack_size(nodes) == b.size());
+
+    auto nodes2 = fc::raw::unpack<small_vector<group::node, 4>>(b);
+    REQUIRE(nodes2.size() == nodes.size());
+    for(auto i = 0u; i < nodes.size(); i++) {
+        CHECK(nodes2[i].weight == nodes[i].weight);
+        CHECK(nodes2[i].threshold == nodes[i].threshold);
+        CHECK(nodes2[i].index == nodes[i].index);
+        CHECK(nodes2[i].size == nodes[i].size);
+    }
+}
+
 TEST_CASE("test_reflector_init", "[types]") {
     auto strx = signed_transaction();
     strx.max_charge = 1000;
@@ -446,3 +487,159 @@ TEST_CASE("test_reflector_init", "[types]") {
     CHECK(trx2.max_charge == 1000);
     CHECK(trx2.actions.size() == 1);
 }
+
+TEST_CASE("test_action_data", "[types]") {
+    auto tf   = transferft();
+    tf.from   = address();
+    tf.to     = address();
+    tf.number = asset::from_string("1.00000 S#1");
+    tf.memo   = "memo";
+
+    auto act  = action(N128(.fungible), N128(1), tf);
+    auto act2 = act;
+
+    // copies share both the bytes and the decoded value
+    CHECK(act.data.data() == act2.data.data());
+    CHECK(&act.data_as<const transferft&>() == &act2.data_as<const transferft&>());
+
+    auto b    = fc::raw::pack(act);
+    auto act3 = fc::raw::unpack<action>(b);
+    CHECK((bytes)act3.data == (bytes)act.data);
+    CHECK(act3.data_as<const transferft&>().memo == "memo");
+    CHECK(&act3.data_as<const transferft&>() != &act.data_as<const transferft&>());
+
+    // assigning replaces the payload and leaves the copies untouched
+    tf.memo = "memo2";
+    act2.set_data(tf);
+    CHECK(act2.data_as<const transferft&>().memo == "memo2");
+    CHECK(act.data_as<const transferft&>().memo == "memo");
+
+    auto var = fc::variant();
+    fc::to_variant(act.data, var);
+    auto data = action_data();
+    fc::from_variant(var, data);
+    CHECK((bytes)data == (bytes)act.data);
+}
+
+TEST_CASE("test_action_data_versions", "[types]") {
+    // same bytes decoded as two types get one value each
+    auto data = action_data(fc::raw::pack(N(test)));
+    CHECK(data.value<name>() == N(test));
+    CHECK(data.value<uint64_t>() == N(test).value);
+    CHECK(&data.value<name>() == &data.value<name>());
+    CHECK(&data.value<uint64_t>() == &data.value<uint64_t>());
+
+    // action decoded as v1 and then as v2, like plugins and contracts of another version do
+    auto ep   = everipass();
+    auto act  = action(N128(.domain), N128(.everipass), ep);
+    auto act2 = act;
+
+    auto& v1 = act.data_as<const everipass&>();
+    CHECK_THROWS_AS(act2.data_as<const everipass_v2&>(), fc::exception);
+    CHECK(&act2.data_as<const everipass&>() == &v1);
+
+    auto ep2 = everipass_v2();
+    ep2.memo = "memo";
+    auto act3 = action(N128(.domain), N128(.everipass), ep2);
+    CHECK(*act3.data_as<const everipass_v2&>().memo == "memo");
+    CHECK_THROWS_AS(act3.data_as<const everipass&>(), fc::exception);
+    CHECK(*act3.data_as<const everipass_v2&>().memo == "memo");
+}
+
+TEST_CASE("test_packed_transaction_digests", "[types]") {
+    auto strx = signed_transaction();
+    strx.max_charge = 1000;
+    strx.actions.emplace_back(action(".test", ".test", ".test", bytes(100, 'a')));
+
+    auto hash     = fc::sha256::hash(std::string("test"));
+    auto chain_id = *(chain_id_type*)&hash;
+    auto key      = private_key_type(std::string("5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3"));
+    strx.sign(key, chain_id);
+
+    for(auto c : { packed_transaction::none, packed_transaction::zlib }) {
+        auto ptrx = packed_transaction(strx, c);
+        CHECK(ptrx.id() == strx.id());
+        CHECK(ptrx.signed_id() == digest_type::hash(ptrx));
+        CHECK(ptrx.sig_digest(chain_id) == strx.sig_digest(chain_id));
+        CHECK(ptrx.get_signature_keys(chain_id) == strx.get_signature_keys(chain_id));
+
+        auto b     = fc::raw::pack(ptrx);
+        auto ptrx2 = fc::raw::unpack<packed_transaction>(b);
+        CHECK(ptrx2.id() == strx.id());
+        CHECK(ptrx2.signed_id() == ptrx.signed_id());
+        CHECK(ptrx2.sig_digest(chain_id) == strx.sig_digest(chain_id));
+
+        // digest is cached per chain id
+        auto hash2 = fc::sha256::hash(std::string("test2"));
+        CHECK(ptrx2.sig_digest(*(chain_id_type*)&hash2) == strx.sig_digest(*(chain_id_type*)&hash2));
+        CHECK(ptrx2.sig_digest(chain_id) == strx.sig_digest(chain_id));
+    }
+}
+
+TEST_CASE("test_signed_block_id", "[types]") {
+    auto h = signed_block_header();
+    h.timestamp = block_timestamp_type(10);
+    h.producer  = N128(jmzk);
+    h.previous  = block_header::id_from_digest(fc::sha256::hash(std::string("prev")), 9);
+
+    auto sb = signed_block(h);
+    auto id = sb.id();
+    CHECK(id == h.id());
+    CHECK(block_header::num_from_id(id) == 10);
+    CHECK(sb.id() == id);
+
+    // the cached id follows the header set
+    h.confirmed = 5;
+    sb.set_header(h);
+    CHECK(sb.id() != id);
+    CHECK(sb.id() == h.id());
+
+    auto sb2 = signed_block(std::move(sb));
+    CHECK(sb2.id() == h.id());
+
+    auto b   = fc::raw::pack(sb2);
+    auto sb3 = fc::raw::unpack<signed_block>(b);
+    CHECK(sb3.id() == h.id());
+}
+
+TEST_CASE("test_packed_transaction_canonical", "[types]") {
+    auto strx = signed_transaction();
+    strx.max_charge = 1000;
+    strx.actions.emplace_back(action(".test", ".test", ".test", bytes(100, 'a')));
+
+    auto hash     = fc::sha256::hash(std::string("canonical"));
+    auto chain_id = *(chain_id_type*)&hash;
+
+    auto raw = fc::raw::pack((const transaction&)strx);
+    CHECK_NOTHROW(packed_transaction(bytes(raw), signatures_type(strx.signatures)));
+
+    // trailing bytes are rejected by unpacking
+    auto trailing = raw;
+    trailing.push_back(0);
+    CHECK_THROWS_AS(packed_transaction(std::move(trailing), signatures_type(strx.signatures)), fc::raw_unpack_exception);
+
+    // same as received from network: signatures, compression and packed_trx
+    auto make = [&](const bytes& packed_trx) {
+        auto b  = fc::raw::pack(strx.signatures);
+        auto pt = fc::raw::pack(packed_trx);
+        b.push_back((char)packed_transaction::none);
+        b.insert(b.end(), pt.cbegin(), pt.cend());
+        return b;
+    };
+    auto ptrx = fc::raw::unpack<packed_transaction>(make(raw));
+    CHECK(ptrx.id() == strx.id());
+    CHECK(ptrx.sig_digest(chain_id) == strx.sig_digest(chain_id));
+
+    // count of actions encoded as a non-minimal varint right after the 14 bytes of header
+    REQUIRE(raw[14] == 1);
+    auto noncanonical = raw;
+    noncanonical[14] = (char)0x81;
+    noncanonical.insert(noncanonical.begin() + 15, 0);
+
+    // still accepted, but ids and digests are the ones of the canonical encoding
+    auto ptrx2 = fc::raw::unpack<packed_transaction>(make(noncanonical));
+    CHECK(ptrx2.get_packed_transaction() == noncanonical);
+    CHECK(ptrx2.id() == strx.id());
+    CHECK(ptrx2.sig_digest(chain_id) == strx.sig_digest(chain_id));
+    CHECK(ptrx2.signed_id() != ptrx.signed_id());
+}